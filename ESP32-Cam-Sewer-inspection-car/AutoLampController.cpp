@@ -0,0 +1,132 @@
+/*
+ * AutoLampController.cpp
+ *
+ *  Active while auto lamp is on and a stream is running. The exposure time and gain chosen by the automatic exposure
+ *  of the sensor are read from its registers, since s->status only contains the manual values.
+ *  If exposure or gain are above their target, the lamp is increased, if the exposure is well below the target
+ *  and no gain is used, the lamp is decreased. The lamp value set in the GUI is the maximum.
+ *  This keeps the fps high with the minimum lamp power.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+
+#include <Arduino.h>
+#include "esp_camera.h"
+
+#include "AutoLampController.h"
+#include "CameraSettings.h"
+#include "LoopScheduler.h"
+#include "esp32-cam-webserver.h"
+
+AutoLampStatusStruct AutoLampStatus;
+uint16_t AutoLampExposureTargetLines = AUTO_LAMP_EXPOSURE_DEFAULT_LINES;
+static bool sAutoLampIsActive = false;
+static unsigned long sMillisOfLastRun;
+
+/*
+ * Reads the actual exposure in lines and the gain from the sensor registers.
+ * For the OV2640, bit 8 of the register number selects the sensor register bank.
+ * @return false if the sensor is not supported
+ */
+static bool readExposureAndGain(sensor_t *aSensor, uint16_t *aExposureLines, uint16_t *aGainX16) {
+    if (aSensor->id.PID == OV2640_PID) {
+        *aExposureLines = (aSensor->get_reg(aSensor, 0x145, 0x3F) << 10) | (aSensor->get_reg(aSensor, 0x110, 0xFF) << 2)
+                | aSensor->get_reg(aSensor, 0x104, 0x03);
+        // Each of the upper 4 bits doubles the gain, the lower 4 bits add 1/16
+        int tGain = aSensor->get_reg(aSensor, 0x100, 0xFF);
+        *aGainX16 = (16 + (tGain & 0x0F)) << __builtin_popcount(tGain >> 4);
+        return true;
+    }
+    if (aSensor->id.PID == OV3660_PID) {
+        *aExposureLines = ((aSensor->get_reg(aSensor, 0x3500, 0x0F) << 16) | (aSensor->get_reg(aSensor, 0x3501, 0xFF) << 8)
+                | aSensor->get_reg(aSensor, 0x3502, 0xFF)) >> 4;
+        *aGainX16 = (aSensor->get_reg(aSensor, 0x350A, 0x03) << 8) | aSensor->get_reg(aSensor, 0x350B, 0xFF);
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Called after the lamp was set by the GUI or the stream handler, the controller then starts from this value
+ */
+void restartAutoLamp() {
+    sAutoLampIsActive = false;
+}
+
+uint32_t autoLampLoopTask() {
+    if (!autoLampValue || lampBrightnessPercentage <= 0 || AutoLampExposureTargetLines == 0 || streamCount == 0) {
+        sAutoLampIsActive = false;
+        return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+    }
+    unsigned long tMillis = millis();
+    if (!sAutoLampIsActive) {
+        // The stream handler has just switched the lamp to lampBrightnessPercentage
+        sAutoLampIsActive = true;
+        AutoLampStatus.LampPercent = lampBrightnessPercentage;
+    } else {
+        unsigned long tDeltaMillis = tMillis - sMillisOfLastRun;
+        AutoLampStatus.ActiveMillis += tDeltaMillis;
+        AutoLampStatus.LampPercentMillis += (uint64_t) AutoLampStatus.LampPercent * tDeltaMillis;
+    }
+    sMillisOfLastRun = tMillis;
+
+    sensor_t *tSensor = esp_camera_sensor_get();
+    if (tSensor == NULL) {
+        return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+    }
+    // A setting written by the http task in between would switch the OV2640 register bank
+    lockCameraSensor();
+    bool tSensorIsSupported = readExposureAndGain(tSensor, &AutoLampStatus.ExposureLines, &AutoLampStatus.GainX16);
+    unlockCameraSensor();
+    if (!tSensorIsSupported) {
+        return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+    }
+
+    int tNewPercent = AutoLampStatus.LampPercent;
+    if (AutoLampStatus.ExposureLines > AutoLampExposureTargetLines || AutoLampStatus.GainX16 > AUTO_LAMP_GAIN_LIMIT_X16) {
+        // Step is proportional to the relative exposure error
+        int tStep = ((AutoLampStatus.ExposureLines - AutoLampExposureTargetLines) * 10) / AutoLampExposureTargetLines;
+        tNewPercent += constrain(tStep, 1, AUTO_LAMP_MAX_STEP_PERCENT);
+    } else if (AutoLampStatus.GainX16 <= 16
+            && AutoLampStatus.ExposureLines < (AutoLampExposureTargetLines * AUTO_LAMP_DECREASE_EXPOSURE_PERCENT) / 100) {
+        tNewPercent--;
+    }
+    tNewPercent = constrain(tNewPercent, 0, lampBrightnessPercentage);
+    if (tNewPercent != AutoLampStatus.LampPercent) {
+        AutoLampStatus.LampPercent = tNewPercent;
+        AutoLampStatus.Adjustments++;
+        setLamp(tNewPercent);
+    }
+    return AUTO_LAMP_PERIOD_MILLIS;
+}
+
+/*
+ * @return number of characters printed
+ */
+int printAutoLampStatus(char *aBuffer) {
+    unsigned int tAveragePercent = 0;
+    if (AutoLampStatus.ActiveMillis > 0) {
+        tAveragePercent = AutoLampStatus.LampPercentMillis / AutoLampStatus.ActiveMillis;
+    }
+    return sprintf(aBuffer, "\"lamp_percent\":%u,\"lamp_average_percent\":%u,\"lamp_exposure_lines\":%u,"
+            "\"lamp_gain_x16\":%u,\"lamp_adjustments\":%lu,\"lamp_active_ms\":%lu,", AutoLampStatus.LampPercent,
+            tAveragePercent, AutoLampStatus.ExposureLines, AutoLampStatus.GainX16, (unsigned long) AutoLampStatus.Adjustments,
+            (unsigned long) AutoLampStatus.ActiveMillis);
+}
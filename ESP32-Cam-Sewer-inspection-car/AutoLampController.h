@@ -0,0 +1,55 @@
+/*
+ * AutoLampController.h
+ *
+ *  Closed loop auto lamp, which keeps the exposure time of the sensor below a target.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _AUTO_LAMP_CONTROLLER_H
+#define _AUTO_LAMP_CONTROLLER_H
+
+#include <stdint.h>
+
+/*
+ * If the exposure time is longer than one frame, the sensor extends the frame and the fps drop.
+ * OV2640 frames at SVGA and below have 672 lines, UXGA frames have 1248 lines.
+ */
+#define AUTO_LAMP_EXPOSURE_DEFAULT_LINES    400 // 0 = lamp is fully on while streaming, as before
+#define AUTO_LAMP_GAIN_LIMIT_X16            32  // 2 x gain, above which the lamp is increased
+#define AUTO_LAMP_PERIOD_MILLIS             200 // exposure changes after 1 or 2 frames
+#define AUTO_LAMP_MAX_STEP_PERCENT          10
+#define AUTO_LAMP_DECREASE_EXPOSURE_PERCENT 50  // below 50 % of the target, the lamp is decreased
+
+struct AutoLampStatusStruct {
+    uint8_t LampPercent;            // current value, up to lampBrightnessPercentage
+    uint16_t ExposureLines;         // last value read from the sensor
+    uint16_t GainX16;               // last value read from the sensor, 16 is 1 x gain
+    uint32_t Adjustments;
+    uint32_t ActiveMillis;          // time the controller was active
+    uint64_t LampPercentMillis;     // integral of LampPercent over ActiveMillis, for the average lamp power
+};
+extern AutoLampStatusStruct AutoLampStatus;
+extern uint16_t AutoLampExposureTargetLines;
+
+void restartAutoLamp();
+uint32_t autoLampLoopTask();
+int printAutoLampStatus(char *aBuffer);
+
+#endif // _AUTO_LAMP_CONTROLLER_H
@@ -0,0 +1,118 @@
+/*
+ * BandingTest.cpp
+ *
+ *  Takes one frame with the lamp on and a short manual exposure, decodes it at 1/4 scale and computes
+ *  the luminance profile of the rows. A lamp PWM which is slow compared to the exposure time gives horizontal bands,
+ *  i.e. a profile deviating periodically from its local average. The mean deviation is returned as banding score.
+ *  Point the camera on a uniform surface, e.g. the pipe wall, and compare the score for different lamp frequencies.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "img_converters.h"
+
+#include "BandingTest.h"
+#include "CameraSettings.h"
+#include "MotionEstimator.h"
+#include "esp32-cam-webserver.h"
+
+static uint8_t sRowLuminance[BANDING_TEST_MAX_ROWS];
+
+/*
+ * @return banding score, i.e. mean absolute deviation of the row luminance from its local average, multiplied by 100
+ */
+static uint32_t computeRowProfileAndBanding(const uint8_t *aRGB565, int aWidth, int aHeight) {
+    for (int y = 0; y < aHeight; ++y) {
+        const uint8_t *tPixel = &aRGB565[y * aWidth * 2];
+        uint32_t tSum = 0;
+        for (int x = 0; x < aWidth; ++x) {
+            tSum += getLuminanceOfRGB565(tPixel[0], tPixel[1]);
+            tPixel += 2;
+        }
+        sRowLuminance[y] = tSum / aWidth;
+    }
+    uint32_t tDeviationSum = 0;
+    int tNumberOfRows = 0;
+    for (int y = BANDING_TEST_SMOOTHING_ROWS; y < aHeight - BANDING_TEST_SMOOTHING_ROWS; ++y) {
+        uint32_t tLocalSum = 0;
+        for (int i = -BANDING_TEST_SMOOTHING_ROWS; i <= BANDING_TEST_SMOOTHING_ROWS; ++i) {
+            tLocalSum += sRowLuminance[y + i];
+        }
+        int tLocalAverageX100 = (tLocalSum * 100) / (2 * BANDING_TEST_SMOOTHING_ROWS + 1);
+        tDeviationSum += abs(sRowLuminance[y] * 100 - tLocalAverageX100);
+        tNumberOfRows++;
+    }
+    return (tNumberOfRows > 0) ? tDeviationSum / tNumberOfRows : 0;
+}
+
+/*
+ * Sets manual exposure and the lamp to its GUI value, takes a frame and restores exposure and lamp.
+ * @return number of characters printed or -1 if no frame could be taken or decoded
+ */
+int runBandingTest(char *aBuffer, uint16_t aExposureLines) {
+    sensor_t *tSensor = esp_camera_sensor_get();
+    const CameraSettingStruct *tAecSetting = findCameraSetting("aec");
+    const CameraSettingStruct *tAecValueSetting = findCameraSetting("aec_value");
+    int tOldAec = tAecSetting->Getter(tSensor);
+    int tOldAecValue = tAecValueSetting->Getter(tSensor);
+    writeCameraSetting(tSensor, tAecSetting, 0);
+    writeCameraSetting(tSensor, tAecValueSetting, aExposureLines);
+    if (lampBrightnessPercentage > 0) {
+        setLamp(lampBrightnessPercentage);
+    }
+
+    camera_fb_t *tFrame = esp_camera_fb_get();
+    for (int i = 0; i < BANDING_TEST_SETTLE_FRAMES && tFrame != NULL; ++i) {
+        esp_camera_fb_return(tFrame);
+        tFrame = esp_camera_fb_get();
+    }
+    int tResult = -1;
+    if (tFrame != NULL && tFrame->format == PIXFORMAT_JPEG) {
+        int tWidth = tFrame->width / 4;
+        int tHeight = min((int) tFrame->height / 4, BANDING_TEST_MAX_ROWS);
+        size_t tBufferSize = (tFrame->width / 4) * (tFrame->height / 4) * 2;
+        uint8_t *tBuffer = (uint8_t*) (psramFound() ? ps_malloc(tBufferSize) : malloc(tBufferSize));
+        if (tBuffer != NULL && jpg2rgb565(tFrame->buf, tFrame->len, tBuffer, JPG_SCALE_4X)) {
+            uint32_t tBanding = computeRowProfileAndBanding(tBuffer, tWidth, tHeight);
+            char *p = aBuffer;
+            p += sprintf(p, "{\"exposure\":%u,\"lamp\":%d,\"lamp_frequency\":%d,\"banding\":%lu,\"rows\":[", aExposureLines,
+                    lampBrightnessPercentage, lampPWMFrequency, (unsigned long) tBanding);
+            for (int y = 0; y < tHeight; ++y) {
+                p += sprintf(p, "%u,", sRowLuminance[y]);
+            }
+            p--; // remove last comma
+            p += sprintf(p, "]}");
+            tResult = p - aBuffer;
+            Serial.printf("Banding test: exposure=%u lamp frequency=%d banding=%lu\r\n", aExposureLines, lampPWMFrequency,
+                    (unsigned long) tBanding);
+        }
+        free(tBuffer);
+    }
+    if (tFrame != NULL) {
+        esp_camera_fb_return(tFrame);
+    }
+
+    writeCameraSetting(tSensor, tAecValueSetting, tOldAecValue);
+    writeCameraSetting(tSensor, tAecSetting, tOldAec);
+    updateLamp();
+    return tResult;
+}
@@ -0,0 +1,38 @@
+/*
+ * BandingTest.h
+ *
+ *  Test capture for verifying that the lamp PWM causes no rolling shutter banding.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _BANDING_TEST_H
+#define _BANDING_TEST_H
+
+#include <stdint.h>
+
+#define BANDING_TEST_DEFAULT_EXPOSURE_LINES 20  // short exposure, where banding of a 1 kHz lamp is clearly visible
+#define BANDING_TEST_SETTLE_FRAMES          3   // frames until the manual exposure is applied
+#define BANDING_TEST_SMOOTHING_ROWS         4   // the row profile is compared with the average of +-4 rows
+#define BANDING_TEST_MAX_ROWS               (1200 / 4)
+#define BANDING_TEST_RESPONSE_SIZE          (128 + BANDING_TEST_MAX_ROWS * 4)
+
+int runBandingTest(char *aBuffer, uint16_t aExposureLines);
+
+#endif // _BANDING_TEST_H
@@ -0,0 +1,92 @@
+/*
+ * BatteryMonitor.cpp
+ *
+ *  Measures the motor supply voltage by the loop scheduler, i.e. not in the motor timer or the http server.
+ *  Each measurement is the average of several ADC readings, which is then filtered by an exponential filter.
+ *  The filtered value is used for compensating the motor PWM, so the car keeps its speed while the battery drains.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+
+#include <Arduino.h>
+
+#include "BatteryMonitor.h"
+#include "LoopScheduler.h"
+#include "esp32-cam-webserver.h"
+#include "MotorAndServoControl.h"
+
+BatteryStatusStruct BatteryStatus;
+
+/*
+ * @return battery voltage computed from the average of BATTERY_SAMPLES_PER_MEASUREMENT calibrated ADC readings
+ */
+static uint16_t readBatteryMillivolt() {
+    uint32_t tSum = 0;
+    for (int i = 0; i < BATTERY_SAMPLES_PER_MEASUREMENT; ++i) {
+        tSum += analogReadMilliVolts(BATTERY_ADC_PIN);
+    }
+    return ((tSum / BATTERY_SAMPLES_PER_MEASUREMENT) * (BATTERY_DIVIDER_TOP_KOHM + BATTERY_DIVIDER_BOTTOM_KOHM))
+            / BATTERY_DIVIDER_BOTTOM_KOHM;
+}
+
+uint32_t batteryLoopTask() {
+    if (!sBatteryMonitorIsSupported) {
+        return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+    }
+    uint16_t tMillivolt = readBatteryMillivolt();
+    BatteryStatus.LastRawMillivolt = tMillivolt;
+    if (BatteryStatus.Millivolt == 0) {
+        // first measurement
+        BatteryStatus.Millivolt = tMillivolt;
+        BatteryStatus.MinMillivolt = tMillivolt;
+        Serial.print("Battery: ");
+        Serial.print(tMillivolt);
+        Serial.println(" mV");
+    } else {
+        BatteryStatus.Millivolt += ((int) tMillivolt - (int) BatteryStatus.Millivolt) >> BATTERY_FILTER_SHIFT;
+        if (BatteryStatus.MinMillivolt > BatteryStatus.Millivolt) {
+            BatteryStatus.MinMillivolt = BatteryStatus.Millivolt;
+        }
+    }
+
+    if (!BatteryStatus.IsLow && BatteryStatus.Millivolt < BATTERY_LOW_MILLIVOLT) {
+        BatteryStatus.IsLow = true;
+        BatteryStatus.NumberOfLowWarnings++;
+        Serial.print("Battery low: ");
+        Serial.print(BatteryStatus.Millivolt);
+        Serial.println(" mV, return home now!");
+    } else if (BatteryStatus.IsLow && BatteryStatus.Millivolt > BATTERY_LOW_MILLIVOLT + BATTERY_LOW_HYSTERESIS_MILLIVOLT) {
+        BatteryStatus.IsLow = false;
+    }
+
+    if (sOnePWMMotorIsSupported) {
+        setMotorSupplyMillivolt(BatteryStatus.Millivolt);
+    }
+    return BATTERY_SAMPLE_MILLIS;
+}
+
+/*
+ * @return number of characters printed
+ */
+int printBatteryStatus(char *aBuffer) {
+    return sprintf(aBuffer, "\"battery_mv\":%u,\"battery_min_mv\":%u,\"battery_raw_mv\":%u,\"battery_low\":%d,\"battery_low_warnings\":%lu,",
+            BatteryStatus.Millivolt, BatteryStatus.MinMillivolt, BatteryStatus.LastRawMillivolt, BatteryStatus.IsLow,
+            (unsigned long) BatteryStatus.NumberOfLowWarnings);
+}
@@ -0,0 +1,62 @@
+/*
+ * BatteryMonitor.h
+ *
+ *  Filtered measurement of the motor supply voltage and low battery warning.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _BATTERY_MONITOR_H
+#define _BATTERY_MONITOR_H
+
+#include <stdint.h>
+
+/*
+ * GPIO 33 is ADC1, which can be used together with WiFi. It is connected to the red LED of the ESP32-CAM,
+ * which must be removed, since its current falsifies the voltage of the divider.
+ * Divider 100 kOhm / 100 kOhm gives 2.1 volt for a full Li-ion cell.
+ */
+#if !defined(BATTERY_ADC_PIN)
+#define BATTERY_ADC_PIN                 33
+#endif
+#if !defined(BATTERY_DIVIDER_TOP_KOHM)
+#define BATTERY_DIVIDER_TOP_KOHM        100 // between battery and pin
+#define BATTERY_DIVIDER_BOTTOM_KOHM     100 // between pin and ground
+#endif
+#if !defined(BATTERY_LOW_MILLIVOLT)
+#define BATTERY_LOW_MILLIVOLT           3400 // for 1 Li-ion cell. Warning to return home, since the way back takes as long as the way in.
+#endif
+#define BATTERY_LOW_HYSTERESIS_MILLIVOLT 100
+#define BATTERY_SAMPLE_MILLIS           1000
+#define BATTERY_SAMPLES_PER_MEASUREMENT 16  // averaged to suppress the motor PWM ripple
+#define BATTERY_FILTER_SHIFT            3   // exponential filter with 1/8 of the new value
+
+struct BatteryStatusStruct {
+    uint16_t Millivolt;             // filtered, 0 if not yet measured
+    uint16_t MinMillivolt;          // of filtered value
+    uint16_t LastRawMillivolt;      // last average of BATTERY_SAMPLES_PER_MEASUREMENT samples
+    bool IsLow;
+    uint32_t NumberOfLowWarnings;
+};
+extern BatteryStatusStruct BatteryStatus;
+
+uint32_t batteryLoopTask();
+int printBatteryStatus(char *aBuffer);
+
+#endif // _BATTERY_MONITOR_H
@@ -0,0 +1,322 @@
+/*
+ * CameraProfiles.cpp
+ *
+ *  Named camera, lamp and motor profiles like "shaft" or "pipe-dark", which are stored on SPIFFS
+ *  and kept in RAM for switching all settings with one command.
+ *  A profile file has the same format as the preferences file, but may contain only a subset of the settings.
+ *  Applying a profile writes only the camera settings which differ from the values last written to the sensor,
+ *  in the order of the CameraSettings table, which respects the dependencies between the settings.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#include <Arduino.h>
+#include "esp_camera.h"
+
+#include "CameraProfiles.h"
+#include "CameraSettings.h"
+#include "JsonScanner.h"
+#include "storage.h"
+#include "esp32-cam-webserver.h"
+#include "MotorAndServoControl.h"
+
+struct ProfileEntryStruct {
+    int8_t CameraSettingIndex; // -1 if not a camera setting
+    char Name[16];             // only used if not a camera setting
+    int16_t Value;
+};
+
+struct ProfileStruct {
+    char Name[PROFILE_NAME_MAX_LENGTH + 1];
+    uint8_t NumberOfEntries;
+    ProfileEntryStruct Entries[PROFILE_MAX_ENTRIES];
+};
+
+ProfileStruct sProfiles[MAX_NUMBER_OF_PROFILES];
+uint8_t sNumberOfProfiles = 0;
+
+/*
+ * Profiles created if no profile file exists
+ */
+struct DefaultProfileStruct {
+    const char *Name;
+    const char *Json;
+};
+const DefaultProfileStruct DefaultProfiles[] = {
+        { "shaft", "{\"lamp\":0,\"quality\":12,\"aec\":1,\"aec_value\":300,\"agc\":1,\"agc_gain\":0,\"gainceiling\":0}" },
+        { "pipe-dark", "{\"lamp\":100,\"quality\":15,\"aec\":0,\"aec_value\":1200,\"agc\":0,\"agc_gain\":20,\"gainceiling\":4}" },
+        { "pipe-reflective",
+                "{\"lamp\":40,\"quality\":12,\"aec\":0,\"aec_value\":400,\"agc\":0,\"agc_gain\":5,\"gainceiling\":1,\"ae_level\":-1}" } };
+
+static void getProfileFilename(char *aFilename, const char *aProfileName) {
+    sprintf(aFilename, "/" PROFILE_FILE_PREFIX "%s.json", aProfileName);
+}
+
+static ProfileStruct* findProfile(const char *aProfileName) {
+    for (uint_fast8_t i = 0; i < sNumberOfProfiles; ++i) {
+        if (!strcmp(aProfileName, sProfiles[i].Name)) {
+            return &sProfiles[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Entries of a profile, which are not camera settings. Motor commands like "move-car" are not accepted,
+ * applying a profile must never drive the car.
+ */
+static const char *const sOtherProfileEntryNames[] = { "lamp", "autolamp", "rotate", "pan", "tilt", "pan-speed", "pan-easing" };
+
+static bool isOtherProfileEntry(const char *aKey) {
+    for (uint_fast8_t i = 0; i < sizeof(sOtherProfileEntryNames) / sizeof(sOtherProfileEntryNames[0]); ++i) {
+        if (!strcmp(aKey, sOtherProfileEntryNames[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Called by the JSON scanner for each key / value pair of a profile file
+ */
+static void addProfileEntry(const char *aKey, const char *aValue, void *aContext) {
+    ProfileStruct *tProfile = (ProfileStruct*) aContext;
+    if (tProfile->NumberOfEntries >= PROFILE_MAX_ENTRIES) {
+        Serial.printf("Too many entries in profile %s, \"%s\" ignored\r\n", tProfile->Name, aKey);
+        return;
+    }
+    ProfileEntryStruct *tEntry = &tProfile->Entries[tProfile->NumberOfEntries];
+    tEntry->CameraSettingIndex = findCameraSettingIndex(aKey);
+    if (tEntry->CameraSettingIndex < 0) {
+        if (!isOtherProfileEntry(aKey)) {
+            Serial.printf("Entry \"%s\" not allowed in profile %s, ignored\r\n", aKey, tProfile->Name);
+            return;
+        }
+        if (strlen(aKey) >= sizeof(tEntry->Name)) {
+            Serial.printf("Key \"%s\" of profile %s too long, ignored\r\n", aKey, tProfile->Name);
+            return;
+        }
+        strcpy(tEntry->Name, aKey);
+    }
+    tEntry->Value = atoi(aValue);
+    tProfile->NumberOfEntries++;
+}
+
+/*
+ * Sort camera settings by their index in the CameraSettings table to get the right sequence for applying them.
+ * Other entries are placed after the camera settings. Insertion sort is sufficient for this few entries.
+ */
+static void sortProfileEntries(ProfileStruct *aProfile) {
+    for (uint_fast8_t i = 1; i < aProfile->NumberOfEntries; ++i) {
+        ProfileEntryStruct tEntry = aProfile->Entries[i];
+        uint8_t tSortIndex = (uint8_t) tEntry.CameraSettingIndex; // -1 becomes 255
+        int_fast8_t j = i - 1;
+        while (j >= 0 && (uint8_t) aProfile->Entries[j].CameraSettingIndex > tSortIndex) {
+            aProfile->Entries[j + 1] = aProfile->Entries[j];
+            j--;
+        }
+        aProfile->Entries[j + 1] = tEntry;
+    }
+}
+
+/*
+ * Parses the profile JSON in aJsonBuffer and stores it in RAM. An existing profile with the same name is replaced.
+ * @return true if profile is valid
+ */
+static bool storeProfile(const char *aProfileName, char *aJsonBuffer, size_t aLength) {
+    ProfileStruct *tProfile = findProfile(aProfileName);
+    if (tProfile == NULL) {
+        if (sNumberOfProfiles >= MAX_NUMBER_OF_PROFILES) {
+            Serial.printf("Too many profiles, profile %s ignored\r\n", aProfileName);
+            return false;
+        }
+        tProfile = &sProfiles[sNumberOfProfiles];
+    }
+    strncpy(tProfile->Name, aProfileName, PROFILE_NAME_MAX_LENGTH);
+    tProfile->Name[PROFILE_NAME_MAX_LENGTH] = '\0';
+    tProfile->NumberOfEntries = 0;
+    if (scanFlatJsonObject(aJsonBuffer, aLength, addProfileEntry, tProfile) == JSON_SCANNER_ERROR) {
+        Serial.printf("Profile %s is not valid JSON, ignored\r\n", aProfileName);
+        return false;
+    }
+    sortProfileEntries(tProfile);
+    if (tProfile == &sProfiles[sNumberOfProfiles]) {
+        sNumberOfProfiles++;
+    }
+    Serial.printf("Profile %s with %u entries loaded\r\n", tProfile->Name, tProfile->NumberOfEntries);
+    return true;
+}
+
+/*
+ * @return false if file could not be created or not completely written
+ */
+static bool writeProfileFile(fs::FS &fs, const char *aProfileName, const char *aJson) {
+    char tFilename[SPIFFS_MAX_FILENAME_LENGTH + 1];
+    getProfileFilename(tFilename, aProfileName);
+    File file = fs.open(tFilename, FILE_WRITE);
+    if (!file) {
+        Serial.printf("Failed to create %s\r\n", tFilename);
+        return false;
+    }
+    size_t tLength = strlen(aJson);
+    bool tSuccess = (file.print(aJson) == tLength);
+    file.close();
+    if (!tSuccess) {
+        Serial.printf("Failed to write %s\r\n", tFilename);
+        fs.remove(tFilename);
+    }
+    return tSuccess;
+}
+
+/*
+ * Reads all profile files into RAM. Creates the default profiles if no profile file exists.
+ */
+void loadCameraProfiles(fs::FS &fs) {
+    static char sProfileBuffer[PREFERENCES_MAX_SIZE + 1];
+    sNumberOfProfiles = 0;
+
+    for (uint_fast8_t tRun = 0; tRun < 2; ++tRun) {
+        File root = fs.open("/");
+        if (!root) {
+            return;
+        }
+        File file = root.openNextFile();
+        while (file) {
+            const char *tFilename = file.name();
+            if (*tFilename == '/') {
+                tFilename++; // Core 1.x returns the path
+            }
+            const char *tExtension = strstr(tFilename, ".json");
+            size_t tSize = file.size();
+            if (!strncmp(tFilename, PROFILE_FILE_PREFIX, strlen(PROFILE_FILE_PREFIX)) && tExtension != NULL
+                    && tSize <= PREFERENCES_MAX_SIZE) {
+                char tProfileName[PROFILE_NAME_MAX_LENGTH + 1];
+                size_t tNameLength = tExtension - tFilename - strlen(PROFILE_FILE_PREFIX);
+                if (tNameLength > PROFILE_NAME_MAX_LENGTH) {
+                    tNameLength = PROFILE_NAME_MAX_LENGTH;
+                }
+                memcpy(tProfileName, tFilename + strlen(PROFILE_FILE_PREFIX), tNameLength);
+                tProfileName[tNameLength] = '\0';
+                if (file.read((uint8_t*) sProfileBuffer, tSize) == tSize) {
+                    sProfileBuffer[tSize] = '\0';
+                    storeProfile(tProfileName, sProfileBuffer, tSize);
+                }
+            }
+            file.close();
+            file = root.openNextFile();
+        }
+        root.close();
+
+        if (sNumberOfProfiles > 0) {
+            return;
+        }
+        Serial.println("No profile found, creating default profiles");
+        for (uint_fast8_t i = 0; i < sizeof(DefaultProfiles) / sizeof(DefaultProfiles[0]); ++i) {
+            writeProfileFile(fs, DefaultProfiles[i].Name, DefaultProfiles[i].Json);
+        }
+    }
+}
+
+/*
+ * Saves all current camera settings, lamp and rotation under aProfileName and updates the profile in RAM
+ */
+bool saveCameraProfile(fs::FS &fs, const char *aProfileName) {
+    static char sProfileJson[PREFERENCES_MAX_SIZE + 1];
+    size_t tLength = strlen(aProfileName);
+    bool tNameIsValid = (tLength > 0 && tLength <= PROFILE_NAME_MAX_LENGTH);
+    for (size_t i = 0; i < tLength; ++i) {
+        if (!isalnum(aProfileName[i]) && aProfileName[i] != '-' && aProfileName[i] != '_') {
+            tNameIsValid = false; // no path separators, no quotes, no URL encoded characters
+        }
+    }
+    if (!tNameIsValid) {
+        Serial.printf("Invalid profile name \"%s\"\r\n", aProfileName);
+        return false;
+    }
+    char *p = sProfileJson;
+    *p++ = '{';
+    p += sprintf(p, "\"lamp\":%i,", lampBrightnessPercentage);
+    p += sprintf(p, "\"autolamp\":%u,", autoLampValue);
+    p += printCameraSettings(p, esp_camera_sensor_get());
+    p += sprintf(p, "\"rotate\":%d", myRotation);
+    *p++ = '}';
+    *p = '\0';
+    if (!writeProfileFile(fs, aProfileName, sProfileJson)) {
+        return false;
+    }
+    Serial.printf("Profile %s saved\r\n", aProfileName);
+    return storeProfile(aProfileName, sProfileJson, p - sProfileJson);
+}
+
+/*
+ * Applies all settings of the profile. Camera settings are only written if they differ from the last written value.
+ * @return number of camera settings written or -1 if profile does not exist
+ */
+int applyCameraProfile(const char *aProfileName) {
+    ProfileStruct *tProfile = findProfile(aProfileName);
+    if (tProfile == NULL) {
+        Serial.printf("Profile %s not found\r\n", aProfileName);
+        return -1;
+    }
+    unsigned long tStartMicros = micros();
+    sensor_t *s = esp_camera_sensor_get();
+    int tNumberOfSettingsWritten;
+    bool tLampChanged = false;
+    for (uint_fast8_t i = 0; i < tProfile->NumberOfEntries; ++i) {
+        ProfileEntryStruct *tEntry = &tProfile->Entries[i];
+        if (tEntry->CameraSettingIndex >= 0) {
+            queueCameraSetting(tEntry->CameraSettingIndex, tEntry->Value);
+        } else if (!strcmp(tEntry->Name, "lamp")) {
+            if (lampBrightnessPercentage != -1) {
+                lampBrightnessPercentage = constrain(tEntry->Value, 0, 100);
+                tLampChanged = true;
+            }
+        } else if (!strcmp(tEntry->Name, "autolamp")) {
+            autoLampValue = tEntry->Value;
+            tLampChanged = true;
+        } else if (!strcmp(tEntry->Name, "rotate")) {
+            myRotation = tEntry->Value;
+        } else {
+            ServoAndMotorCommandInterpreter(tEntry->Name, tEntry->Value); // only servo commands are stored
+        }
+    }
+    tNumberOfSettingsWritten = flushCameraSettings(s);
+    if (tLampChanged && lampBrightnessPercentage != -1) {
+        updateLamp();
+    }
+    Serial.printf("Profile %s applied, %d of %u entries written in %lu us\r\n", tProfile->Name, tNumberOfSettingsWritten,
+            tProfile->NumberOfEntries, micros() - tStartMicros);
+    return tNumberOfSettingsWritten;
+}
+
+/*
+ * Prints the profile names separated by comma
+ * @return number of characters printed
+ */
+int printCameraProfileNames(char *aBuffer) {
+    char *p = aBuffer;
+    for (uint_fast8_t i = 0; i < sNumberOfProfiles; ++i) {
+        if (i > 0) {
+            *p++ = ',';
+        }
+        p += sprintf(p, "%s", sProfiles[i].Name);
+    }
+    *p = '\0';
+    return p - aBuffer;
+}
@@ -0,0 +1,46 @@
+/*
+ * CameraProfiles.h
+ *
+ *  Named camera, lamp and motor profiles like "shaft" or "pipe-dark", which are stored on SPIFFS
+ *  and kept in RAM for switching all settings with one command.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _CAMERA_PROFILES_H
+#define _CAMERA_PROFILES_H
+
+#include "FS.h"
+
+#define PROFILE_FILE_PREFIX         "profile-"  // Profile "shaft" is stored in file "/profile-shaft.json"
+#define MAX_NUMBER_OF_PROFILES      6
+/*
+ * SPIFFS object names have at most 31 characters (SPIFFS_OBJ_NAME_LEN is 32 including the terminating null),
+ * "/profile-" and ".json" take 14 of them
+ */
+#define SPIFFS_MAX_FILENAME_LENGTH  31
+#define PROFILE_NAME_MAX_LENGTH     (SPIFFS_MAX_FILENAME_LENGTH + 1 - sizeof("/" PROFILE_FILE_PREFIX ".json")) // 17
+#define PROFILE_MAX_ENTRIES         32          // All 24 camera settings plus lamp, autolamp, rotate and servo commands
+
+void loadCameraProfiles(fs::FS &fs);
+bool saveCameraProfile(fs::FS &fs, const char *aProfileName);
+int applyCameraProfile(const char *aProfileName);
+int printCameraProfileNames(char *aBuffer);
+
+#endif // _CAMERA_PROFILES_H
@@ -0,0 +1,228 @@
+/*
+ * CameraSettings.cpp
+ *
+ *  Table of all camera sensor settings, which can be changed by the GUI and are stored in the preferences file.
+ *  Used by the command handler and by loadPrefs() to map a setting name to its sensor function.
+ *  All writes are done by writeCameraSetting(), which skips values already written to the sensor
+ *  and records the number of setter calls and the time spent in them.
+ *  The writes and other register accesses of other tasks are serialized by lockCameraSensor().
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <esp_timer.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "CameraSettings.h"
+
+/*
+ * Most settings have the same name as their status field and a setter taking an int
+ */
+#define CAMERA_SETTING(aName, aSetter) { #aName, \
+    [](sensor_t *aSensor, int aValue) {return aSensor->aSetter(aSensor, aValue);}, \
+    [](sensor_t *aSensor) {return (int) aSensor->status.aName;} }
+
+/*
+ * The sequence is the same as in the preferences file, framesize must be set before quality,
+ * aec before aec_value and agc before agc_gain.
+ */
+const CameraSettingStruct CameraSettings[] = {
+/*
+ * Framesize can only be changed for JPEG format
+ */
+{ "framesize", [](sensor_t *aSensor, int aValue) {
+    if (aSensor->pixformat != PIXFORMAT_JPEG) {
+        return 0;
+    }
+    return aSensor->set_framesize(aSensor, (framesize_t) aValue);
+}, [](sensor_t *aSensor) {return (int) aSensor->status.framesize;} },
+CAMERA_SETTING(quality, set_quality),
+CAMERA_SETTING(brightness, set_brightness),
+CAMERA_SETTING(contrast, set_contrast),
+CAMERA_SETTING(saturation, set_saturation),
+CAMERA_SETTING(special_effect, set_special_effect),
+CAMERA_SETTING(wb_mode, set_wb_mode),
+CAMERA_SETTING(awb, set_whitebal),
+CAMERA_SETTING(awb_gain, set_awb_gain),
+CAMERA_SETTING(aec, set_exposure_ctrl),
+CAMERA_SETTING(aec2, set_aec2),
+CAMERA_SETTING(ae_level, set_ae_level),
+CAMERA_SETTING(aec_value, set_aec_value),
+CAMERA_SETTING(agc, set_gain_ctrl),
+CAMERA_SETTING(agc_gain, set_agc_gain),
+{ "gainceiling", [](sensor_t *aSensor, int aValue) {return aSensor->set_gainceiling(aSensor, (gainceiling_t) aValue);},
+        [](sensor_t *aSensor) {return (int) aSensor->status.gainceiling;} },
+CAMERA_SETTING(bpc, set_bpc),
+CAMERA_SETTING(wpc, set_wpc),
+CAMERA_SETTING(raw_gma, set_raw_gma),
+CAMERA_SETTING(lenc, set_lenc),
+CAMERA_SETTING(vflip, set_vflip),
+CAMERA_SETTING(hmirror, set_hmirror),
+CAMERA_SETTING(dcw, set_dcw),
+CAMERA_SETTING(colorbar, set_colorbar) };
+
+const int NumberOfCameraSettings = sizeof(CameraSettings) / sizeof(CameraSettings[0]);
+
+/*
+ * @return NULL if aName is not a camera setting
+ */
+const CameraSettingStruct* findCameraSetting(const char *aName) {
+    for (int i = 0; i < NumberOfCameraSettings; ++i) {
+        if (!strcmp(aName, CameraSettings[i].Name)) {
+            return &CameraSettings[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * @return index in CameraSettings[] or -1 if aName is not a camera setting
+ */
+int findCameraSettingIndex(const char *aName) {
+    const CameraSettingStruct *tCameraSetting = findCameraSetting(aName);
+    if (tCameraSetting == NULL) {
+        return -1;
+    }
+    return tCameraSetting - CameraSettings;
+}
+
+/*
+ * Shadow of the values last written to the sensor.
+ * Each setter call results in at least one slow SCCB (I2C) transaction, so we call it only for changed values.
+ */
+static int16_t sShadowValues[NumberOfCameraSettings];
+static int16_t sPendingValues[NumberOfCameraSettings];
+static bool sIsPending[NumberOfCameraSettings];
+static bool sShadowIsValid = false;
+CameraSettingsStatisticsStruct CameraSettingsStatistics;
+/*
+ * Register accesses are not atomic, e.g. the OV2640 selects the register bank with a separate SCCB write,
+ * so the sensor must not be accessed by the http task and the loop task at the same time.
+ */
+static SemaphoreHandle_t sCameraSensorLock = NULL;
+
+/*
+ * Must be called after camera init and after all direct calls of the sensor setters
+ */
+void initCameraSettingsCache(sensor_t *aSensor) {
+    if (sCameraSensorLock == NULL) {
+        sCameraSensorLock = xSemaphoreCreateMutex();
+    }
+    for (int i = 0; i < NumberOfCameraSettings; ++i) {
+        sShadowValues[i] = CameraSettings[i].Getter(aSensor);
+        sIsPending[i] = false;
+    }
+    sShadowIsValid = true;
+}
+
+/*
+ * For direct register accesses of other modules. No-op before initCameraSettingsCache().
+ */
+void lockCameraSensor() {
+    if (sCameraSensorLock != NULL) {
+        xSemaphoreTake(sCameraSensorLock, portMAX_DELAY);
+    }
+}
+
+void unlockCameraSensor() {
+    if (sCameraSensorLock != NULL) {
+        xSemaphoreGive(sCameraSensorLock);
+    }
+}
+
+/*
+ * Calls the setter only if the value differs from the last written value.
+ * @return CAMERA_SETTING_WRITTEN, CAMERA_SETTING_UNCHANGED or CAMERA_SETTING_ERROR
+ */
+int writeCameraSetting(sensor_t *aSensor, const CameraSettingStruct *aCameraSetting, int aValue) {
+    int tIndex = aCameraSetting - CameraSettings;
+    // The shadow value may just be updated by a failed write of the other task
+    lockCameraSensor();
+    if (sShadowIsValid && sShadowValues[tIndex] == aValue) {
+        CameraSettingsStatistics.SkippedWrites++;
+        unlockCameraSensor();
+        return CAMERA_SETTING_UNCHANGED;
+    }
+    int64_t tStartMicros = esp_timer_get_time();
+    int tResult = aCameraSetting->Setter(aSensor, aValue);
+    CameraSettingsStatistics.WriteMicros += esp_timer_get_time() - tStartMicros;
+    CameraSettingsStatistics.Writes++;
+    if (tResult != 0) {
+        CameraSettingsStatistics.FailedWrites++;
+        // Value in sensor is now unknown, so take the value of the status
+        sShadowValues[tIndex] = aCameraSetting->Getter(aSensor);
+        unlockCameraSensor();
+        return CAMERA_SETTING_ERROR;
+    }
+    sShadowValues[tIndex] = aValue;
+    unlockCameraSensor();
+    return CAMERA_SETTING_WRITTEN;
+}
+
+/*
+ * Stores the value for a later flushCameraSettings(). Only the last value queued for a setting is written.
+ */
+void queueCameraSetting(int aCameraSettingIndex, int aValue) {
+    if (sIsPending[aCameraSettingIndex]) {
+        CameraSettingsStatistics.CoalescedWrites++;
+    }
+    sPendingValues[aCameraSettingIndex] = aValue;
+    sIsPending[aCameraSettingIndex] = true;
+}
+
+/*
+ * Writes all queued values in the sequence of the CameraSettings table, which respects the dependencies between the settings.
+ * @return number of settings written to the sensor
+ */
+int flushCameraSettings(sensor_t *aSensor) {
+    int tNumberOfWrites = 0;
+    for (int i = 0; i < NumberOfCameraSettings; ++i) {
+        if (sIsPending[i]) {
+            sIsPending[i] = false;
+            if (writeCameraSetting(aSensor, &CameraSettings[i], sPendingValues[i]) == CAMERA_SETTING_WRITTEN) {
+                tNumberOfWrites++;
+            }
+        }
+    }
+    return tNumberOfWrites;
+}
+
+/*
+ * @return number of characters printed
+ */
+int printCameraSettingsStatistics(char *aBuffer) {
+    return sprintf(aBuffer, "\"sensor_writes\":%lu,\"sensor_writes_skipped\":%lu,\"sensor_writes_coalesced\":%lu,"
+            "\"sensor_writes_failed\":%lu,\"sensor_write_micros\":%llu,", (unsigned long) CameraSettingsStatistics.Writes,
+            (unsigned long) CameraSettingsStatistics.SkippedWrites, (unsigned long) CameraSettingsStatistics.CoalescedWrites,
+            (unsigned long) CameraSettingsStatistics.FailedWrites, (unsigned long long) CameraSettingsStatistics.WriteMicros);
+}
+
+/*
+ * Prints all settings as JSON key value pairs, each followed by a comma
+ * @return number of characters printed
+ */
+int printCameraSettings(char *aBuffer, sensor_t *aSensor) {
+    char *p = aBuffer;
+    for (int i = 0; i < NumberOfCameraSettings; ++i) {
+        p += sprintf(p, "\"%s\":%d,", CameraSettings[i].Name, CameraSettings[i].Getter(aSensor));
+    }
+    return p - aBuffer;
+}
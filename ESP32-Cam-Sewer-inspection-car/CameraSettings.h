@@ -0,0 +1,67 @@
+/*
+ * CameraSettings.h
+ *
+ *  Table of all camera sensor settings, which can be changed by the GUI and are stored in the preferences file.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _CAMERA_SETTINGS_H
+#define _CAMERA_SETTINGS_H
+
+#include <esp_camera.h>
+
+struct CameraSettingStruct {
+    const char *Name; // Name used by GUI and preferences file
+    int (*Setter)(sensor_t *aSensor, int aValue); // returns 0 on success
+    int (*Getter)(sensor_t *aSensor); // returns the current value from aSensor->status
+};
+
+extern const CameraSettingStruct CameraSettings[];
+extern const int NumberOfCameraSettings;
+
+const CameraSettingStruct* findCameraSetting(const char *aName);
+int findCameraSettingIndex(const char *aName);
+
+#define CAMERA_SETTING_WRITTEN      1
+#define CAMERA_SETTING_UNCHANGED    0
+#define CAMERA_SETTING_ERROR        (-1)
+
+/*
+ * Each setter call is counted as one sensor write, which results in at least one SCCB transaction
+ */
+struct CameraSettingsStatisticsStruct {
+    uint32_t Writes;
+    uint32_t SkippedWrites;     // value was already written
+    uint32_t CoalescedWrites;   // queued value was overwritten by a newer one before flush
+    uint32_t FailedWrites;
+    uint64_t WriteMicros;       // time spent in setters
+};
+extern CameraSettingsStatisticsStruct CameraSettingsStatistics;
+
+void initCameraSettingsCache(sensor_t *aSensor);
+void lockCameraSensor();
+void unlockCameraSensor();
+int writeCameraSetting(sensor_t *aSensor, const CameraSettingStruct *aCameraSetting, int aValue);
+void queueCameraSetting(int aCameraSettingIndex, int aValue);
+int flushCameraSettings(sensor_t *aSensor);
+int printCameraSettingsStatistics(char *aBuffer);
+int printCameraSettings(char *aBuffer, sensor_t *aSensor);
+
+#endif // _CAMERA_SETTINGS_H
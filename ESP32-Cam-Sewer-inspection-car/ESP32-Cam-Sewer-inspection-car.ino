@@ -57,10 +57,19 @@
 #include <esp_camera.h>
 #include <esp_task_wdt.h>
 #include <WiFi.h>
+#include <Preferences.h>
 #include <DNSServer.h>
 #include <ArduinoOTA.h>
 #include "parsebytes.h"
 #include "time.h"
+#include "freertos/event_groups.h"
+#include "LoopScheduler.h"
+#include "BatteryMonitor.h"
+#include "MotorCalibration.h"
+#include "MotionEstimator.h"
+#include "AutoLampController.h"
+#include "StillSequencer.h"
+#include "MotionQueue.h"
 #if ESP_ARDUINO_VERSION >= 0x030000 // ESP_ARDUINO_VERSION_VAL(3, 0, 0), ESP_ARDUINO_VERSION_VAL disturbs the auto formatting :-(
 #include "esp_private/periph_ctrl.h"
 #endif
@@ -76,14 +85,41 @@ const bool sPanServoIsSupported = true;
 const bool sPanServoIsSupported = false;
 #endif
 
+//#define TILT_SERVO_SUPPORT   // on pin 2, together with pan it is a gimbal
+#if defined(TILT_SERVO_SUPPORT)
+const bool sTiltServoIsSupported = true;
+#else
+const bool sTiltServoIsSupported = false;
+#endif
+
 #define ONE_PWM_MOTOR_SUPPORT   // on pin 13
 #if defined(ONE_PWM_MOTOR_SUPPORT)
 const bool sOnePWMMotorIsSupported = true;
 #else
 const bool sOnePWMMotorIsSupported = false;
 #endif
-#if defined(PAN_SERVO_SUPPORT) || defined(ONE_PWM_MOTOR_SUPPORT)
-#define DO_NOT_SUPPORT_RAMP // Ramps are anyway not used if drive speed voltage (default 2.0 V) is below 2.3 V. Saves 378 bytes program memory.
+
+//#define ENCODER_ODOMETRY_SUPPORT   // on pin 3 (U0RXD), requires ONE_PWM_MOTOR_SUPPORT. Serial input is then not available.
+#if defined(ENCODER_ODOMETRY_SUPPORT)
+const bool sEncoderIsSupported = true;
+#else
+const bool sEncoderIsSupported = false;
+#endif
+
+//#define BATTERY_MONITOR_SUPPORT   // voltage divider on pin 33, the red LED must be removed. Compensates motor PWM for supply voltage.
+#if defined(BATTERY_MONITOR_SUPPORT)
+const bool sBatteryMonitorIsSupported = true;
+#else
+const bool sBatteryMonitorIsSupported = false;
+#endif
+
+//#define MOTION_ESTIMATOR_SUPPORT  // decodes a coarse image every 100 ms while driving, for stall detection and visual odometer
+#if defined(MOTION_ESTIMATOR_SUPPORT)
+const bool sMotionEstimatorIsSupported = true;
+#else
+const bool sMotionEstimatorIsSupported = false;
+#endif
+#if defined(PAN_SERVO_SUPPORT) || defined(TILT_SERVO_SUPPORT) || defined(ONE_PWM_MOTOR_SUPPORT)
 #include "MotorAndServoControl.h"
 #else
 /*
@@ -156,6 +192,9 @@ bool autoLampValue = false;         // Start value of Auto Lamp Switch on GUI (a
 #if defined(LED_DISABLE)
 #undef LED_PIN    // undefining this disables the notification LED
 #endif
+#if defined(BATTERY_MONITOR_SUPPORT) && defined(LED_PIN) && LED_PIN == BATTERY_ADC_PIN
+#undef LED_PIN    // the pin of the removed red LED is the input of the battery voltage divider
+#endif
 
 #if defined(CAM_NAME)
 const char sApplicationName[] = CAM_NAME;
@@ -224,6 +263,8 @@ const int daylightOffset_sec = 0;
 // Internal filesystem (SPIFFS)
 // used for non-volatile camera settings
 #include "storage.h"
+#include "CameraProfiles.h"
+#include "CameraSettings.h"
 
 // Sketch Info
 int sketchSize;
@@ -248,6 +289,34 @@ IPAddress ip;
 IPAddress net;
 IPAddress gw;
 
+/*
+ * Fast reconnect and roaming.
+ * BSSID and channel of the last successful connection are stored in NVS, which is available at boot
+ * without waiting for the SPIFFS mount. A direct connect to this AP is tried first, a scan is only started if this fails.
+ * Scans after boot are asynchronous, so that loop() keeps running.
+ */
+#define WIFI_FAST_CONNECT_TIMEOUT_MILLIS    3000
+#define WIFI_ROAMING_CHECK_INTERVAL_MILLIS  30000
+#define WIFI_ROAMING_RSSI_THRESHOLD         -75 // Start background scan for a better AP if RSSI is below
+#define WIFI_ROAMING_RSSI_HYSTERESIS        8   // Switch only if other AP is at least this much stronger
+struct WifiCacheStruct {
+    int8_t StationIndex; // -1 if cache is invalid
+    uint8_t Channel;
+    uint8_t BSSID[6];
+};
+WifiCacheStruct sWifiCache = { -1, 0, { 0 } };
+WifiStatisticsStruct WifiStatistics;
+
+#define WIFI_RECONNECT_IDLE             0
+#define WIFI_RECONNECT_FAST             1 // Connect to cached BSSID started
+#define WIFI_RECONNECT_SCANNING         2 // Async scan started
+#define WIFI_RECONNECT_CONNECTING       3 // Connect to best AP of scan started
+#define WIFI_ROAMING_SCANNING           4 // Async scan started while connected
+uint8_t sWifiReconnectState = WIFI_RECONNECT_IDLE;
+unsigned long sWifiReconnectStateStartMillis;
+unsigned long sWifiDisconnectMillis = 0; // 0 if not disconnected
+bool sWifiWasConnected = false;
+
 // Declare external function from app_httpd.cpp
 extern void startCameraServer(int hPort, int sPort);
 extern void serialDump();
@@ -270,16 +339,23 @@ int8_t streamCount = 0;          // Number of currently active streams
 unsigned long streamsServed = 0; // Total completed streams
 unsigned long imagesServed = 0;  // Total image requests
 
-// Camera module bus communications frequency.
-// Originally: config.xclk_freq_hz = 20000000, but this lead to visual artifacts on many modules.
-// See https://github.com/espressif/esp32-camera/issues/150#issuecomment-726473652 et al.
-#if !defined (XCLK_FREQ_HZ)
-#define XCLK_FREQ_HZ 16500000
-#endif
-
-const int lampChannel = 2; // a free PWM channel (channel 0 used by Servo, channel 4 used by PWMMotor and maybe some channels used by camera)
-const int lampPWMFrequency = 1000;  // 1K pwm frequency
-const int lampPWMResolution = 9;    // duty cycle bit range for lamp
+/*
+ * Parallel boot. WiFi connect and SPIFFS mount run as tasks, while the main task initializes the camera.
+ * Loading the preferences waits for filesystem and camera, starting the servers waits for WiFi.
+ */
+#define BOOT_WIFI_READY_BIT             0x01
+#define BOOT_FILESYSTEM_READY_BIT       0x02
+#define BOOT_FILESYSTEM_TIMEOUT_MILLIS  10000 // Do not wait longer for a hanging SPIFFS mount, use defaults instead
+EventGroupHandle_t sBootEventGroup;
+bool sFilesystemIsLate = false; // mount took longer than BOOT_FILESYSTEM_TIMEOUT_MILLIS, filesystem is false until it is mounted
+BootTimingStruct BootTiming; // milliseconds since boot of the end of each boot stage
+
+// Camera module bus communications frequency XCLK_FREQ_HZ and all PWM channels are defined here
+#include "LedcChannelMap.h"
+
+const int lampChannel = LEDC_LAMP_CHANNEL;
+int lampPWMFrequency = LEDC_LAMP_FREQUENCY; // can be changed by setLampFrequency()
+const int lampPWMResolution = LEDC_LAMP_RESOLUTION;
 const int lampPWMMax = pow(2, lampPWMResolution) - 1;
 
 // Critical error string; if set during init (camera hardware failure) it
@@ -352,6 +428,48 @@ void setLamp(int aNewPercent) {
 #endif
 }
 
+/*
+ * The duty cycle is kept by the LEDC hardware
+ * @return false if the frequency can not be generated with lampPWMResolution
+ */
+bool setLampFrequency(int aFrequency) {
+#if defined(LAMP_PIN)
+    if (aFrequency <= 0 || aFrequency > LEDC_LAMP_MAX_FREQUENCY) {
+        return false;
+    }
+#  if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(3, 0, 0)
+    uint32_t tFrequency = ledcChangeFrequency(LAMP_PIN, aFrequency, lampPWMResolution);
+#  else
+    uint32_t tFrequency = ledcChangeFrequency(lampChannel, aFrequency, lampPWMResolution);
+#  endif
+    if (tFrequency == 0) {
+        return false;
+    }
+    lampPWMFrequency = aFrequency;
+    Serial.print("Lamp frequency: ");
+    Serial.println(lampPWMFrequency);
+    return true;
+#else
+    (void) aFrequency;
+    return false;
+#endif
+}
+
+/*
+ * Switch lamp on or off according to auto lamp mode and active streams
+ */
+void updateLamp() {
+    restartAutoLamp();
+    if (autoLampValue) {
+        if (streamCount > 0)
+            setLamp(lampBrightnessPercentage);
+        else
+            setLamp(0);
+    } else {
+        setLamp(lampBrightnessPercentage);
+    }
+}
+
 void printLocalTime(bool extraData = false) {
     struct tm timeinfo;
     if (!getLocalTime(&timeinfo)) {
@@ -384,6 +502,219 @@ void calcURLs() {
 #endif
 }
 
+void readWifiCache() {
+    Preferences tPreferences;
+    tPreferences.begin("wifi-cache", true);
+    if (tPreferences.getBytes("last", &sWifiCache, sizeof(sWifiCache)) != sizeof(sWifiCache) || sWifiCache.StationIndex < firstStation
+            || sWifiCache.StationIndex >= stationCount) {
+        sWifiCache.StationIndex = -1;
+    }
+    tPreferences.end();
+}
+
+/*
+ * Store BSSID and channel of the current connection. NVS is only written if values changed.
+ */
+void saveWifiCache() {
+    WifiCacheStruct tWifiCache;
+    tWifiCache.StationIndex = -1;
+    String tSSID = WiFi.SSID();
+    for (int sta = firstStation; sta < stationCount; sta++) {
+        if (strcmp(stationList[sta].ssid, tSSID.c_str()) == 0) {
+            tWifiCache.StationIndex = sta;
+            break;
+        }
+    }
+    uint8_t *tBSSID = WiFi.BSSID();
+    if (tWifiCache.StationIndex < 0 || tBSSID == NULL) {
+        return;
+    }
+    tWifiCache.Channel = WiFi.channel();
+    memcpy(tWifiCache.BSSID, tBSSID, sizeof(tWifiCache.BSSID));
+    if (memcmp(&tWifiCache, &sWifiCache, sizeof(tWifiCache)) != 0) {
+        sWifiCache = tWifiCache;
+        Preferences tPreferences;
+        tPreferences.begin("wifi-cache", false);
+        tPreferences.putBytes("last", &sWifiCache, sizeof(sWifiCache));
+        tPreferences.end();
+        Serial.printf("Stored AP %s channel %u for fast reconnect\r\n", WiFi.BSSIDstr().c_str(), sWifiCache.Channel);
+    }
+}
+
+/*
+ * Evaluates the results of the last scan
+ * @return index of the known station with the strongest RSSI or -1
+ */
+int findBestKnownNetwork(int aNumberOfNetworks, char *aSSID, uint8_t *aBSSID, uint8_t *aChannel, long *aRSSI) {
+    int tBestStation = -1;
+    *aRSSI = -1024;
+    for (int i = 0; i < aNumberOfNetworks; ++i) {
+        // Print SSID and RSSI for each network found
+        String thisSSID = WiFi.SSID(i); // call method of WiFiScanClass
+        int thisRSSI = WiFi.RSSI(i);
+        String thisBSSID = WiFi.BSSIDstr(i);
+        Serial.printf("%3i : [%s] %s (%i)", i + 1, thisBSSID.c_str(), thisSSID.c_str(), thisRSSI);
+        // Scan our list of known external stations
+        for (int sta = firstStation; sta < stationCount; sta++) {
+            if ((strcmp(stationList[sta].ssid, thisSSID.c_str()) == 0) || (strcmp(stationList[sta].ssid, thisBSSID.c_str()) == 0)) {
+                Serial.print("  -  Known!");
+                // Chose the strongest RSSI seen
+                if (thisRSSI > *aRSSI) {
+                    tBestStation = sta;
+                    strncpy(aSSID, thisSSID.c_str(), 64);
+                    // Convert char bssid[] to a byte array
+                    parseBytes(thisBSSID.c_str(), ':', aBSSID, 6, 16);
+                    *aChannel = WiFi.channel(i);
+                    *aRSSI = thisRSSI;
+                }
+            }
+        }
+        Serial.println();
+    }
+    return tBestStation;
+}
+
+/*
+ * Measure the time from disconnect to got IP for each reconnect
+ */
+void onWifiEvent(WiFiEvent_t aEvent) {
+    if (aEvent == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+        if (sWifiWasConnected && sWifiDisconnectMillis == 0) {
+            sWifiDisconnectMillis = millis();
+            if (sWifiDisconnectMillis == 0) {
+                sWifiDisconnectMillis = 1;
+            }
+        }
+    } else if (aEvent == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        sWifiWasConnected = true;
+        if (sWifiDisconnectMillis != 0) {
+            unsigned long tReconnectMillis = millis() - sWifiDisconnectMillis;
+            sWifiDisconnectMillis = 0;
+            WifiStatistics.Reconnects++;
+            WifiStatistics.LastReconnectMillis = tReconnectMillis;
+            if (WifiStatistics.MaxReconnectMillis < tReconnectMillis) {
+                WifiStatistics.MaxReconnectMillis = tReconnectMillis;
+            }
+            Serial.printf("WiFi reconnected after %lu ms\r\n", tReconnectMillis);
+        }
+    }
+}
+
+/*
+ * Called by loop() while disconnected in client mode. Never blocks.
+ * First tries the last AP, then does an async scan and connects to the best known AP.
+ */
+void handleWifiReconnect() {
+    unsigned long tMillisInState = millis() - sWifiReconnectStateStartMillis;
+    switch (sWifiReconnectState) {
+    case WIFI_RECONNECT_IDLE:
+    case WIFI_ROAMING_SCANNING:
+        if (sWifiReconnectState == WIFI_ROAMING_SCANNING) {
+            WiFi.scanDelete();
+        }
+        if (sWifiCache.StationIndex >= 0) {
+            Serial.println("Fast reconnect to last AP");
+            WiFi.begin(stationList[sWifiCache.StationIndex].ssid, stationList[sWifiCache.StationIndex].password, sWifiCache.Channel,
+                    sWifiCache.BSSID);
+            WifiStatistics.FastConnects++;
+            sWifiReconnectState = WIFI_RECONNECT_FAST;
+        } else {
+            Serial.println("Starting async scan for known networks");
+            WiFi.scanNetworks(true);
+            WifiStatistics.Scans++;
+            sWifiReconnectState = WIFI_RECONNECT_SCANNING;
+        }
+        sWifiReconnectStateStartMillis = millis();
+        break;
+
+    case WIFI_RECONNECT_FAST:
+        if (tMillisInState > WIFI_FAST_CONNECT_TIMEOUT_MILLIS) {
+            Serial.println("Fast reconnect failed, starting async scan for known networks");
+            WiFi.disconnect();
+            WiFi.scanNetworks(true);
+            WifiStatistics.Scans++;
+            sWifiReconnectState = WIFI_RECONNECT_SCANNING;
+            sWifiReconnectStateStartMillis = millis();
+        }
+        break;
+
+    case WIFI_RECONNECT_SCANNING: {
+        int tNumberOfNetworks = WiFi.scanComplete();
+        if (tNumberOfNetworks == WIFI_SCAN_RUNNING) {
+            break;
+        }
+        char tSSID[65] = "";
+        uint8_t tBSSID[6];
+        uint8_t tChannel = 0;
+        long tRSSI;
+        int tStation = -1;
+        if (tNumberOfNetworks > 0) {
+            tStation = findBestKnownNetwork(tNumberOfNetworks, tSSID, tBSSID, &tChannel, &tRSSI);
+        }
+        WiFi.scanDelete();
+        if (tStation < 0) {
+            // Nothing found, scan again
+            WiFi.scanNetworks(true);
+            WifiStatistics.Scans++;
+            sWifiReconnectStateStartMillis = millis();
+        } else {
+            Serial.printf("Connecting to %s on channel %u\r\n", tSSID, tChannel);
+            WiFi.begin(tSSID, stationList[tStation].password, tChannel, tBSSID);
+            sWifiReconnectState = WIFI_RECONNECT_CONNECTING;
+            sWifiReconnectStateStartMillis = millis();
+        }
+        break;
+    }
+
+    case WIFI_RECONNECT_CONNECTING:
+        if (tMillisInState > WIFI_WATCHDOG) {
+            WiFi.disconnect();
+            WiFi.scanNetworks(true);
+            WifiStatistics.Scans++;
+            sWifiReconnectState = WIFI_RECONNECT_SCANNING;
+            sWifiReconnectStateStartMillis = millis();
+        }
+        break;
+    }
+}
+
+/*
+ * Called by loop() while connected in client mode. Never blocks.
+ * If RSSI is weak, do an async scan and switch to a known AP or repeater, which is significantly stronger.
+ */
+void checkWifiRoaming() {
+    static unsigned long sLastRoamingCheckMillis;
+    if (sWifiReconnectState == WIFI_ROAMING_SCANNING) {
+        int tNumberOfNetworks = WiFi.scanComplete();
+        if (tNumberOfNetworks == WIFI_SCAN_RUNNING) {
+            return;
+        }
+        sWifiReconnectState = WIFI_RECONNECT_IDLE;
+        if (tNumberOfNetworks > 0) {
+            char tSSID[65] = "";
+            uint8_t tBSSID[6];
+            uint8_t tChannel = 0;
+            long tRSSI;
+            int tStation = findBestKnownNetwork(tNumberOfNetworks, tSSID, tBSSID, &tChannel, &tRSSI);
+            long tCurrentRSSI = WiFi.RSSI();
+            if (tStation >= 0 && memcmp(tBSSID, WiFi.BSSID(), sizeof(tBSSID)) != 0
+                    && tRSSI > tCurrentRSSI + WIFI_ROAMING_RSSI_HYSTERESIS) {
+                Serial.printf("Roaming from RSSI %ld to %s channel %u RSSI %ld\r\n", tCurrentRSSI, tSSID, tChannel, tRSSI);
+                WifiStatistics.Roams++;
+                WiFi.begin(tSSID, stationList[tStation].password, tChannel, tBSSID);
+            }
+        }
+        WiFi.scanDelete();
+    } else if (millis() - sLastRoamingCheckMillis > WIFI_ROAMING_CHECK_INTERVAL_MILLIS) {
+        sLastRoamingCheckMillis = millis();
+        if (WiFi.RSSI() < WIFI_ROAMING_RSSI_THRESHOLD) {
+            WiFi.scanNetworks(true);
+            WifiStatistics.Scans++;
+            sWifiReconnectState = WIFI_ROAMING_SCANNING;
+        }
+    }
+}
+
 void WifiSetup() {
     // Feedback that we are now attempting to connect
     flashLED(300);
@@ -394,6 +725,12 @@ void WifiSetup() {
     // Disable power saving on WiFi to improve responsiveness 
     // (https://github.com/espressif/arduino-esp32/issues/1484)
     WiFi.setSleep(false);
+    static bool sWifiIsInitialized = false;
+    if (!sWifiIsInitialized) {
+        sWifiIsInitialized = true;
+        WiFi.onEvent(onWifiEvent);
+        readWifiCache();
+    }
 
     Serial.print("Known external SSIDs: ");
     if (stationCount > firstStation) {
@@ -411,34 +748,26 @@ void WifiSetup() {
     long bestRSSI = -1024;
     char bestSSID[65] = "";
     uint8_t bestBSSID[6];
+    uint8_t bestChannel = 0; // 0 is 'auto'
+    bool tIsFastConnect = false;
     if (stationCount > firstStation) {
-        // We have a list to scan 
-        Serial.printf("Scanning local Wifi Networks\r\n");
-        int stationsFound = WiFi.scanNetworks();
-        Serial.printf("%i networks found\r\n", stationsFound);
-        if (stationsFound > 0) {
-            for (int i = 0; i < stationsFound; ++i) {
-                // Print SSID and RSSI for each network found
-                String thisSSID = WiFi.SSID(i); // call method of WiFiScanClass
-                int thisRSSI = WiFi.RSSI(i);
-                String thisBSSID = WiFi.BSSIDstr(i);
-                Serial.printf("%3i : [%s] %s (%i)", i + 1, thisBSSID.c_str(), thisSSID.c_str(), thisRSSI);
-                // Scan our list of known external stations
-                for (int sta = firstStation; sta < stationCount; sta++) {
-                    if ((strcmp(stationList[sta].ssid, thisSSID.c_str()) == 0)
-                            || (strcmp(stationList[sta].ssid, thisBSSID.c_str()) == 0)) {
-                        Serial.print("  -  Known!");
-                        // Chose the strongest RSSI seen
-                        if (thisRSSI > bestRSSI) {
-                            bestStation = sta;
-                            strncpy(bestSSID, thisSSID.c_str(), 64);
-                            // Convert char bssid[] to a byte array
-                            parseBytes(thisBSSID.c_str(), ':', bestBSSID, 6, 16);
-                            bestRSSI = thisRSSI;
-                        }
-                    }
-                }
-                Serial.println();
+        if (sWifiCache.StationIndex >= 0) {
+            // Try the AP of the last successful connection first, without scanning
+            bestStation = sWifiCache.StationIndex;
+            strncpy(bestSSID, stationList[bestStation].ssid, 64);
+            memcpy(bestBSSID, sWifiCache.BSSID, sizeof(bestBSSID));
+            bestChannel = sWifiCache.Channel;
+            tIsFastConnect = true;
+            WifiStatistics.FastConnects++;
+            Serial.println("Trying fast connect to last AP");
+        } else {
+            // We have a list to scan
+            Serial.printf("Scanning local Wifi Networks\r\n");
+            int stationsFound = WiFi.scanNetworks();
+            WifiStatistics.Scans++;
+            Serial.printf("%i networks found\r\n", stationsFound);
+            if (stationsFound > 0) {
+                bestStation = findBestKnownNetwork(stationsFound, bestSSID, bestBSSID, &bestChannel, &bestRSSI);
             }
         }
     } else {
@@ -491,13 +820,16 @@ void WifiSetup() {
 #endif
 
         // Initiate network connection request (3rd argument, channel = 0 is 'auto')
-        WiFi.begin(bestSSID, stationList[bestStation].password, 0, bestBSSID);
+        WiFi.begin(bestSSID, stationList[bestStation].password, bestChannel, bestBSSID);
 
         // Wait to connect, or timeout
         unsigned long start = millis();
-        while ((millis() - start <= WIFI_WATCHDOG) && (WiFi.status() != WL_CONNECTED)) {
-            delay(500);
-            Serial.print('.');
+        unsigned long tTimeout = tIsFastConnect ? WIFI_FAST_CONNECT_TIMEOUT_MILLIS : WIFI_WATCHDOG;
+        while ((millis() - start <= tTimeout) && (WiFi.status() != WL_CONNECTED)) {
+            delay(100);
+            if ((millis() - start) % 500 < 100) {
+                Serial.print('.');
+            }
         }
         // If we have connected, inform user
         if (WiFi.status() == WL_CONNECTED) {
@@ -511,6 +843,7 @@ void WifiSetup() {
             Serial.printf("Netmask   : %d.%d.%d.%d\r\n", net[0], net[1], net[2], net[3]);
             Serial.printf("Gateway   : %d.%d.%d.%d\r\n", gw[0], gw[1], gw[2], gw[3]);
             calcURLs();
+            saveWifiCache();
             // Flash the LED 4 times to show we are connected
             for (int i = 0; i < 4; i++) {
                 flashLED(50);
@@ -519,6 +852,9 @@ void WifiSetup() {
         } else {
             Serial.println("Client connection Failed");
             WiFi.disconnect();   // (resets the WiFi scan)
+            if (tIsFastConnect) {
+                sWifiCache.StationIndex = -1; // scan at next call
+            }
         }
     }
 
@@ -575,6 +911,32 @@ void WifiSetup() {
         }
     }
 }
+/*
+ * Connect to WiFi or start AccessPoint, running in parallel to camera init
+ */
+void wifiBootTask(void *aParameter) {
+    (void) aParameter;
+    while ((WiFi.status() != WL_CONNECTED) && !sInAccesspointMode) {
+        WifiSetup();
+        delay(1000);
+    }
+    BootTiming.WifiReadyMillis = millis();
+    xEventGroupSetBits(sBootEventGroup, BOOT_WIFI_READY_BIT);
+    vTaskDelete(NULL);
+}
+
+/*
+ * Mount SPIFFS, running in parallel to camera init
+ */
+void filesystemBootTask(void *aParameter) {
+    (void) aParameter;
+    filesystemStart();
+    BootTiming.FilesystemReadyMillis = millis();
+    xEventGroupSetBits(sBootEventGroup, BOOT_FILESYSTEM_READY_BIT);
+    wakeLoopScheduler(); // for a late mount
+    vTaskDelete(NULL);
+}
+
 void setup() {
 #if defined(LED_PIN)  // If we have a notification LED, set it to output
     pinMode(LED_PIN, OUTPUT);
@@ -609,10 +971,19 @@ void setup() {
     digitalWrite(LED_PIN, LED_ON);
 #endif
 
+    /*
+     * Start the independent boot stages. WiFi runs on core 0 with the WiFi stack, SPIFFS on core 1 with us.
+     */
+    sBootEventGroup = xEventGroupCreate();
+    xTaskCreatePinnedToCore(wifiBootTask, "WiFiBoot", 6144, NULL, 1, NULL, 0);
+    if (filesystem) {
+        xTaskCreatePinnedToCore(filesystemBootTask, "FSBoot", 4096, NULL, 1, NULL, 1);
+    }
+
     // Create camera config structure; and populate with hardware and other defaults 
     camera_config_t config;
-    config.ledc_channel = LEDC_CHANNEL_0;
-    config.ledc_timer = LEDC_TIMER_0;
+    config.ledc_channel = (ledc_channel_t) LEDC_CAMERA_XCLK_CHANNEL;
+    config.ledc_timer = (ledc_timer_t) LEDC_CAMERA_XCLK_TIMER;
     config.pin_d0 = Y2_GPIO_NUM;
     config.pin_d1 = Y3_GPIO_NUM;
     config.pin_d2 = Y4_GPIO_NUM;
@@ -779,10 +1150,21 @@ void setup() {
         //s->set_dcw(s, 1);             // 0 = disable , 1 = enable
         //s->set_colorbar(s, 0);        // 0 = disable , 1 = enable
         // We now have camera with default init
+        initCameraSettingsCache(s);
+        BootTiming.CameraReadyMillis = millis();
         // check for saved preferences and apply them
         if (filesystem) {
-            filesystemStart();
-            loadPrefs(SPIFFS);
+            if (xEventGroupWaitBits(sBootEventGroup, BOOT_FILESYSTEM_READY_BIT, pdFALSE, pdTRUE,
+                    pdMS_TO_TICKS(BOOT_FILESYSTEM_TIMEOUT_MILLIS)) & BOOT_FILESYSTEM_READY_BIT) {
+                loadPrefs(SPIFFS);
+                loadCameraProfiles(SPIFFS);
+                BootTiming.PreferencesLoadedMillis = millis();
+            } else {
+                Serial.println("Internal Filesystem not mounted in time, using system defaults until it is mounted");
+                // Otherwise saving the preferences would overwrite the file with the defaults
+                filesystem = false;
+                sFilesystemIsLate = true;
+            }
         } else {
             Serial.println("No Internal Filesystem, cannot load or save preferences");
         }
@@ -812,11 +1194,8 @@ void setup() {
         Serial.println("No lamp, or lamp disabled in config");
     }
 
-    // Having got this far; start Wifi and loop until we are connected or have started an AccessPoint
-    while ((WiFi.status() != WL_CONNECTED) && !sInAccesspointMode) {
-        WifiSetup();
-        delay(1000);
-    }
+    // Having got this far; wait for the WiFi task until we are connected or have started an AccessPoint
+    xEventGroupWaitBits(sBootEventGroup, BOOT_WIFI_READY_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
 
     if (otaEnabled) {
         // Start OTA once connected
@@ -882,8 +1261,23 @@ void setup() {
         Serial.println("Time functions disabled");
     }
 
+    // Before starting the server, which may send motor commands
+    initServoAndMotorPinsAndChannels(sInAccesspointMode);
+    if (sOnePWMMotorIsSupported && filesystem && (xEventGroupGetBits(sBootEventGroup) & BOOT_FILESYSTEM_READY_BIT)) {
+        loadMotorCalibration(SPIFFS); // after motor init, since it changes MillisPerCentimeter
+    }
+    initMotionQueue();
+    initStillSequencer();
+    if (sMotionEstimatorIsSupported) {
+        initMotionEstimator();
+    }
+
     // Now we have a network we can start the two http handlers for the UI and Stream.
     startCameraServer(httpPort, streamPort);
+    BootTiming.ServerStartedMillis = millis();
+    Serial.printf("Boot timing [ms]: camera=%lu filesystem=%lu preferences=%lu wifi=%lu server=%lu\r\n",
+            BootTiming.CameraReadyMillis, BootTiming.FilesystemReadyMillis, BootTiming.PreferencesLoadedMillis,
+            BootTiming.WifiReadyMillis, BootTiming.ServerStartedMillis);
 
     if (critERR.length() == 0) {
         Serial.printf("\r\nCamera Ready!\r\nUse '%s' to connect\r\n", httpURL);
@@ -908,66 +1302,108 @@ void setup() {
         Serial.read();
     }
 
-    initServoAndMotorPinsAndChannels(sInAccesspointMode);
+    initLoopScheduler(sLoopTasks, sizeof(sLoopTasks) / sizeof(sLoopTasks[0]));
 
     // While in Beta; Warn!
     Serial.print("\r\nThis is the 4.0 alpha\r\n - Face detection has been removed!\r\n");
 }
 
-void loop() {
-    /* 
-     *  Just loop forever, reconnecting Wifi As necessary in client mode
-     * The stream and URI handler processes initiated by the startCameraServer() call at the
-     * end of setup() will handle the camera and UI processing from now on.
-     */
+/*
+ * Tasks of the loop scheduler. Each returns the milliseconds until it wants to run again.
+ */
+uint32_t otaLoopTask() {
+    if (otaEnabled) {
+        ArduinoOTA.handle();
+        return 50;
+    }
+    return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+}
+
+/*
+ * Loads the preferences, profiles and motor calibration, if SPIFFS was mounted after BOOT_FILESYSTEM_TIMEOUT_MILLIS
+ */
+uint32_t lateFilesystemLoopTask() {
+    if (!sFilesystemIsLate || !(xEventGroupGetBits(sBootEventGroup) & BOOT_FILESYSTEM_READY_BIT)) {
+        return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+    }
+    sFilesystemIsLate = false;
+    Serial.println("Internal Filesystem mounted late, loading preferences now");
+    loadPrefs(SPIFFS);
+    loadCameraProfiles(SPIFFS);
+    if (sOnePWMMotorIsSupported) {
+        loadMotorCalibration(SPIFFS);
+    }
+    BootTiming.PreferencesLoadedMillis = millis();
+    if (lampBrightnessPercentage != -1) {
+        updateLamp();
+    }
+    filesystem = true;
+    return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+}
+
+uint32_t serialLoopTask() {
+    handleSerial();
+    return 100;
+}
+
+uint32_t dnsLoopTask() {
+    if (sCaptivePortalEnabled) {
+        dnsServer.processNextRequest();
+        return 20;
+    }
+    return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+}
+
+/*
+ * Client mode can fail, so reconnect as appropriate. The accesspoint is permanently up.
+ */
+uint32_t wifiLoopTask() {
+    static bool warned = false;
     if (sInAccesspointMode) {
-        // Accespoint is permanently up, so just loop, servicing the captive portal as needed
-        // Rather than loop forever, follow the watchdog, in case we later add auto re-scan.
-        unsigned long start = millis();
-        while (millis() - start < WIFI_WATCHDOG) {
-            delay(100);
-            if (otaEnabled) {
-                ArduinoOTA.handle();
-            }
-            handleSerial();
-            updateMotor();
-            checkForAttention();
-            if (sCaptivePortalEnabled) {
-                dnsServer.processNextRequest();
-            }
+        return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+    }
+    if (WiFi.status() == WL_CONNECTED) {
+        if (warned) {
+            // Tell the user if we have just reconnected
+            Serial.println("WiFi reconnected");
+            warned = false;
         }
-    } else {
-        // client mode can fail; so reconnect as appropriate 
-        static bool warned = false;
-        if (WiFi.status() == WL_CONNECTED) {
-            // We are connected, wait a bit and re-check
-            if (warned) {
-                // Tell the user if we have just reconnected 
-                Serial.println("WiFi reconnected");
-                warned = false;
-            }
-            // loop here for WIFI_WATCHDOG, turning debugData true/false depending on serial input..
-            unsigned long start = millis();
-            while (millis() - start < WIFI_WATCHDOG) {
-                delay(100);
-                if (otaEnabled) {
-                    ArduinoOTA.handle();
-                }
-                handleSerial();
-                updateMotor();
-                checkForAttention();
-            }
-        } else {
-            /*
-             * disconnected; attempt to reconnect
-             */
-            if (!warned) {
-                // Tell the user if we just disconnected
-                WiFi.disconnect();  // ensures disconnect is complete, wifi scan cleared
-                Serial.println("WiFi disconnected, retrying");
-                warned = true;
-            }
-            WifiSetup();
+        if (sWifiReconnectState != WIFI_ROAMING_SCANNING) {
+            sWifiReconnectState = WIFI_RECONNECT_IDLE;
+        }
+        saveWifiCache();
+        checkWifiRoaming();
+        if (sWifiReconnectState == WIFI_ROAMING_SCANNING) {
+            return 100; // poll for end of scan
         }
+        return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+    }
+    /*
+     * disconnected; attempt to reconnect without blocking the loop
+     */
+    if (!warned) {
+        // Tell the user if we just disconnected
+        Serial.println("WiFi disconnected, retrying");
+        warned = true;
     }
+    handleWifiReconnect();
+    return 100;
+}
+
+/*
+ * The motor is not handled here, it is updated by its own timer
+ */
+LoopTaskStruct sLoopTasks[] = { { "motion", runMotionQueue, true }, { "attention", checkForAttention, true }, { "dns",
+        dnsLoopTask, false }, { "ota", otaLoopTask, false }, { "serial", serialLoopTask, false }, { "wifi", wifiLoopTask, false }, {
+        "battery", batteryLoopTask, false }, { "calibration", motorCalibrationLoopTask, true }, {
+        "lamp", autoLampLoopTask, false }, { "stills", stillSequencerLoopTask, true }, { "filesystem", lateFilesystemLoopTask,
+        true } };
+
+void loop() {
+    /*
+     * The stream and URI handler processes initiated by the startCameraServer() call at the
+     * end of setup() will handle the camera and UI processing from now on.
+     * Here we only run the tasks for motion queue, servo, OTA, DNS, serial and WiFi when they are due and sleep otherwise.
+     */
+    runLoopScheduler();
 }
@@ -78,7 +78,7 @@ ESP32PWM::~ESP32PWM() {
 	deallocate();
 }
 
-double ESP32PWM::_ledcSetupTimerFreq(uint8_t pin, double freq,
+uint32_t ESP32PWM::_ledcSetupTimerFreq(uint8_t pin, long freq,
 		uint8_t bit_num, uint8_t channel) {
 
 #ifdef ESP_ARDUINO_VERSION_MAJOR
@@ -105,8 +105,26 @@ int ESP32PWM::timerAndIndexToChannel(int timerNum, int index) {
 	}
 	return -1;
 }
-int ESP32PWM::allocatenext(double freq) {
-	long freqlocal = (long) freq;
+int ESP32PWM::allocatenext(long freq) {
+	long freqlocal = freq;
+	if (pwmChannel < 0 && !isMCPWM && fixedChannel >= 0) {
+		// Channel is given by the caller, no search required
+		int fixedTimer = (fixedChannel / 2) % 4;
+		if (fixedChannel >= NUM_PWM || ChannelUsed[fixedChannel] != NULL
+				|| (timerFreqSet[fixedTimer] != -1 && timerFreqSet[fixedTimer] != freqlocal)) {
+			ESP_LOGE(TAG, "ERROR Fixed PWM channel %d is not available for %ld Hz", fixedChannel, freq);
+			timerNum = -1;
+			return -1;
+		}
+		timerFreqSet[fixedTimer] = freqlocal;
+		timerNum = fixedTimer;
+		pwmChannel = fixedChannel;
+		ChannelUsed[pwmChannel] = this;
+		timerCount[timerNum]++;
+		PWMCount++;
+		myFreq = freq;
+		return pwmChannel;
+	}
 	if (pwmChannel < 0 && !isMCPWM) {  // not yet allocated
 		if (useVariableFrequency) {
 			// try LEDC first
@@ -206,8 +224,9 @@ int ESP32PWM::allocatenext(double freq) {
 	} else {
 		return pwmChannel;
 	}
-	ESP_LOGE(TAG, "ERROR All PWM timers allocated! Can't accomodate %.3f Hz\r\nHalting...", freq);
-	while (1);
+	ESP_LOGE(TAG, "ERROR All PWM timers allocated! Can't accomodate %ld Hz", freq);
+	timerNum = -1;
+	return -1;
 }
 void ESP32PWM::deallocate() {
 	if (isMCPWM) {
@@ -254,9 +273,11 @@ int ESP32PWM::getChannel() {
 	return pwmChannel;
 }
 
-double ESP32PWM::setup(double freq, uint8_t resolution_bits) {
+uint32_t ESP32PWM::setup(long freq, uint8_t resolution_bits) {
 	if (!isMCPWM) {
-		checkFrequencyForSideEffects(freq);
+		if (!checkFrequencyForSideEffects(freq)) {
+			return 0; // same as ledcSetup() for failure
+		}
 	}
 
 	resolutionBits = resolution_bits;
@@ -278,14 +299,14 @@ double ESP32PWM::setup(double freq, uint8_t resolution_bits) {
 #ifdef ESP_ARDUINO_VERSION_MAJOR
 #if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(3, 0, 0)
 			ledcDetach(pin);
-			double val = ledcAttachChannel(getPin(), freq, resolution_bits, getChannel());
+			ledcAttachChannel(getPin(), freq, resolution_bits, getChannel());
 #else
 			ledcDetachPin(pin);
-			double val = ledcSetup(getChannel(), freq, resolution_bits);
+			ledcSetup(getChannel(), freq, resolution_bits);
 #endif
 #else
 			ledcDetachPin(pin);
-			double val = ledcSetup(getChannel(), freq, resolution_bits);
+			ledcSetup(getChannel(), freq, resolution_bits);
 #endif
 		}
 		attachPin(pin);
@@ -316,12 +337,21 @@ double ESP32PWM::setup(double freq, uint8_t resolution_bits) {
 #endif
 	}
 }
+// Same results as with mapf(), including its clipping, but with only one double operation
 double ESP32PWM::getDutyScaled() {
-	return mapf((double) myDuty, 0, (double) ((1 << resolutionBits) - 1), 0.0,
-			1.0);
+	uint32_t maxDuty = (1 << resolutionBits) - 1;
+	if (myDuty >= maxDuty)
+		return 1.0;
+	return (double) myDuty / maxDuty;
 }
 void ESP32PWM::writeScaled(double duty) {
-	write(mapf(duty, 0.0, 1.0, 0, (double) ((1 << resolutionBits) - 1)));
+	uint32_t maxDuty = (1 << resolutionBits) - 1;
+	if (duty >= 1.0)
+		write(maxDuty);
+	else if (duty > 0.0)
+		write(duty * maxDuty);
+	else
+		write(0); // also for NaN
 }
 void ESP32PWM::write(uint32_t duty) {
 	myDuty = duty;
@@ -346,8 +376,9 @@ void ESP32PWM::write(uint32_t duty) {
 #endif
 	}
 }
-void ESP32PWM::adjustFrequencyLocal(double freq, double dutyScaled) {
-	timerFreqSet[getTimer()] = (long) freq;
+// The raw duty is kept, the frequency change does not change the resolution
+void ESP32PWM::adjustFrequencyLocal(long freq, uint32_t duty) {
+	timerFreqSet[getTimer()] = freq;
 	myFreq = freq;
 	if (attached()) {
 #ifdef ESP_ARDUINO_VERSION_MAJOR
@@ -355,26 +386,26 @@ void ESP32PWM::adjustFrequencyLocal(double freq, double dutyScaled) {
 		ledcDetach(pin);
 		// Remove the PWM during frequency adjust
 		_ledcSetupTimerFreq(getPin(), freq, resolutionBits, getChannel());
-		writeScaled(dutyScaled);
+		write(duty);
 		ledcAttachChannel(getPin(), freq, resolutionBits, getChannel()); // re-attach the pin after frequency adjust
 #else
 		ledcDetachPin(pin);
 		// Remove the PWM during frequency adjust
 		_ledcSetupTimerFreq(getPin(), freq, resolutionBits, getChannel());
-		writeScaled(dutyScaled);
+		write(duty);
 		ledcAttachPin(pin, getChannel()); // re-attach the pin after frequency adjust
 #endif
 #else
 		ledcDetachPin(pin);
 		// Remove the PWM during frequency adjust
 		_ledcSetupTimerFreq(getPin(), freq, resolutionBits, getChannel());
-		writeScaled(dutyScaled);
+		write(duty);
 		ledcAttachPin(pin, getChannel()); // re-attach the pin after frequency adjust
 #endif
 
 	} else {
 		_ledcSetupTimerFreq(getPin(), freq, resolutionBits, getChannel());
-		writeScaled(dutyScaled);
+		write(duty);
 	}
 }
 void ESP32PWM::adjustFrequency(double freq, double dutyScaled) {
@@ -382,16 +413,16 @@ void ESP32PWM::adjustFrequency(double freq, double dutyScaled) {
 		ESP_LOGE(TAG, "ERROR: Cannot change frequency on fixed-frequency PWM channel (pin %d). Frequency is locked for shared timer operation.", pin);
 		return;
 	}
-	if(dutyScaled<0)
-		dutyScaled=getDutyScaled();
-	writeScaled(dutyScaled);
+	long freqlocal = freq; // the only double operation, the timers have integer frequencies
+	if (dutyScaled >= 0)
+		writeScaled(dutyScaled); // else keep the raw duty
 	if (isMCPWM) {
 #if defined(CONFIG_IDF_TARGET_ESP32S3)
-		mcpwmTimers[mcpwmUnit][mcpwmTimer].freq = (long)freq;
-		myFreq = freq;
+		mcpwmTimers[mcpwmUnit][mcpwmTimer].freq = freqlocal;
+		myFreq = freqlocal;
 		// re-init timer with new freq
 		mcpwm_config_t pwm_config;
-		pwm_config.frequency = freq;
+		pwm_config.frequency = freqlocal;
 		pwm_config.cmpr_a = 0;
 		pwm_config.cmpr_b = 0;
 		pwm_config.counter_mode = MCPWM_UP_COUNTER;
@@ -402,8 +433,8 @@ void ESP32PWM::adjustFrequency(double freq, double dutyScaled) {
 		// update all operators on this timer
 		for (int i = 0; i < mcpwmTimers[mcpwmUnit][mcpwmTimer].operatorCount; i++) {
 			if (mcpwmTimers[mcpwmUnit][mcpwmTimer].operators[i] != NULL) {
-				mcpwmTimers[mcpwmUnit][mcpwmTimer].operators[i]->myFreq = freq;
-				mcpwmTimers[mcpwmUnit][mcpwmTimer].operators[i]->writeScaled(mcpwmTimers[mcpwmUnit][mcpwmTimer].operators[i]->getDutyScaled());
+				mcpwmTimers[mcpwmUnit][mcpwmTimer].operators[i]->myFreq = freqlocal;
+				mcpwmTimers[mcpwmUnit][mcpwmTimer].operators[i]->write(mcpwmTimers[mcpwmUnit][mcpwmTimer].operators[i]->myDuty);
 			}
 		}
 #endif
@@ -411,24 +442,25 @@ void ESP32PWM::adjustFrequency(double freq, double dutyScaled) {
 		for (int i = 0; i < timerCount[getTimer()]; i++) {
 			int pwm = timerAndIndexToChannel(getTimer(), i);
 			if (ChannelUsed[pwm] != NULL) {
-				if (ChannelUsed[pwm]->myFreq != freq) {
-					ChannelUsed[pwm]->adjustFrequencyLocal(freq,
-							ChannelUsed[pwm]->getDutyScaled());
+				if (ChannelUsed[pwm]->myFreq != freqlocal) {
+					ChannelUsed[pwm]->adjustFrequencyLocal(freqlocal,
+							ChannelUsed[pwm]->myDuty);
 				}
 			}
 		}
 	}
 }
 double ESP32PWM::writeTone(double freq) {
+	long freqlocal = freq;
 	if (isMCPWM) {
 		adjustFrequency(freq, 0.5);
 	} else {
 		for (int i = 0; i < timerCount[getTimer()]; i++) {
 			int pwm = timerAndIndexToChannel(getTimer(), i);
 			if (ChannelUsed[pwm] != NULL) {
-				if (ChannelUsed[pwm]->myFreq != freq) {
-					ChannelUsed[pwm]->adjustFrequencyLocal(freq,
-							ChannelUsed[pwm]->getDutyScaled());
+				if (ChannelUsed[pwm]->myFreq != freqlocal) {
+					ChannelUsed[pwm]->adjustFrequencyLocal(freqlocal,
+							ChannelUsed[pwm]->myDuty);
 				}
 				write(1 << (resolutionBits-1)); // writeScaled(0.5);
 			}
@@ -522,8 +554,12 @@ void ESP32PWM::attachPin(uint8_t pin, double freq, uint8_t resolution_bits) {
 
 	if (hasPwm(pin)){
         this->pin = pin;
-		int ret=setup(freq, resolution_bits);
+		int ret=setup((long) freq, resolution_bits);
 		ESP_LOGI(TAG, "Pin Setup %d with code %d",pin,ret);
+		if (pwmChannel < 0 && !isMCPWM) {
+			ESP_LOGE(TAG, "ERROR No PWM channel for pin %d", pin);
+			return;
+		}
 	  attachPin(pin);
 	}
 	else
@@ -564,9 +600,14 @@ void ESP32PWM::detachPin(int pin) {
  ** ledc: 15 => Group: 1, Channel: 7, Timer: 3
  */
 
-bool ESP32PWM::checkFrequencyForSideEffects(double freq) {
+bool ESP32PWM::checkFrequencyForSideEffects(long freq) {
 
-	allocatenext(freq);
+	if (allocatenext(freq) < 0) {
+		return false; // no channel available
+	}
+	if (isMCPWM) {
+		return true; // no shared LEDC timer
+	}
 	for (int i = 0; i < timerCount[getTimer()]; i++) {
 		int pwm = timerAndIndexToChannel(getTimer(), i);
 
@@ -574,14 +615,13 @@ bool ESP32PWM::checkFrequencyForSideEffects(double freq) {
 			continue;
 		if (ChannelUsed[pwm] != NULL)
 			if (ChannelUsed[pwm]->getTimer() == getTimer()) {
-				double diff = abs(ChannelUsed[pwm]->myFreq - freq);
-				if (abs(diff) > 0.1) {
+				if (ChannelUsed[pwm]->myFreq != freq) {
 					ESP_LOGW(TAG, 
 							"\tWARNING PWM channel %d	\
 							 shares a timer with channel %d\n	\
-							\tchanging the frequency to %.3f		\
+							\tchanging the frequency to %ld		\
 							Hz will ALSO change channel %d	\
-							\n\tfrom its previous frequency of %.3f Hz\n "
+							\n\tfrom its previous frequency of %ld Hz\n "
 								,pwmChannel, pwm, freq, pwm, ChannelUsed[pwm]->myFreq);
 					ChannelUsed[pwm]->myFreq = freq;
 				}
@@ -68,10 +68,11 @@ private:
 	bool attachedState = false;
 	int pin;
 	uint8_t resolutionBits;
-	double myFreq;
+	long myFreq;                                // the LEDC and MCPWM timers have integer frequencies
 	bool useVariableFrequency = false;
 	bool isMCPWM = false;
-	int allocatenext(double freq);
+	int fixedChannel = -1;                      // channel to use instead of the next free one
+	int allocatenext(long freq);
 
 #if defined(CONFIG_IDF_TARGET_ESP32S3)
 	mcpwm_unit_t mcpwmUnit;
@@ -79,12 +80,12 @@ private:
 	mcpwm_operator_t mcpwmOperator;
 #endif
 
-	static double _ledcSetupTimerFreq(uint8_t pin, double freq,
+	static uint32_t _ledcSetupTimerFreq(uint8_t pin, long freq,
 		uint8_t bit_num, uint8_t channel);
 
-	bool checkFrequencyForSideEffects(double freq);
+	bool checkFrequencyForSideEffects(long freq);
 
-	void adjustFrequencyLocal(double freq, double dutyScaled);
+	void adjustFrequencyLocal(long freq, uint32_t duty);
 	static double mapf(double x, double in_min, double in_max, double out_min,
 			double out_max) {
 		if(x>in_max)
@@ -94,7 +95,7 @@ private:
 		return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
 	}
 
-	double setup(double freq, uint8_t resolution_bits=10);
+	uint32_t setup(long freq, uint8_t resolution_bits=10);
 	//channel 0-15 resolution 1-16bits freq limits depend on resolution9
 	void attachPin(uint8_t pin);
 	// pin allocation
@@ -107,6 +108,10 @@ public:
 
 	void detachPin(int pin);
 	void attachPin(uint8_t pin, double freq, uint8_t resolution_bits=10);
+	// Use this LEDC channel for all following attachPin() calls, instead of allocating the next free one
+	void setFixedChannel(int channel) {
+		fixedChannel = channel;
+	}
 	bool attached() {
 		return attachedState;
 	}
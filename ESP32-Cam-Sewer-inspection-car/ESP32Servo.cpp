@@ -65,7 +65,7 @@ Servo::Servo()
 	this->pinNumber = -1;     // make it clear that we haven't attached a pin to this channel
 	this->min = DEFAULT_uS_LOW;
 	this->max = DEFAULT_uS_HIGH;
-	this->timer_width_ticks = pow(2,this->timer_width);
+	this->timer_width_ticks = 1 << this->timer_width;
 
 }
 ESP32PWM * Servo::getPwm(){
@@ -95,7 +95,7 @@ int Servo::attach(int pin, int min, int max)
             {
                 this->ticks = DEFAULT_PULSE_WIDTH_TICKS;
                 this->timer_width = DEFAULT_TIMER_WIDTH;
-                this->timer_width_ticks = pow(2,this->timer_width);
+                this->timer_width_ticks = 1 << this->timer_width;
             }
             this->pinNumber = pin;
 #ifdef ENFORCE_PINS
@@ -241,7 +241,7 @@ void Servo::setTimerWidth(int value)
     }
     
     this->timer_width = value;
-    this->timer_width_ticks = pow(2,this->timer_width);
+    this->timer_width_ticks = 1 << this->timer_width;
     
     // If this is an attached servo, clean up
     if (this->attached())
@@ -257,14 +257,28 @@ int Servo::readTimerWidth()
     return (this->timer_width);
 }
 
+/*
+ * Integer versions of the former double computations, which gave bit identical results for all timer widths from 10 to 20 bit.
+ * The ESP32 has no double FPU, so the double code was emulated in software for each servo write.
+ * For the standard refresh rate of 50 Hz, 32 bit arithmetic with the constant divisor REFRESH_USEC is sufficient,
+ * since usec * 2^20 does not overflow for pulses below 4096 us, and the division by timer_width_ticks is a shift.
+ */
 int Servo::usToTicks(int usec)
 {
-    return (int)((double)usec / ((double)REFRESH_USEC / (double)this->timer_width_ticks)*(((double)REFRESH_CPS)/50.0));
+    if (REFRESH_CPS == 50)
+    {
+        return (int)(((uint32_t)usec * (uint32_t)this->timer_width_ticks) / REFRESH_USEC);
+    }
+    return (int)(((int64_t)usec * this->timer_width_ticks * REFRESH_CPS) / (50LL * REFRESH_USEC));
 }
 
 int Servo::ticksToUs(int ticks)
 {
-    return (int)((double)ticks * ((double)REFRESH_USEC / (double)this->timer_width_ticks)/(((double)REFRESH_CPS)/50.0));
+    if (REFRESH_CPS == 50)
+    {
+        return (int)(((uint64_t)ticks * REFRESH_USEC) >> this->timer_width); // timer_width_ticks is 2^timer_width
+    }
+    return (int)(((int64_t)ticks * REFRESH_USEC * 50) / ((int64_t)this->timer_width_ticks * REFRESH_CPS));
 }
 
  
@@ -166,6 +166,9 @@ public:
 		REFRESH_CPS=hertz;
 		setTimerWidth(this->timer_width);
 	}
+	void setChannel(int channel){      // use this LEDC channel instead of the next free one, call before attach
+		pwm.setFixedChannel(channel);
+	}
 private:
 	int usToTicks(int usec);
 	int ticksToUs(int ticks);
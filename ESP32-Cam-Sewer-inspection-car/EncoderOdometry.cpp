@@ -0,0 +1,151 @@
+/*
+ * EncoderOdometry.cpp
+ *
+ *  Wheel encoder counted by the ESP32 pulse counter (PCNT) hardware.
+ *  Counting requires no interrupt, the counter is read by updateEncoder(), which is called by the motor control timer
+ *  at least every ENCODER_PCNT_LIMIT counts. Direction is not sensed, it is given by the caller.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#include <Arduino.h>
+#if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(3, 0, 0)
+#include "driver/pulse_cnt.h"
+#else
+#include "driver/pcnt.h"
+#endif
+
+#include "EncoderOdometry.h"
+
+uint32_t EncoderCount;
+int32_t EncoderSignedCount;
+static int sLastHardwareCount;  // 0 to ENCODER_PCNT_LIMIT - 1
+static bool sEncoderIsInitialized = false;
+
+#if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(3, 0, 0)
+static pcnt_unit_handle_t sEncoderUnit;
+
+bool initEncoder() {
+    pcnt_unit_config_t tUnitConfig = { };
+    tUnitConfig.high_limit = ENCODER_PCNT_LIMIT;
+    tUnitConfig.low_limit = -ENCODER_PCNT_LIMIT;
+    if (pcnt_new_unit(&tUnitConfig, &sEncoderUnit) != ESP_OK) {
+        Serial.println("Encoder: no free PCNT unit");
+        return false;
+    }
+    pcnt_glitch_filter_config_t tFilterConfig = { };
+    tFilterConfig.max_glitch_ns = ENCODER_GLITCH_FILTER_NANOS;
+    pcnt_unit_set_glitch_filter(sEncoderUnit, &tFilterConfig);
+
+    pcnt_chan_config_t tChannelConfig = { };
+    tChannelConfig.edge_gpio_num = ENCODER_PIN;
+    tChannelConfig.level_gpio_num = -1;
+    pcnt_channel_handle_t tChannel;
+    pcnt_new_channel(sEncoderUnit, &tChannelConfig, &tChannel);
+    pcnt_channel_set_edge_action(tChannel, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_INCREASE);
+
+    pcnt_unit_enable(sEncoderUnit);
+    pcnt_unit_clear_count(sEncoderUnit);
+    pcnt_unit_start(sEncoderUnit);
+    sEncoderIsInitialized = true;
+    return true;
+}
+
+static int readEncoderHardwareCount() {
+    int tCount = 0;
+    pcnt_unit_get_count(sEncoderUnit, &tCount);
+    return tCount;
+}
+
+#else
+#define ENCODER_PCNT_UNIT   PCNT_UNIT_0
+
+bool initEncoder() {
+    pcnt_config_t tConfig = { };
+    tConfig.pulse_gpio_num = ENCODER_PIN;
+    tConfig.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+    tConfig.lctrl_mode = PCNT_MODE_KEEP;
+    tConfig.hctrl_mode = PCNT_MODE_KEEP;
+    tConfig.pos_mode = PCNT_COUNT_INC;
+    tConfig.neg_mode = PCNT_COUNT_INC;
+    tConfig.counter_h_lim = ENCODER_PCNT_LIMIT;
+    tConfig.counter_l_lim = -ENCODER_PCNT_LIMIT;
+    tConfig.unit = ENCODER_PCNT_UNIT;
+    tConfig.channel = PCNT_CHANNEL_0;
+    if (pcnt_unit_config(&tConfig) != ESP_OK) {
+        Serial.println("Encoder: PCNT config failed");
+        return false;
+    }
+    // Filter value is in APB clock cycles of 12.5 ns
+    pcnt_set_filter_value(ENCODER_PCNT_UNIT, min(1023, (ENCODER_GLITCH_FILTER_NANOS * 10) / 125));
+    pcnt_filter_enable(ENCODER_PCNT_UNIT);
+
+    pcnt_counter_pause(ENCODER_PCNT_UNIT);
+    pcnt_counter_clear(ENCODER_PCNT_UNIT);
+    pcnt_counter_resume(ENCODER_PCNT_UNIT);
+    sEncoderIsInitialized = true;
+    return true;
+}
+
+static int readEncoderHardwareCount() {
+    int16_t tCount = 0;
+    pcnt_get_counter_value(ENCODER_PCNT_UNIT, &tCount);
+    return tCount;
+}
+#endif
+
+/*
+ * Adds the counts since the last call to EncoderCount and EncoderSignedCount.
+ * Not reentrant, the caller must serialize the calls.
+ * @param aIsBackward true if the counts since the last call were caused by a backward move
+ * @return number of new counts
+ */
+uint32_t updateEncoder(bool aIsBackward) {
+    if (!sEncoderIsInitialized) {
+        return 0;
+    }
+    int tHardwareCount = readEncoderHardwareCount();
+    int tDelta = tHardwareCount - sLastHardwareCount;
+    if (tDelta < 0) {
+        tDelta += ENCODER_PCNT_LIMIT; // counter was reset to 0 at the limit
+    }
+    sLastHardwareCount = tHardwareCount;
+    EncoderCount += tDelta;
+    if (aIsBackward) {
+        EncoderSignedCount -= tDelta;
+    } else {
+        EncoderSignedCount += tDelta;
+    }
+    return tDelta;
+}
+
+/*
+ * @return driven distance since boot, backward distances are subtracted
+ */
+int32_t getEncoderOdometerMillimeter() {
+    return ((int64_t) EncoderSignedCount * 1000) / ENCODER_COUNTS_PER_METER;
+}
+
+uint32_t convertMillimeterToEncoderCount(uint32_t aMillimeter) {
+    return ((aMillimeter * ENCODER_COUNTS_PER_METER) + 500) / 1000;
+}
+
+uint32_t convertEncoderCountToMillimeter(uint32_t aCount) {
+    return (aCount * 1000) / ENCODER_COUNTS_PER_METER;
+}
@@ -0,0 +1,52 @@
+/*
+ * EncoderOdometry.h
+ *
+ *  Wheel encoder counted by the ESP32 pulse counter (PCNT) hardware.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _ENCODER_ODOMETRY_H
+#define _ENCODER_ODOMETRY_H
+
+#include <stdint.h>
+
+/*
+ * Single channel encoder, e.g. a slotted disc with a fork light barrier. Both edges are counted.
+ * On the ESP32-CAM only GPIO 3 (U0RXD) is left, so serial input is not available with encoder.
+ */
+#if !defined(ENCODER_PIN)
+#define ENCODER_PIN                     3
+#endif
+#if !defined(ENCODER_COUNTS_PER_METER)
+#define ENCODER_COUNTS_PER_METER        196 // 20 slots, 2 edges, 65 mm wheel diameter
+#endif
+#define ENCODER_GLITCH_FILTER_NANOS     10000 // pulses shorter than 10 us are ignored. Maximum is 1023 APB clocks = 12.7 us.
+#define ENCODER_PCNT_LIMIT              32767 // the 16 bit hardware counter is reset to 0 at this value
+
+extern uint32_t EncoderCount;       // all counts since boot
+extern int32_t EncoderSignedCount;  // counts since boot, backward counts are subtracted
+
+bool initEncoder();
+uint32_t updateEncoder(bool aIsBackward);
+int32_t getEncoderOdometerMillimeter();
+uint32_t convertMillimeterToEncoderCount(uint32_t aMillimeter);
+uint32_t convertEncoderCountToMillimeter(uint32_t aCount);
+
+#endif // _ENCODER_ODOMETRY_H
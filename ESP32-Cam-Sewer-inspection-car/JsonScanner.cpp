@@ -0,0 +1,173 @@
+/*
+ * JsonScanner.cpp
+ *
+ *  Single pass, allocation free scanner for flat JSON objects like {"lamp":0,"framesize":9,"rotate":"0"}.
+ *  The buffer is walked only once and modified in place, i.e. keys and values are zero terminated inside the buffer.
+ *  Nested objects and arrays are not supported and reported as error, as well as any other malformed input.
+ *  The scanner never reads beyond aLength, so the buffer need not to be zero terminated.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#include "JsonScanner.h"
+
+static bool isJsonWhitespace(char aChar) {
+    return (aChar == ' ' || aChar == '\t' || aChar == '\r' || aChar == '\n');
+}
+
+/*
+ * Characters allowed in an unquoted value i.e. numbers, true, false and null
+ */
+static bool isJsonLiteralChar(char aChar) {
+    return ((aChar >= '0' && aChar <= '9') || (aChar >= 'a' && aChar <= 'z') || aChar == '-' || aChar == '+' || aChar == '.'
+            || (aChar == 'E'));
+}
+
+/*
+ * @return index of first non whitespace character, which may be aLength
+ */
+static size_t skipWhitespace(const char *aJsonBuffer, size_t aIndex, size_t aLength) {
+    while (aIndex < aLength && isJsonWhitespace(aJsonBuffer[aIndex])) {
+        aIndex++;
+    }
+    return aIndex;
+}
+
+/*
+ * aIndex must point to the opening quote.
+ * Replaces the closing quote by a string terminator.
+ * Escape sequences are skipped but not converted.
+ * @return index of character after the closing quote or 0 if string is not terminated
+ */
+static size_t terminateString(char *aJsonBuffer, size_t aIndex, size_t aLength) {
+    aIndex++; // skip opening quote
+    while (aIndex < aLength) {
+        char tChar = aJsonBuffer[aIndex];
+        if (tChar == '"') {
+            aJsonBuffer[aIndex] = '\0';
+            return aIndex + 1;
+        }
+        if (tChar == '\\') {
+            aIndex++; // skip escaped character
+        } else if (tChar == '\0' || tChar == '\n') {
+            return 0;
+        }
+        aIndex++;
+    }
+    return 0;
+}
+
+/*
+ * @param aKeyValueHandler called for each pair found, may be NULL for syntax check only
+ * @return number of key / value pairs found or JSON_SCANNER_ERROR if input is malformed.
+ *         In case of an error, all pairs before the error were already passed to the handler.
+ */
+int scanFlatJsonObject(char *aJsonBuffer, size_t aLength, JsonKeyValueHandler aKeyValueHandler, void *aContext) {
+    int tNumberOfPairs = 0;
+    size_t tIndex = skipWhitespace(aJsonBuffer, 0, aLength);
+
+    if (tIndex >= aLength || aJsonBuffer[tIndex] != '{') {
+        return JSON_SCANNER_ERROR;
+    }
+    tIndex = skipWhitespace(aJsonBuffer, tIndex + 1, aLength);
+    if (tIndex < aLength && aJsonBuffer[tIndex] == '}') {
+        tIndex++; // empty object
+    } else {
+        while (true) {
+            /*
+             * Key
+             */
+            if (tIndex >= aLength || aJsonBuffer[tIndex] != '"') {
+                return JSON_SCANNER_ERROR;
+            }
+            const char *tKey = &aJsonBuffer[tIndex + 1];
+            tIndex = terminateString(aJsonBuffer, tIndex, aLength);
+            if (tIndex == 0) {
+                return JSON_SCANNER_ERROR;
+            }
+            tIndex = skipWhitespace(aJsonBuffer, tIndex, aLength);
+            if (tIndex >= aLength || aJsonBuffer[tIndex] != ':') {
+                return JSON_SCANNER_ERROR;
+            }
+            tIndex = skipWhitespace(aJsonBuffer, tIndex + 1, aLength);
+            if (tIndex >= aLength) {
+                return JSON_SCANNER_ERROR;
+            }
+
+            /*
+             * Value
+             */
+            const char *tValue;
+            char tTerminatingChar; // the character, which was overwritten by the string terminator
+            if (aJsonBuffer[tIndex] == '"') {
+                tValue = &aJsonBuffer[tIndex + 1];
+                tIndex = terminateString(aJsonBuffer, tIndex, aLength);
+                if (tIndex == 0) {
+                    return JSON_SCANNER_ERROR;
+                }
+                tIndex = skipWhitespace(aJsonBuffer, tIndex, aLength);
+                if (tIndex >= aLength) {
+                    return JSON_SCANNER_ERROR;
+                }
+                tTerminatingChar = aJsonBuffer[tIndex];
+            } else {
+                tValue = &aJsonBuffer[tIndex];
+                while (tIndex < aLength && isJsonLiteralChar(aJsonBuffer[tIndex])) {
+                    tIndex++;
+                }
+                if (tIndex >= aLength || &aJsonBuffer[tIndex] == tValue) {
+                    return JSON_SCANNER_ERROR; // no closing brace or empty value
+                }
+                tTerminatingChar = aJsonBuffer[tIndex];
+                if (isJsonWhitespace(tTerminatingChar)) {
+                    aJsonBuffer[tIndex] = '\0';
+                    tIndex = skipWhitespace(aJsonBuffer, tIndex + 1, aLength);
+                    if (tIndex >= aLength) {
+                        return JSON_SCANNER_ERROR;
+                    }
+                    tTerminatingChar = aJsonBuffer[tIndex];
+                }
+            }
+            if (tTerminatingChar != ',' && tTerminatingChar != '}') {
+                return JSON_SCANNER_ERROR;
+            }
+            aJsonBuffer[tIndex] = '\0'; // Terminate unquoted value, no effect for strings
+            tIndex++;
+
+            tNumberOfPairs++;
+            if (aKeyValueHandler != NULL) {
+                aKeyValueHandler(tKey, tValue, aContext);
+            }
+
+            if (tTerminatingChar == '}') {
+                break;
+            }
+            tIndex = skipWhitespace(aJsonBuffer, tIndex, aLength);
+        }
+    }
+
+    /*
+     * Only whitespace or a string terminator is allowed after the closing brace
+     */
+    tIndex = skipWhitespace(aJsonBuffer, tIndex, aLength);
+    if (tIndex < aLength && aJsonBuffer[tIndex] != '\0') {
+        return JSON_SCANNER_ERROR;
+    }
+    return tNumberOfPairs;
+}
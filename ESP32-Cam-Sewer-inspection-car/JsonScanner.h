@@ -0,0 +1,40 @@
+/*
+ * JsonScanner.h
+ *
+ *  Single pass, allocation free scanner for flat JSON objects like the preferences file.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _JSON_SCANNER_H
+#define _JSON_SCANNER_H
+
+#include <stddef.h>
+
+#define JSON_SCANNER_ERROR  (-1)
+
+/*
+ * Called for each key / value pair. Quotes are already removed from string values.
+ * Both strings are zero terminated and point into the scanned buffer, so they are only valid during the call.
+ */
+typedef void (*JsonKeyValueHandler)(const char *aKey, const char *aValue, void *aContext);
+
+int scanFlatJsonObject(char *aJsonBuffer, size_t aLength, JsonKeyValueHandler aKeyValueHandler, void *aContext);
+
+#endif // _JSON_SCANNER_H
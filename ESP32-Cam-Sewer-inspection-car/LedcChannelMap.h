@@ -0,0 +1,140 @@
+/*
+ * LedcChannelMap.h
+ *
+ *  Compile time assignment of all LEDC channels and timers used by camera clock, lamp, motor and servos.
+ *  The map is checked by static_assert, so a configuration where two users share a channel,
+ *  or share a timer with different frequency or resolution, does not compile.
+ *  At runtime the channel of each user is taken from this map, no dynamic allocation is done.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _LEDC_CHANNEL_MAP_H
+#define _LEDC_CHANNEL_MAP_H
+
+#include <stdint.h>
+
+/*
+ * Only the first 8 channels are used, since ESP32-S2, S3 and C3 have no more.
+ * Channel n is driven by timer (n / 2) % 4, this is also the assumption of the Arduino core and of ESP32PWM.cpp.
+ */
+#define LEDC_MAP_NUMBER_OF_CHANNELS 8
+constexpr uint8_t getLedcTimerOfChannel(uint8_t aChannel) {
+    return (aChannel / 2) % 4;
+}
+
+/*
+ * Camera XCLK. Can be overwritten in myconfig.h, but the map then only sees the new value in the .ino file.
+ * Originally: config.xclk_freq_hz = 20000000, but this lead to visual artifacts on many modules.
+ * See https://github.com/espressif/esp32-camera/issues/150#issuecomment-726473652 et al.
+ */
+#if !defined (XCLK_FREQ_HZ)
+#define XCLK_FREQ_HZ 16500000
+#endif
+#define LEDC_CAMERA_XCLK_CHANNEL    0
+#define LEDC_CAMERA_XCLK_TIMER      getLedcTimerOfChannel(LEDC_CAMERA_XCLK_CHANNEL)
+#define LEDC_CAMERA_XCLK_RESOLUTION 1 // the camera driver uses a 1 bit timer
+
+/*
+ * The lamp frequency can be changed at runtime, so no other channel may use the lamp timer.
+ * With 1 kHz, exposures shorter than some ms show rolling shutter bands.
+ * The anti banding frequency has a period of 12.8 us, which is below the duration of one sensor line,
+ * so every line is exposed with nearly the same number of PWM periods.
+ * A phase lock to VSYNC is not possible, since the LEDC timer can not be triggered by a pin.
+ */
+#define LEDC_LAMP_CHANNEL           2
+#define LEDC_LAMP_ANTI_BANDING_FREQUENCY 78125 // 80 MHz APB clock / 1024
+#define LEDC_LAMP_MAX_FREQUENCY     156250  // 80 MHz / 2^LEDC_LAMP_RESOLUTION
+#if defined(LAMP_ANTI_BANDING)
+#define LEDC_LAMP_FREQUENCY         LEDC_LAMP_ANTI_BANDING_FREQUENCY
+#else
+#define LEDC_LAMP_FREQUENCY         1000    // 1 kHz
+#endif
+#define LEDC_LAMP_RESOLUTION        9       // duty cycle bit range for lamp
+
+#define LEDC_MOTOR_CHANNEL          4
+#define LEDC_MOTOR_FREQUENCY        1000    // 1 kHz
+#define LEDC_MOTOR_RESOLUTION       8
+
+/*
+ * Both servos have the same frequency and resolution and can therefore share one timer
+ */
+#define LEDC_PAN_SERVO_CHANNEL      6
+#define LEDC_TILT_SERVO_CHANNEL     7
+#define LEDC_SERVO_FREQUENCY        50      // 20 ms refresh
+#define LEDC_SERVO_RESOLUTION       10      // DEFAULT_TIMER_WIDTH of ESP32Servo
+
+struct LedcChannelStruct {
+    const char *Name;
+    uint8_t Channel;
+    uint8_t Timer;
+    uint32_t Frequency;
+    uint8_t ResolutionBits;
+};
+
+/*
+ * Channels are reserved even if the user is disabled at runtime, so every combination of features is collision free
+ */
+constexpr LedcChannelStruct LedcChannelMap[] = {
+{ "camera_xclk", LEDC_CAMERA_XCLK_CHANNEL, LEDC_CAMERA_XCLK_TIMER, XCLK_FREQ_HZ, LEDC_CAMERA_XCLK_RESOLUTION },
+{ "lamp", LEDC_LAMP_CHANNEL, getLedcTimerOfChannel(LEDC_LAMP_CHANNEL), LEDC_LAMP_FREQUENCY, LEDC_LAMP_RESOLUTION },
+{ "motor", LEDC_MOTOR_CHANNEL, getLedcTimerOfChannel(LEDC_MOTOR_CHANNEL), LEDC_MOTOR_FREQUENCY, LEDC_MOTOR_RESOLUTION },
+{ "pan_servo", LEDC_PAN_SERVO_CHANNEL, getLedcTimerOfChannel(LEDC_PAN_SERVO_CHANNEL), LEDC_SERVO_FREQUENCY, LEDC_SERVO_RESOLUTION },
+{ "tilt_servo", LEDC_TILT_SERVO_CHANNEL, getLedcTimerOfChannel(LEDC_TILT_SERVO_CHANNEL), LEDC_SERVO_FREQUENCY, LEDC_SERVO_RESOLUTION } };
+
+constexpr int NumberOfLedcChannelMapEntries = sizeof(LedcChannelMap) / sizeof(LedcChannelMap[0]);
+
+/*
+ * Recursive, since the Arduino ESP32 core 2.x compiles with C++11, where constexpr functions can not have loops
+ */
+constexpr bool isLedcEntryValid(const LedcChannelStruct &aEntry) {
+    return aEntry.Channel < LEDC_MAP_NUMBER_OF_CHANNELS && aEntry.Timer == getLedcTimerOfChannel(aEntry.Channel);
+}
+constexpr bool areLedcEntriesCompatible(const LedcChannelStruct &aEntry, const LedcChannelStruct &aOtherEntry) {
+    return aEntry.Channel != aOtherEntry.Channel
+            && (aEntry.Timer != aOtherEntry.Timer
+                    || (aEntry.Frequency == aOtherEntry.Frequency && aEntry.ResolutionBits == aOtherEntry.ResolutionBits));
+}
+constexpr bool isLedcEntryCompatibleWithFollowing(int aIndex, int aOtherIndex) {
+    return aOtherIndex >= NumberOfLedcChannelMapEntries
+            || (areLedcEntriesCompatible(LedcChannelMap[aIndex], LedcChannelMap[aOtherIndex])
+                    && isLedcEntryCompatibleWithFollowing(aIndex, aOtherIndex + 1));
+}
+constexpr bool areAllLedcEntriesValid(int aIndex = 0) {
+    return aIndex >= NumberOfLedcChannelMapEntries
+            || (isLedcEntryValid(LedcChannelMap[aIndex]) && areAllLedcEntriesValid(aIndex + 1));
+}
+constexpr bool isLedcChannelMapCollisionFree(int aIndex = 0) {
+    return aIndex >= NumberOfLedcChannelMapEntries
+            || (isLedcEntryCompatibleWithFollowing(aIndex, aIndex + 1) && isLedcChannelMapCollisionFree(aIndex + 1));
+}
+
+constexpr bool isLedcTimerExclusive(uint8_t aChannel, int aIndex = 0) {
+    return aIndex >= NumberOfLedcChannelMapEntries
+            || ((LedcChannelMap[aIndex].Channel == aChannel
+                    || LedcChannelMap[aIndex].Timer != getLedcTimerOfChannel(aChannel))
+                    && isLedcTimerExclusive(aChannel, aIndex + 1));
+}
+
+static_assert(areAllLedcEntriesValid(), "LedcChannelMap: channel out of range or timer does not match channel");
+static_assert(isLedcChannelMapCollisionFree(),
+        "LedcChannelMap: channel used twice or timer shared by channels with different frequency or resolution");
+static_assert(isLedcTimerExclusive(LEDC_LAMP_CHANNEL), "LedcChannelMap: lamp timer is shared, but lamp frequency can be changed");
+
+#endif // _LEDC_CHANNEL_MAP_H
@@ -0,0 +1,129 @@
+/*
+ * LoopScheduler.cpp
+ *
+ *  Deadline scheduler for the tasks of the Arduino loop.
+ *  Each task returns the time until its next run, so e.g. the motor task can request to run exactly at the computed stop time.
+ *  Between the deadlines, the loop task blocks on its task notification, so the CPU is free for the camera and http tasks.
+ *  Other tasks, like the http server, can call wakeLoopScheduler() if a new deadline is to be computed.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "LoopScheduler.h"
+
+static LoopTaskStruct *sLoopTasks;
+static uint8_t sNumberOfLoopTasks;
+static TaskHandle_t sLoopTaskHandle = NULL;
+static volatile bool sWakeupRequested = false;
+
+/*
+ * Statistics
+ */
+static uint64_t sSleepMicros;
+static uint64_t sStartMicros;
+static uint32_t sNumberOfWakeups;
+
+/*
+ * Must be called from the task which later calls runLoopScheduler(), i.e. from setup()
+ */
+void initLoopScheduler(LoopTaskStruct *aLoopTasks, uint8_t aNumberOfLoopTasks) {
+    sLoopTasks = aLoopTasks;
+    sNumberOfLoopTasks = aNumberOfLoopTasks;
+    sLoopTaskHandle = xTaskGetCurrentTaskHandle();
+    unsigned long tMillis = millis();
+    for (uint_fast8_t i = 0; i < aNumberOfLoopTasks; ++i) {
+        aLoopTasks[i].NextRunMillis = tMillis;
+    }
+    sStartMicros = esp_timer_get_time();
+}
+
+/*
+ * Can be called from any task
+ */
+void wakeLoopScheduler() {
+    sWakeupRequested = true;
+    if (sLoopTaskHandle != NULL) {
+        xTaskNotifyGive(sLoopTaskHandle);
+    }
+}
+
+/*
+ * Runs all due tasks and then sleeps until the next deadline or until wakeLoopScheduler() is called.
+ * To be called in loop().
+ */
+void runLoopScheduler() {
+    bool tIsWakeup = sWakeupRequested;
+    sWakeupRequested = false;
+
+    for (uint_fast8_t i = 0; i < sNumberOfLoopTasks; ++i) {
+        LoopTaskStruct *tLoopTask = &sLoopTasks[i];
+        unsigned long tMillis = millis();
+        long tLatenessMillis = (long) (tMillis - tLoopTask->NextRunMillis);
+        if (tLatenessMillis >= 0 || (tIsWakeup && tLoopTask->RunOnWakeup)) {
+            if (tLatenessMillis > 0 && (unsigned long) tLatenessMillis > tLoopTask->MaxLatenessMillis) {
+                tLoopTask->MaxLatenessMillis = tLatenessMillis;
+            }
+            tLoopTask->NumberOfRuns++;
+            uint32_t tDelayMillis = tLoopTask->TaskFunction();
+            tLoopTask->NextRunMillis = millis() + tDelayMillis;
+        }
+    }
+
+    /*
+     * Compute time until next deadline
+     */
+    unsigned long tMillis = millis();
+    long tSleepMillis = LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+    for (uint_fast8_t i = 0; i < sNumberOfLoopTasks; ++i) {
+        long tMillisUntilDeadline = (long) (sLoopTasks[i].NextRunMillis - tMillis);
+        if (tMillisUntilDeadline < tSleepMillis) {
+            tSleepMillis = tMillisUntilDeadline;
+        }
+    }
+
+    if (tSleepMillis > 0 && !sWakeupRequested) {
+        int64_t tSleepStartMicros = esp_timer_get_time();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(tSleepMillis));
+        sSleepMicros += esp_timer_get_time() - tSleepStartMicros;
+        sNumberOfWakeups++;
+    }
+}
+
+/*
+ * Prints the percentage of time the loop task was sleeping and the max lateness of each task as JSON key value pairs,
+ * each followed by a comma.
+ * @return number of characters printed
+ */
+int printLoopSchedulerStatistics(char *aBuffer) {
+    char *p = aBuffer;
+    uint64_t tElapsedMicros = esp_timer_get_time() - sStartMicros;
+    unsigned int tSleepPermille = 0;
+    if (tElapsedMicros > 0) {
+        tSleepPermille = (sSleepMicros * 1000) / tElapsedMicros;
+    }
+    p += sprintf(p, "\"loop_sleep_percent\":%u.%u,", tSleepPermille / 10, tSleepPermille % 10);
+    p += sprintf(p, "\"loop_wakeups\":%lu,", (unsigned long) sNumberOfWakeups);
+    for (uint_fast8_t i = 0; i < sNumberOfLoopTasks; ++i) {
+        p += sprintf(p, "\"loop_%s_runs\":%lu,\"loop_%s_max_late_ms\":%lu,", sLoopTasks[i].Name,
+                (unsigned long) sLoopTasks[i].NumberOfRuns, sLoopTasks[i].Name, sLoopTasks[i].MaxLatenessMillis);
+    }
+    return p - aBuffer;
+}
@@ -0,0 +1,49 @@
+/*
+ * LoopScheduler.h
+ *
+ *  Deadline scheduler for the tasks of the Arduino loop. The loop task sleeps until the next task is due.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _LOOP_SCHEDULER_H
+#define _LOOP_SCHEDULER_H
+
+#include <stdint.h>
+
+#define LOOP_SCHEDULER_MAX_SLEEP_MILLIS 1000 // upper limit for the sleep, if no task is due earlier
+
+/*
+ * The task function returns the milliseconds until it wants to run again
+ */
+struct LoopTaskStruct {
+    const char *Name;
+    uint32_t (*TaskFunction)();
+    bool RunOnWakeup;               // run also when wakeLoopScheduler() was called, e.g. to compute a new motor deadline
+    unsigned long NextRunMillis;
+    unsigned long MaxLatenessMillis; // max difference between deadline and start of task function
+    uint32_t NumberOfRuns;
+};
+
+void initLoopScheduler(LoopTaskStruct *aLoopTasks, uint8_t aNumberOfLoopTasks);
+void runLoopScheduler();
+void wakeLoopScheduler();
+int printLoopSchedulerStatistics(char *aBuffer);
+
+#endif // _LOOP_SCHEDULER_H
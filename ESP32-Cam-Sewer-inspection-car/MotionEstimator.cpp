@@ -0,0 +1,238 @@
+/*
+ * MotionEstimator.cpp
+ *
+ *  Motion estimation from the video, for cars without encoder.
+ *  Called by the stream task before a frame is sent, at most every MOTION_SAMPLE_MILLIS_DRIVING.
+ *  The kernels work on contiguous rows of bytes without branches in the inner loop,
+ *  so the compiler can unroll and pipeline them. One grid is 768 bytes and fits easily in the cache.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+
+#include <Arduino.h>
+#include <string.h>
+#include <esp_timer.h>
+#include "img_converters.h"
+
+#include "MotionEstimator.h"
+#include "esp32-cam-webserver.h"
+#include "MotorAndServoControl.h"
+
+MotionEstimateStruct MotionEstimate;
+
+static uint8_t *sDecodeBuffer = NULL;
+static size_t sDecodeBufferSize;
+static uint8_t sLuminanceGrids[2][MOTION_GRID_HEIGHT][MOTION_GRID_WIDTH];
+static uint8_t sCurrentGridIndex = 0;
+static bool sPreviousGridIsValid = false;
+static size_t sLastFrameLength;
+
+/*
+ * Allocates the decode buffer, in PSRAM if available, since then UXGA frames (200 x 150 decoded) are possible
+ */
+bool initMotionEstimator() {
+    if (psramFound()) {
+        sDecodeBufferSize = (1600 / 8) * (1200 / 8) * 2;
+        sDecodeBuffer = (uint8_t*) ps_malloc(sDecodeBufferSize);
+    } else {
+        sDecodeBufferSize = MOTION_MAX_DECODED_BYTES_NO_PSRAM;
+        sDecodeBuffer = (uint8_t*) malloc(sDecodeBufferSize);
+    }
+    if (sDecodeBuffer == NULL) {
+        Serial.println("Motion estimator: no memory for decode buffer");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Cheap check for all frames, which do not get a decoded sample
+ */
+static bool hasFrameSizeChanged(size_t aLength) {
+    size_t tDelta = (aLength > sLastFrameLength) ? aLength - sLastFrameLength : sLastFrameLength - aLength;
+    bool tHasChanged = tDelta * 100 > sLastFrameLength * MOTION_FRAME_CHANGE_PERCENT;
+    sLastFrameLength = aLength;
+    return tHasChanged;
+}
+
+/*
+ * Converts the big endian RGB565 image to luminance and averages it to the grid.
+ * Each source row is processed sequentially and added to one row of accumulators.
+ */
+static void computeLuminanceGrid(const uint8_t *aRGB565, int aWidth, int aHeight, uint8_t aGrid[][MOTION_GRID_WIDTH]) {
+    uint16_t tColumnToCell[200]; // maximum decoded width
+    for (int x = 0; x < aWidth; ++x) {
+        tColumnToCell[x] = (x * MOTION_GRID_WIDTH) / aWidth;
+    }
+    uint32_t tAccumulators[MOTION_GRID_WIDTH];
+    uint16_t tCounts[MOTION_GRID_WIDTH];
+
+    int tSourceRow = 0;
+    for (int tGridRow = 0; tGridRow < MOTION_GRID_HEIGHT; ++tGridRow) {
+        memset(tAccumulators, 0, sizeof(tAccumulators));
+        memset(tCounts, 0, sizeof(tCounts));
+        int tEndRow = ((tGridRow + 1) * aHeight) / MOTION_GRID_HEIGHT;
+        for (; tSourceRow < tEndRow; ++tSourceRow) {
+            const uint8_t *tPixel = &aRGB565[tSourceRow * aWidth * 2];
+            for (int x = 0; x < aWidth; ++x) {
+                uint16_t tCell = tColumnToCell[x];
+                tAccumulators[tCell] += getLuminanceOfRGB565(tPixel[0], tPixel[1]);
+                tPixel += 2;
+                tCounts[tCell]++;
+            }
+        }
+        for (int i = 0; i < MOTION_GRID_WIDTH; ++i) {
+            aGrid[tGridRow][i] = (tCounts[i] > 0) ? tAccumulators[i] / tCounts[i] : 0;
+        }
+    }
+}
+
+/*
+ * Sum of absolute differences of aLength bytes. Unrolled by 4 without branches.
+ */
+static uint32_t sumOfAbsoluteDifferences(const uint8_t *aFirst, const uint8_t *aSecond, int aLength) {
+    uint32_t tSum = 0;
+    int i = 0;
+    for (; i + 4 <= aLength; i += 4) {
+        tSum += abs(aFirst[i] - aSecond[i]) + abs(aFirst[i + 1] - aSecond[i + 1]) + abs(aFirst[i + 2] - aSecond[i + 2])
+                + abs(aFirst[i + 3] - aSecond[i + 3]);
+    }
+    for (; i < aLength; ++i) {
+        tSum += abs(aFirst[i] - aSecond[i]);
+    }
+    return tSum;
+}
+
+/*
+ * @return mean absolute difference multiplied by 16 of the overlapping part, if aCurrent is shifted by aShiftX, aShiftY
+ */
+static uint32_t getShiftedDifference(const uint8_t aPrevious[][MOTION_GRID_WIDTH], const uint8_t aCurrent[][MOTION_GRID_WIDTH],
+        int aShiftX, int aShiftY) {
+    int tStartX = max(0, aShiftX);
+    int tWidth = MOTION_GRID_WIDTH - abs(aShiftX);
+    int tStartY = max(0, aShiftY);
+    int tHeight = MOTION_GRID_HEIGHT - abs(aShiftY);
+    uint32_t tSum = 0;
+    for (int y = tStartY; y < tStartY + tHeight; ++y) {
+        // content at previous (x, y) is now at current (x + shift, y + shift)
+        tSum += sumOfAbsoluteDifferences(&aPrevious[y - aShiftY][tStartX - aShiftX], &aCurrent[y][tStartX], tWidth);
+    }
+    return (tSum * 16) / (tWidth * tHeight);
+}
+
+/*
+ * Decodes and evaluates the frame, if the last sample is old enough
+ * @return true if a new sample was taken, then MotionEstimate is updated
+ */
+static bool processFrameForMotionEstimation(camera_fb_t *aFrame) {
+    unsigned long tMillis = millis();
+    bool tMotorIsRunning = sOnePWMMotorIsSupported && !isMotorStopped();
+    unsigned long tSampleMillis = tMotorIsRunning ? MOTION_SAMPLE_MILLIS_DRIVING : MOTION_SAMPLE_MILLIS_STANDING;
+    if (sDecodeBuffer == NULL || aFrame->format != PIXFORMAT_JPEG || tMillis - MotionEstimate.MillisOfLastSample < tSampleMillis) {
+        return false;
+    }
+    int tWidth = aFrame->width / 8;
+    int tHeight = aFrame->height / 8;
+    if ((size_t) (tWidth * tHeight * 2) > sDecodeBufferSize || tWidth > 200) {
+        return false; // framesize too big for buffer
+    }
+    int64_t tStartMicros = esp_timer_get_time();
+    if (!jpg2rgb565(aFrame->buf, aFrame->len, sDecodeBuffer, JPG_SCALE_8X)) {
+        MotionEstimate.NumberOfDecodeErrors++;
+        return false;
+    }
+    uint8_t (*tCurrent)[MOTION_GRID_WIDTH] = sLuminanceGrids[sCurrentGridIndex];
+    uint8_t (*tPrevious)[MOTION_GRID_WIDTH] = sLuminanceGrids[sCurrentGridIndex ^ 1];
+    computeLuminanceGrid(sDecodeBuffer, tWidth, tHeight, tCurrent);
+
+    if (sPreviousGridIsValid) {
+        uint32_t tUnshiftedDifference = getShiftedDifference(tPrevious, tCurrent, 0, 0);
+        uint32_t tBestDifference = tUnshiftedDifference;
+        int8_t tBestShiftX = 0;
+        int8_t tBestShiftY = 0;
+        for (int tShiftY = -MOTION_MAX_SHIFT; tShiftY <= MOTION_MAX_SHIFT; ++tShiftY) {
+            for (int tShiftX = -MOTION_MAX_SHIFT; tShiftX <= MOTION_MAX_SHIFT; ++tShiftX) {
+                uint32_t tDifference = getShiftedDifference(tPrevious, tCurrent, tShiftX, tShiftY);
+                if (tDifference < tBestDifference) {
+                    tBestDifference = tDifference;
+                    tBestShiftX = tShiftX;
+                    tBestShiftY = tShiftY;
+                }
+            }
+        }
+        // A shift counts only if it explains the difference clearly better than no shift
+        if (tBestDifference * 5 > tUnshiftedDifference * 4) {
+            tBestShiftX = 0;
+            tBestShiftY = 0;
+        }
+        MotionEstimate.ShiftX = tBestShiftX;
+        MotionEstimate.ShiftY = tBestShiftY;
+        MotionEstimate.SceneChangeScore = min(tUnshiftedDifference / 16, (uint32_t) UINT8_MAX);
+        MotionEstimate.IsMoving = MotionEstimate.SceneChangeScore > MOTION_SCENE_CHANGE_THRESHOLD || tBestShiftX != 0
+                || tBestShiftY != 0;
+        if (MotionEstimate.IsMoving) {
+            if (tMotorIsRunning && MotionEstimate.MillisOfLastSample != 0) {
+                MotionEstimate.VisualOdometerMillimeter += (getMotorMillimeterPerSecond()
+                        * (int32_t) (tMillis - MotionEstimate.MillisOfLastSample)) / 1000;
+            }
+            MotionEstimate.MillisOfLastMovement = tMillis;
+        }
+    }
+    sPreviousGridIsValid = true;
+    sCurrentGridIndex ^= 1;
+    MotionEstimate.MillisOfLastSample = tMillis;
+    MotionEstimate.NumberOfSamples++;
+    MotionEstimate.LastSampleMicros = esp_timer_get_time() - tStartMicros;
+    if (MotionEstimate.MaxSampleMicros < MotionEstimate.LastSampleMicros) {
+        MotionEstimate.MaxSampleMicros = MotionEstimate.LastSampleMicros;
+    }
+    return true;
+}
+
+/*
+ * @return number of characters printed
+ */
+int printMotionEstimate(char *aBuffer) {
+    return sprintf(aBuffer, "\"motion_shift_x\":%d,\"motion_shift_y\":%d,\"motion_scene_change\":%u,\"motion_moving\":%d,"
+            "\"visual_odometer_mm\":%ld,\"motion_samples\":%lu,\"motion_decode_errors\":%lu,\"motion_sample_us\":%lu,"
+            "\"motion_max_sample_us\":%lu,", MotionEstimate.ShiftX, MotionEstimate.ShiftY, MotionEstimate.SceneChangeScore,
+            MotionEstimate.IsMoving, (long) MotionEstimate.VisualOdometerMillimeter, (unsigned long) MotionEstimate.NumberOfSamples,
+            (unsigned long) MotionEstimate.NumberOfDecodeErrors, (unsigned long) MotionEstimate.LastSampleMicros,
+            (unsigned long) MotionEstimate.MaxSampleMicros);
+}
+
+/*
+ * Called by the stream task for each frame, before it is sent, since the result also decides if the frame of a static scene is skipped.
+ * Between the samples of the estimator, the frame counts as unchanged. Without decoding, the JPEG size is compared.
+ * @return true if the image changed, i.e. the car or something in the pipe moves
+ */
+bool checkFrameForMotion(camera_fb_t *aFrame, bool aUseEstimator) {
+    bool tFrameSizeHasChanged = hasFrameSizeChanged(aFrame->len);
+    if (!aUseEstimator) {
+        return tFrameSizeHasChanged;
+    }
+    if (processFrameForMotionEstimation(aFrame)) {
+        return MotionEstimate.IsMoving;
+    }
+    if (millis() - MotionEstimate.MillisOfLastSample <= MOTION_SAMPLE_MILLIS_STANDING) {
+        return false; // wait for next sample
+    }
+    return tFrameSizeHasChanged; // estimator can not decode this frame
+}
@@ -0,0 +1,71 @@
+/*
+ * MotionEstimator.h
+ *
+ *  Frame difference motion estimator working on a coarse luminance grid of the stream frames.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _MOTION_ESTIMATOR_H
+#define _MOTION_ESTIMATOR_H
+
+#include <stdint.h>
+#include "esp_camera.h"
+
+/*
+ * The JPEG is decoded with 1/8 scale, i.e. only the DC coefficients, and then averaged to a fixed grid.
+ * VGA gives 80 x 60 decoded pixels, so one grid cell is 2.5 x 2.5 decoded or 20 x 20 frame pixels.
+ */
+#define MOTION_GRID_WIDTH                   32
+#define MOTION_GRID_HEIGHT                  24
+#define MOTION_MAX_SHIFT                    3   // search range in grid cells for the frame to frame shift
+#define MOTION_SCENE_CHANGE_THRESHOLD       6   // mean absolute luminance difference, above which the scene changed
+#define MOTION_SAMPLE_MILLIS_DRIVING        100
+#define MOTION_SAMPLE_MILLIS_STANDING       500
+#define MOTION_FRAME_CHANGE_PERCENT         2   // fallback without decoding: change of JPEG size, which is taken as movement
+#define MOTION_MAX_DECODED_BYTES_NO_PSRAM   (100 * 75 * 2)  // SVGA with 1/8 scale as RGB565
+
+struct MotionEstimateStruct {
+    int8_t ShiftX;                  // in grid cells, positive if image content moved right
+    int8_t ShiftY;                  // in grid cells, positive if image content moved down
+    uint8_t SceneChangeScore;       // mean absolute luminance difference of the grid without shift
+    bool IsMoving;                  // scene changed or best match is shifted
+    unsigned long MillisOfLastSample;
+    unsigned long MillisOfLastMovement;
+    int32_t VisualOdometerMillimeter; // expected motor speed integrated over the time the image moves
+    uint32_t NumberOfSamples;
+    uint32_t NumberOfDecodeErrors;
+    uint32_t LastSampleMicros;      // duration of decode and estimation
+    uint32_t MaxSampleMicros;
+};
+extern MotionEstimateStruct MotionEstimate;
+
+/*
+ * @param aHigh, aLow bytes of a big endian RGB565 pixel, as delivered by jpg2rgb565()
+ * @return luminance weighted 0.3 R, 0.59 G, 0.11 B in the range 0 to 250
+ */
+inline uint8_t getLuminanceOfRGB565(uint8_t aHigh, uint8_t aLow) {
+    return ((aHigh >> 3) * 77 * 8 + (((aHigh & 0x07) << 3) | (aLow >> 5)) * 150 * 4 + (aLow & 0x1F) * 29 * 8) >> 8;
+}
+
+bool initMotionEstimator();
+bool checkFrameForMotion(camera_fb_t *aFrame, bool aUseEstimator);
+int printMotionEstimate(char *aBuffer);
+
+#endif // _MOTION_ESTIMATOR_H
@@ -0,0 +1,511 @@
+/*
+ * MotionQueue.cpp
+ *
+ *  On-device queue of timed motion primitives like "drive:20,pan:45,dwell:1000,capture,pan:135,drive:20".
+ *  The whole queue is submitted with one request and executed step by step by the loop scheduler,
+ *  so there are no network round trips between the steps.
+ *  Captured stills are written to SPIFFS and can be fetched with /motion?still=<n>.
+ *  The survey mode generates a queue, which captures stills at several pan angles at each waypoint.
+ *  Stills are taken with a high framesize, driving is done with the faster stream framesize.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "freertos/semphr.h"
+
+#include "MotionQueue.h"
+#include "LoopScheduler.h"
+#include "storage.h"
+#include "esp32-cam-webserver.h"
+#include "MotorAndServoControl.h"
+#include "CameraSettings.h"
+#include "StillSequencer.h"
+
+#define MOTION_PAN_SETTLE_MILLIS        100 // after end of eased move
+#define MOTION_DWELL_MAX_MILLIS         60000
+#define MOTION_DRIVE_MAX_CENTIMETER     1000
+#define MOTION_POLL_MILLIS              10  // for end of drive and pan
+
+const char *const MotionStepNames[] = { "drive", "stop", "pan", "dwell", "capture", "framesize", "tilt", "still" };
+
+struct MotionQueueStruct {
+    MotionStepStruct Steps[MOTION_QUEUE_MAX_STEPS];
+    uint8_t NumberOfSteps;
+    uint8_t CurrentStep;
+    uint8_t State;                  // MOTION_QUEUE_IDLE, MOTION_QUEUE_RUNNING, MOTION_QUEUE_DONE or MOTION_QUEUE_ABORTED
+    bool StepIsStarted;
+    unsigned long StepEndMillis;    // for pan and dwell
+    int16_t DistanceCentimeter;     // sum of all finished drive steps, measured by encoder if supported
+    uint16_t NumberOfCaptures;      // captures of current queue
+    uint16_t NumberOfCaptureErrors;
+    int8_t LastStillIndex;          // -1 if no still captured yet
+    int32_t StartOdometerMillimeter; // odometer at start of queue
+};
+
+MotionQueueStruct sMotionQueue = { { }, 0, 0, MOTION_QUEUE_IDLE, false, 0, 0, 0, 0, -1, 0 };
+MotionStillInfoStruct MotionStillInfos[MOTION_MAX_STILLS];
+uint8_t sNextStillIndex = 0;
+SemaphoreHandle_t sMotionQueueLock;
+volatile bool sMotionQueueAbortIsRequested = false; // set by requestMotionQueueAbort() if the lock is busy
+
+/*
+ * Must be called before the server is started
+ */
+void initMotionQueue() {
+    sMotionQueueLock = xSemaphoreCreateMutex();
+}
+
+/*
+ * @param aExtension "jpg" for the still or "json" for its metadata
+ */
+void getMotionStillFilename(char *aFilename, int aStillIndex, const char *aExtension) {
+    sprintf(aFilename, MOTION_STILL_FILE_PREFIX "%d.%s", aStillIndex, aExtension);
+}
+
+/*
+ * @return true if the step is valid
+ */
+static bool parseMotionStep(char *aStepString, MotionStepStruct *aStep) {
+    char *tValueString = strchr(aStepString, ':');
+    if (tValueString != NULL) {
+        *tValueString++ = '\0';
+    }
+    for (uint_fast8_t i = 0; i < sizeof(MotionStepNames) / sizeof(MotionStepNames[0]); ++i) {
+        if (!strcmp(aStepString, MotionStepNames[i])) {
+            aStep->Type = i;
+            if (i == MOTION_STEP_STOP || i == MOTION_STEP_CAPTURE || i == MOTION_STEP_STILL) {
+                aStep->Value = 0;
+                return (tValueString == NULL);
+            }
+            if (tValueString == NULL || *tValueString == '\0') {
+                return false;
+            }
+            char *tEnd;
+            long tValue = strtol(tValueString, &tEnd, 10);
+            if (*tEnd != '\0') {
+                return false;
+            }
+            aStep->Value = tValue;
+            if (i == MOTION_STEP_DRIVE) {
+                return (tValue != 0 && tValue >= -MOTION_DRIVE_MAX_CENTIMETER && tValue <= MOTION_DRIVE_MAX_CENTIMETER);
+            }
+            if (i == MOTION_STEP_PAN || i == MOTION_STEP_TILT) {
+                return (tValue >= 0 && tValue <= 180);
+            }
+            if (i == MOTION_STEP_FRAMESIZE) {
+                return (tValue >= 0 && tValue < FRAMESIZE_INVALID);
+            }
+            return (tValue >= 0 && tValue <= MOTION_DWELL_MAX_MILLIS);
+        }
+    }
+    return false;
+}
+
+static void startMotionQueue(MotionStepStruct *aSteps, int aNumberOfSteps);
+
+/*
+ * Parses a comma separated list of steps and replaces the current queue, which is aborted if still running.
+ * aStepList is modified.
+ * @return number of steps or -1 if the list contains an invalid step. In this case the current queue is kept.
+ */
+int submitMotionQueue(char *aStepList) {
+    MotionStepStruct tSteps[MOTION_QUEUE_MAX_STEPS];
+    int tNumberOfSteps = 0;
+    char *tSavePointer;
+    char *tStepString = strtok_r(aStepList, ",", &tSavePointer);
+    while (tStepString != NULL) {
+        if (tNumberOfSteps >= MOTION_QUEUE_MAX_STEPS || !parseMotionStep(tStepString, &tSteps[tNumberOfSteps])) {
+            return -1;
+        }
+        tNumberOfSteps++;
+        tStepString = strtok_r(NULL, ",", &tSavePointer);
+    }
+    if (tNumberOfSteps == 0) {
+        return -1;
+    }
+    startMotionQueue(tSteps, tNumberOfSteps);
+    return tNumberOfSteps;
+}
+
+/*
+ * Replaces the current queue, which is aborted if still running
+ */
+static void startMotionQueue(MotionStepStruct *aSteps, int aNumberOfSteps) {
+    xSemaphoreTake(sMotionQueueLock, portMAX_DELAY);
+    if (sMotionQueue.State == MOTION_QUEUE_RUNNING && sMotionQueue.Steps[sMotionQueue.CurrentStep].Type == MOTION_STEP_DRIVE) {
+        stopMotor();
+    }
+    memcpy(sMotionQueue.Steps, aSteps, aNumberOfSteps * sizeof(MotionStepStruct));
+    sMotionQueue.NumberOfSteps = aNumberOfSteps;
+    sMotionQueue.CurrentStep = 0;
+    sMotionQueue.StepIsStarted = false;
+    sMotionQueue.DistanceCentimeter = 0;
+    sMotionQueue.StartOdometerMillimeter = getOdometerMillimeter();
+    sMotionQueue.NumberOfCaptures = 0;
+    sMotionQueue.NumberOfCaptureErrors = 0;
+    sMotionQueue.State = MOTION_QUEUE_RUNNING;
+    xSemaphoreGive(sMotionQueueLock);
+
+    Serial.printf("Motion queue with %d steps started\r\n", aNumberOfSteps);
+    wakeLoopScheduler();
+}
+
+/*
+ * Parameters are <step_cm>,<number_of_waypoints>,<pan_degree>,<pan_degree>...
+ * At each waypoint a still is captured at each pan angle and the pan is set to front for driving to the next waypoint.
+ * The stills are taken by the still sequencer, which switches to the still framesize only for the duration of each still,
+ * so the stream keeps its framesize while driving and panning.
+ * aParameterList is modified.
+ * @return number of generated steps or -1 if parameters are invalid or the survey does not fit in the queue
+ */
+int submitSurvey(char *aParameterList) {
+    int tParameters[2 + MOTION_SURVEY_MAX_PANS];
+    int tNumberOfParameters = 0;
+    char *tSavePointer;
+    char *tParameterString = strtok_r(aParameterList, ",", &tSavePointer);
+    while (tParameterString != NULL) {
+        char *tEnd;
+        if (tNumberOfParameters >= (int) (sizeof(tParameters) / sizeof(tParameters[0]))) {
+            return -1;
+        }
+        tParameters[tNumberOfParameters++] = strtol(tParameterString, &tEnd, 10);
+        if (*tEnd != '\0') {
+            return -1;
+        }
+        tParameterString = strtok_r(NULL, ",", &tSavePointer);
+    }
+    int tStepCentimeter = tParameters[0];
+    int tNumberOfWaypoints = tParameters[1];
+    int tNumberOfPans = tNumberOfParameters - 2;
+    if (tNumberOfPans < 1 || tStepCentimeter == 0 || tStepCentimeter < -MOTION_DRIVE_MAX_CENTIMETER
+            || tStepCentimeter > MOTION_DRIVE_MAX_CENTIMETER || tNumberOfWaypoints < 1
+            || tNumberOfWaypoints * (2 + 2 * tNumberOfPans) > MOTION_QUEUE_MAX_STEPS) {
+        return -1;
+    }
+
+    MotionStepStruct tSteps[MOTION_QUEUE_MAX_STEPS];
+    int tNumberOfSteps = 0;
+    for (int tWaypoint = 0; tWaypoint < tNumberOfWaypoints; ++tWaypoint) {
+        if (tWaypoint > 0) {
+            tSteps[tNumberOfSteps++] = {MOTION_STEP_DRIVE, (int16_t) tStepCentimeter};
+        }
+        for (int i = 0; i < tNumberOfPans; ++i) {
+            int tPanDegree = constrain(tParameters[2 + i], 0, 180);
+            tSteps[tNumberOfSteps++] = {MOTION_STEP_PAN, (int16_t) tPanDegree};
+            tSteps[tNumberOfSteps++] = {MOTION_STEP_STILL, 0};
+        }
+        tSteps[tNumberOfSteps++] = {MOTION_STEP_PAN, 90};
+    }
+    startMotionQueue(tSteps, tNumberOfSteps);
+    return tNumberOfSteps;
+}
+
+/*
+ * sMotionQueueLock must be taken
+ * @return true if a running queue was aborted
+ */
+static bool abortRunningMotionQueue() {
+    if (sMotionQueue.State != MOTION_QUEUE_RUNNING) {
+        return false;
+    }
+    stopMotor();
+    sMotionQueue.State = MOTION_QUEUE_ABORTED;
+    Serial.println("Motion queue aborted");
+    return true;
+}
+
+/*
+ * Waits for a running capture step
+ * @return true if a running queue was aborted
+ */
+bool abortMotionQueue() {
+    xSemaphoreTake(sMotionQueueLock, portMAX_DELAY);
+    bool tWasRunning = abortRunningMotionQueue();
+    xSemaphoreGive(sMotionQueueLock);
+    return tWasRunning;
+}
+
+/*
+ * Non blocking abort for the failsafe timer callback, which runs in the esp_timer task together with the motor and gimbal timers.
+ * If the lock is busy, e.g. by a capture step, runMotionQueue() aborts the queue before the next step is started.
+ * @return true if a running queue was or will be aborted
+ */
+bool requestMotionQueueAbort() {
+    if (xSemaphoreTake(sMotionQueueLock, 0) == pdTRUE) {
+        bool tWasRunning = abortRunningMotionQueue();
+        xSemaphoreGive(sMotionQueueLock);
+        return tWasRunning;
+    }
+    if (sMotionQueue.State != MOTION_QUEUE_RUNNING) {
+        return false;
+    }
+    sMotionQueueAbortIsRequested = true;
+    wakeLoopScheduler();
+    return true;
+}
+
+/*
+ * Prints the metadata of a still as JSON object
+ * @return number of characters printed
+ */
+static int printMotionStillInfo(char *aBuffer, int aStillIndex) {
+    MotionStillInfoStruct *tStillInfo = &MotionStillInfos[aStillIndex];
+    return sprintf(aBuffer, "{\"n\":%d,\"distance\":%d,\"pan\":%u,\"framesize\":%u}", aStillIndex, tStillInfo->DistanceCentimeter,
+            tStillInfo->PanDegree, tStillInfo->Framesize);
+}
+
+/*
+ * Writes the JPEG and its metadata to the next file of the still ring
+ * @return true if still was written
+ */
+static bool writeStillFile(const uint8_t *aBuffer, size_t aLength, uint8_t aFramesize) {
+    bool tSuccess = false;
+    MotionStillInfoStruct *tStillInfo = &MotionStillInfos[sNextStillIndex];
+    tStillInfo->IsValid = false;
+    char tFilename[32];
+    getMotionStillFilename(tFilename, sNextStillIndex, "jpg");
+    File tFile = SPIFFS.open(tFilename, FILE_WRITE);
+    if (tFile) {
+        tSuccess = (tFile.write(aBuffer, aLength) == aLength);
+        tFile.close();
+    }
+    if (!tSuccess) {
+        Serial.printf("Motion queue: writing %s failed\r\n", tFilename);
+        return false;
+    }
+    tStillInfo->IsValid = true;
+    tStillInfo->DistanceCentimeter = sMotionQueue.DistanceCentimeter;
+    tStillInfo->PanDegree = 180 - ServoPanDegree; // ServoPanDegree has the inverted servo convention
+    tStillInfo->Framesize = aFramesize;
+    Serial.printf("Motion queue: still %s with %u bytes at %d cm pan %u written\r\n", tFilename, aLength,
+            tStillInfo->DistanceCentimeter, tStillInfo->PanDegree);
+    // Metadata file beside the still
+    char tMetadata[80];
+    printMotionStillInfo(tMetadata, sNextStillIndex);
+    getMotionStillFilename(tFilename, sNextStillIndex, "json");
+    tFile = SPIFFS.open(tFilename, FILE_WRITE);
+    if (tFile) {
+        tFile.print(tMetadata);
+        tFile.close();
+    }
+    sMotionQueue.LastStillIndex = sNextStillIndex;
+    sNextStillIndex = (sNextStillIndex + 1) % MOTION_MAX_STILLS;
+    return true;
+}
+
+/*
+ * Writes a fresh frame with the current framesize to the next file of the still ring
+ * @return true if still was written
+ */
+static bool captureFrame() {
+    if (autoLampValue && (lampBrightnessPercentage != -1)) {
+        setLamp(lampBrightnessPercentage);
+    }
+    camera_fb_t *fb = esp_camera_fb_get();
+    /*
+     * Skip complete framebuffer
+     */
+    for (int i = 0; i < sNumberOfFramebuffer; ++i) {
+        esp_camera_fb_return(fb); // dispose the buffered image
+        fb = esp_camera_fb_get(); // get fresh image
+    }
+    updateLamp();
+    if (!fb) {
+        Serial.println("Motion queue: failed to acquire frame");
+        return false;
+    }
+    bool tSuccess = false;
+    if (fb->format == PIXFORMAT_JPEG) {
+        tSuccess = writeStillFile(fb->buf, fb->len, esp_camera_sensor_get()->status.framesize);
+    }
+    esp_camera_fb_return(fb);
+    if (tSuccess) {
+        imagesServed++; // the still sequencer counts its stills itself
+    }
+    return tSuccess;
+}
+
+static bool writeSequencerStill(const StillStruct *aStill, void *aContext) {
+    (void) aContext;
+    return writeStillFile(aStill->Buffer, aStill->Length, aStill->Framesize);
+}
+
+/*
+ * Takes a still with STILL_FRAMESIZE by a still sequence, which switches the framesize only for this still.
+ * Without PSRAM, the still sequencer is not available and the frame is taken with the current framesize.
+ * @return true if still was written
+ */
+static bool captureSequencerStill() {
+    int tStillNumber = queueStills(1);
+    if (tStillNumber < 0) {
+        Serial.println("Motion queue: still sequencer not available, capture with current framesize");
+        return captureFrame();
+    }
+    runStillSequence(); // takes also the stills queued by http requests
+    return sendStill(tStillNumber, writeSequencerStill, NULL);
+}
+
+/*
+ * @param aUseStillSequencer true for a still with STILL_FRAMESIZE, false for the current framesize
+ */
+static void captureStill(bool aUseStillSequencer) {
+    if (!filesystem) {
+        Serial.println("No filesystem for motion queue still");
+        sMotionQueue.NumberOfCaptureErrors++;
+        return;
+    }
+    if (aUseStillSequencer ? captureSequencerStill() : captureFrame()) {
+        sMotionQueue.NumberOfCaptures++;
+    } else {
+        sMotionQueue.NumberOfCaptureErrors++;
+    }
+}
+
+/*
+ * Starts the current step
+ * @return true if step is already finished
+ */
+static bool startMotionStep(MotionStepStruct *aStep) {
+    switch (aStep->Type) {
+    case MOTION_STEP_DRIVE:
+        startMotorDistanceCentimeter(aStep->Value);
+        return false;
+    case MOTION_STEP_STOP:
+        stopMotor();
+        return true;
+    case MOTION_STEP_PAN:
+        setServoPan(aStep->Value);
+        sMotionQueue.StepEndMillis = millis() + MOTION_PAN_SETTLE_MILLIS;
+        return false;
+    case MOTION_STEP_TILT:
+        setServoTilt(aStep->Value);
+        sMotionQueue.StepEndMillis = millis() + MOTION_PAN_SETTLE_MILLIS;
+        return false;
+    case MOTION_STEP_DWELL:
+        sMotionQueue.StepEndMillis = millis() + aStep->Value;
+        return false;
+    case MOTION_STEP_FRAMESIZE:
+        // Via the cache, so nothing is written if the framesize is already set
+        writeCameraSetting(esp_camera_sensor_get(), findCameraSetting("framesize"), aStep->Value);
+        return true;
+    case MOTION_STEP_STILL:
+        captureStill(true); // a failed capture does not abort the queue
+        return true;
+    default:
+        captureStill(false);
+        return true;
+    }
+}
+
+/*
+ * Loop scheduler task
+ * @return milliseconds until the next call is required
+ */
+uint32_t runMotionQueue() {
+    uint32_t tMillisUntilNextCall = LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+    xSemaphoreTake(sMotionQueueLock, portMAX_DELAY);
+    while (sMotionQueue.State == MOTION_QUEUE_RUNNING) {
+        if (sMotionQueueAbortIsRequested) {
+            abortRunningMotionQueue();
+            break;
+        }
+        MotionStepStruct *tStep = &sMotionQueue.Steps[sMotionQueue.CurrentStep];
+        bool tStepIsFinished;
+        if (!sMotionQueue.StepIsStarted) {
+            sMotionQueue.StepIsStarted = true;
+            sMillisOfLastAction = millis();
+            tStepIsFinished = startMotionStep(tStep);
+        } else if (tStep->Type == MOTION_STEP_DRIVE) {
+            tStepIsFinished = isMotorStopped();
+        } else if ((tStep->Type == MOTION_STEP_PAN || tStep->Type == MOTION_STEP_TILT) && isGimbalMoving()) {
+            // settle time starts at the end of the eased move
+            sMotionQueue.StepEndMillis = millis() + MOTION_PAN_SETTLE_MILLIS;
+            tStepIsFinished = false;
+        } else {
+            tStepIsFinished = ((long) (millis() - sMotionQueue.StepEndMillis) >= 0);
+        }
+
+        if (!tStepIsFinished) {
+            if (tStep->Type == MOTION_STEP_DRIVE
+                    || ((tStep->Type == MOTION_STEP_PAN || tStep->Type == MOTION_STEP_TILT) && isGimbalMoving())) {
+                tMillisUntilNextCall = MOTION_POLL_MILLIS;
+            } else {
+                tMillisUntilNextCall = sMotionQueue.StepEndMillis - millis();
+            }
+            break;
+        }
+        if (tStep->Type == MOTION_STEP_DRIVE) {
+            if (sEncoderIsSupported) {
+                sMotionQueue.DistanceCentimeter = (getOdometerMillimeter() - sMotionQueue.StartOdometerMillimeter) / 10;
+            } else {
+                sMotionQueue.DistanceCentimeter += tStep->Value;
+            }
+        }
+        if (tStep->Type == MOTION_STEP_DRIVE && isMotorStalled()) {
+            // Following drive steps would stall again
+            sMotionQueue.State = MOTION_QUEUE_ABORTED;
+            Serial.println("Motion queue aborted, motor stalled");
+            break;
+        }
+        sMotionQueue.StepIsStarted = false;
+        sMotionQueue.CurrentStep++;
+        if (sMotionQueue.CurrentStep >= sMotionQueue.NumberOfSteps) {
+            sMotionQueue.State = MOTION_QUEUE_DONE;
+            Serial.println("Motion queue done");
+        }
+    }
+    if (sMotionQueue.State != MOTION_QUEUE_RUNNING) {
+        sMotionQueueAbortIsRequested = false; // the request is for this queue, not for the next one
+    }
+    xSemaphoreGive(sMotionQueueLock);
+    return tMillisUntilNextCall;
+}
+
+/*
+ * Prints progress of the queue and the metadata of all stills as JSON object
+ * @return number of characters printed
+ */
+int printMotionQueueStatus(char *aBuffer) {
+    const char *const tStateNames[] = { "idle", "running", "done", "aborted" };
+    char *p = aBuffer;
+    xSemaphoreTake(sMotionQueueLock, portMAX_DELAY);
+    p += sprintf(p, "{\"state\":\"%s\",\"step\":%u,\"steps\":%u,", tStateNames[sMotionQueue.State], sMotionQueue.CurrentStep,
+            sMotionQueue.NumberOfSteps);
+    if (sMotionQueue.State == MOTION_QUEUE_RUNNING) {
+        p += sprintf(p, "\"current\":\"%s\",", MotionStepNames[sMotionQueue.Steps[sMotionQueue.CurrentStep].Type]);
+    }
+    p += sprintf(p, "\"distance\":%d,\"captures\":%u,\"capture_errors\":%u,\"last_still\":%d,\"stills\":[",
+            sMotionQueue.DistanceCentimeter, sMotionQueue.NumberOfCaptures, sMotionQueue.NumberOfCaptureErrors,
+            sMotionQueue.LastStillIndex);
+    bool tIsFirst = true;
+    for (int i = 0; i < MOTION_MAX_STILLS; ++i) {
+        if (MotionStillInfos[i].IsValid) {
+            if (!tIsFirst) {
+                *p++ = ',';
+            }
+            tIsFirst = false;
+            p += printMotionStillInfo(p, i);
+        }
+    }
+    p += sprintf(p, "]}");
+    xSemaphoreGive(sMotionQueueLock);
+    return p - aBuffer;
+}
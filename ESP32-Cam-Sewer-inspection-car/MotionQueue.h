@@ -0,0 +1,78 @@
+/*
+ * MotionQueue.h
+ *
+ *  On-device queue of motion primitives, which is executed by the loop scheduler, and survey mode built on it.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _MOTION_QUEUE_H
+#define _MOTION_QUEUE_H
+
+#include <stdint.h>
+
+#define MOTION_QUEUE_MAX_STEPS  64
+#define MOTION_MAX_STILLS       8   // captured stills are stored in a ring of files on SPIFFS
+#define MOTION_STILL_FILE_PREFIX "/still-"
+
+#define MOTION_STEP_DRIVE       0   // Value is centimeter, negative values go backward
+#define MOTION_STEP_STOP        1
+#define MOTION_STEP_PAN         2   // Value is degree, 0 is left, 180 is right
+#define MOTION_STEP_DWELL       3   // Value is milliseconds
+#define MOTION_STEP_CAPTURE     4   // Capture still to SPIFFS
+#define MOTION_STEP_FRAMESIZE   5   // Value is framesize_t
+#define MOTION_STEP_TILT        6   // Value is degree, 0 is down, 180 is up
+#define MOTION_STEP_STILL       7   // Capture still with STILL_FRAMESIZE by the still sequencer to SPIFFS
+
+#define MOTION_QUEUE_IDLE       0
+#define MOTION_QUEUE_RUNNING    1
+#define MOTION_QUEUE_DONE       2
+#define MOTION_QUEUE_ABORTED    3
+
+struct MotionStepStruct {
+    uint8_t Type;
+    int16_t Value;
+};
+
+/*
+ * Metadata of a captured still, also stored in a .json file beside the .jpg file
+ */
+struct MotionStillInfoStruct {
+    bool IsValid;
+    int16_t DistanceCentimeter;     // driven since start of queue
+    uint8_t PanDegree;              // 0 is left, 180 is right
+    uint8_t Framesize;
+};
+extern MotionStillInfoStruct MotionStillInfos[MOTION_MAX_STILLS];
+
+/*
+ * Survey: stills are taken with STILL_FRAMESIZE by the still sequencer, the stream keeps its framesize
+ */
+#define MOTION_SURVEY_MAX_PANS          8
+
+void initMotionQueue();
+int submitMotionQueue(char *aStepList);
+int submitSurvey(char *aParameterList);
+bool abortMotionQueue();
+bool requestMotionQueueAbort();
+uint32_t runMotionQueue();
+int printMotionQueueStatus(char *aBuffer);
+void getMotionStillFilename(char *aFilename, int aStillIndex, const char *aExtension);
+
+#endif // _MOTION_QUEUE_H
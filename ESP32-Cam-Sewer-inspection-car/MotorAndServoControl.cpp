@@ -26,9 +26,14 @@
 
 #include <Arduino.h>
 #include "hal/ledc_types.h"
+#include <esp_timer.h>
+#include <limits.h>
+#include <time.h>
+#include "freertos/semphr.h"
 
 #include "ESP32Servo.h"
 #include "esp32-cam-webserver.h"
+#include "LedcChannelMap.h"
 
 /*
  * You will need to change these values according to your motor, H-bridge and motor supply voltage.
@@ -42,14 +47,24 @@
 #define MOSFET_BRIDGE_USED  // Activate this, if you use a (recommended) mosfet bridge instead of a L298 bridge, which has higher losses.
 //#define DEFAULT_DRIVE_MILLIVOLT       2000 // Drive voltage -motors default speed- is 2.0 volt
 //#define DO_NOT_SUPPORT_RAMP  // Ramps are anyway not used if drive speed voltage (default 2.0 V) is below 2.3 V. Saves 378 bytes program space.
+#define ESP32_LEDC_MOTOR_CHANNEL            LEDC_MOTOR_CHANNEL
+#define ESP32_LEDC_MOTOR_CHANNEL_FREQUENCY  LEDC_MOTOR_FREQUENCY
+#define ESP32_LEDC_MOTOR_CHANNEL_RESOLUTION LEDC_MOTOR_RESOLUTION
 #include "PWMDcMotor.hpp" // include the sources of the PWMDcMotor library
 
 #include "MotorAndServoControl.h"
+#include "LoopScheduler.h"
+#include "EncoderOdometry.h"
+#include "MotorCalibration.h"
+#include "MotionQueue.h"
 
 PWMDcMotor DCMotor;
 
 int ServoPanDegree = 90; //default to front
-int LastMotorSpeed; // Set to DCMotor.DriveSpeedPWM. This value depends on FULL_BRIDGE_INPUT_MILLIVOLT, which is set by VIN_1_LI_ION
+int ServoTiltDegree = TILT_HORIZONTAL_DEGREE;
+int LastMotorSpeed; // Drive speed PWM for FULL_BRIDGE_INPUT_MILLIVOLT, which is set by VIN_1_LI_ION. Not compensated for the supply voltage.
+uint16_t sMotorSupplyMillivolt = 0; // Measured by battery monitor. 0 = not measured, no compensation
+#define MOTOR_SUPPLY_HYSTERESIS_MILLIVOLT   20 // smaller changes are not applied to the motor
 
 #define MILLIS_OF_INACTIVITY_BEFORE_REMINDER_MOVE 180000 // 3 Minutes
 #define MILLIS_OF_INACTIVITY_BETWEEN_REMINDER_MOVE 120000 // 2 Minutes
@@ -60,20 +75,18 @@ unsigned long sMillisOfLastAction;
 //#define DEFAULT_uS_HIGH     2400
 
 /*
- * Pin assignment
+ * Pin assignment. The LEDC channels are assigned in LedcChannelMap.h
  */
-//#define PAN_SERVO_CHANNEL   LEDC_CHANNEL_2
 #define PAN_SERVO_PIN           12
 Servo PanServo;
+static_assert(DEFAULT_TIMER_WIDTH == LEDC_SERVO_RESOLUTION, "Servo timer width differs from LedcChannelMap.h");
 
 #define DC_MOTOR_FORWARD_PIN    14
 #define DC_MOTOR_BACKWARD_PIN   15
-#define DC_MOTOR_SPEED_CHANNEL  LEDC_CHANNEL_4
 #define DC_MOTOR_SPEED_PIN      13
 
-//int ServoTiltDegree = 45; //default to horizontal
-//#define TILT_SERVO_CHANNEL  LEDC_CHANNEL_3
-//#define TILT_SERVO_PIN      2
+#define TILT_SERVO_PIN          2
+Servo TiltServo;
 
 #if !defined(ESP_ARDUINO_VERSION)
 #define ESP_ARDUINO_VERSION 0
@@ -110,29 +123,666 @@ Servo PanServo;
 //    sMillisOfLastAction = millis();
 //}
 
-void doAttention() {
+/*
+ * Non blocking gimbal movement of pan and tilt servo. A periodic esp_timer computes the eased position
+ * every SERVO_UPDATE_INTERVAL_MILLIS while the gimbal is moving, so frames can be streamed during a sweep.
+ * Both axes start together and get the duration of the axis with the larger move, so they arrive at the same time
+ * and the camera moves on a straight line between both positions.
+ * Further targets can be queued, they are started when the current move is finished.
+ * All positions here are in servo degree, which is the inverse of the GUI degree for pan.
+ */
+#define SERVO_UPDATE_INTERVAL_MILLIS    20  // the servo refresh period
+#define SERVO_TRAVEL_MILLIS_PER_DEGREE  3   // for moves without easing. A SG90 needs 0.1 s for 60 degree.
+#define GIMBAL_TARGET_QUEUE_SIZE        4
+#define GIMBAL_KEEP_DEGREE              (-1) // target of an axis, which should keep its current target
+int ServoPanSpeed = 120; // degree per second of the axis with the larger move, 0 moves the servos without easing
+uint8_t ServoPanEasing = PAN_EASE_QUADRATIC;
+
+struct GimbalAxisStruct {
+    Servo *AxisServo;
+    bool IsAttached;
+    float StartDegree;
+    float CurrentDegree;
+    int TargetDegree;
+};
+#define GIMBAL_AXIS_PAN         0
+#define GIMBAL_AXIS_TILT        1
+#define GIMBAL_NUMBER_OF_AXES   2
+GimbalAxisStruct sGimbalAxes[GIMBAL_NUMBER_OF_AXES] = { { &PanServo, false, 90, 90, 90 }, { &TiltServo, false,
+TILT_HORIZONTAL_DEGREE, TILT_HORIZONTAL_DEGREE, TILT_HORIZONTAL_DEGREE } };
+
+struct GimbalTargetStruct {
+    int16_t PanDegree;  // servo degree or GIMBAL_KEEP_DEGREE
+    int16_t TiltDegree; // servo degree or GIMBAL_KEEP_DEGREE
+};
+unsigned long sGimbalMoveStartMillis;
+unsigned long sGimbalMoveDurationMillis;
+bool sGimbalIsMoving = false;
+GimbalTargetStruct sGimbalTargetQueue[GIMBAL_TARGET_QUEUE_SIZE];
+uint8_t sGimbalTargetQueueLength = 0;
+esp_timer_handle_t sGimbalTimer;
+SemaphoreHandle_t sGimbalLock; // protects the values above against concurrent access by the timer task and the http server task
+
+/*
+ * Positions for "look=<name>", in GUI degree
+ */
+struct GimbalPresetStruct {
+    const char *Name;
+    int16_t PanDegree;
+    int16_t TiltDegree;
+};
+const GimbalPresetStruct GimbalPresets[] = { { "front", 90, TILT_HORIZONTAL_DEGREE }, { "left", 20, TILT_HORIZONTAL_DEGREE }, {
+        "right", 160, TILT_HORIZONTAL_DEGREE }, { "crown", 90, TILT_CROWN_DEGREE }, { "invert", 90, TILT_INVERT_DEGREE } };
+
+/*
+ * In-out easing, aRatio and return value are from 0.0 to 1.0
+ */
+float computePanEasing(float aRatio) {
+    if (ServoPanEasing == PAN_EASE_QUADRATIC) {
+        if (aRatio < 0.5) {
+            return 2 * aRatio * aRatio;
+        }
+        float tInverse = 2 - (2 * aRatio);
+        return 1 - ((tInverse * tInverse) / 2);
+    }
+    if (ServoPanEasing == PAN_EASE_CUBIC) {
+        if (aRatio < 0.5) {
+            return 4 * aRatio * aRatio * aRatio;
+        }
+        float tInverse = 2 - (2 * aRatio);
+        return 1 - ((tInverse * tInverse * tInverse) / 2);
+    }
+    return aRatio; // PAN_EASE_LINEAR
+}
+
+/*
+ * Higher resolution than Servo.write(int aDegree)
+ */
+void writeGimbalAxisDegree(GimbalAxisStruct *aAxis, float aServoDegree) {
+    aAxis->CurrentDegree = aServoDegree;
+    if (aAxis->IsAttached) {
+        aAxis->AxisServo->writeMicroseconds(DEFAULT_uS_LOW + (int) ((aServoDegree * (DEFAULT_uS_HIGH - DEFAULT_uS_LOW)) / 180));
+    }
+}
+
+/*
+ * Must be called with sGimbalLock taken
+ * @param aPanServoDegree or GIMBAL_KEEP_DEGREE
+ * @param aTiltServoDegree or GIMBAL_KEEP_DEGREE
+ */
+void startGimbalMove(int aPanServoDegree, int aTiltServoDegree) {
+    int tTargetDegrees[GIMBAL_NUMBER_OF_AXES] = { aPanServoDegree, aTiltServoDegree };
+    float tMaxDelta = 0;
+    for (uint_fast8_t i = 0; i < GIMBAL_NUMBER_OF_AXES; ++i) {
+        GimbalAxisStruct *tAxis = &sGimbalAxes[i];
+        if (tTargetDegrees[i] != GIMBAL_KEEP_DEGREE) {
+            tAxis->TargetDegree = tTargetDegrees[i];
+        }
+        tAxis->StartDegree = tAxis->CurrentDegree;
+        float tDelta = fabsf(tAxis->TargetDegree - tAxis->CurrentDegree);
+        if (tMaxDelta < tDelta) {
+            tMaxDelta = tDelta;
+        }
+    }
+
+    if (ServoPanSpeed <= 0) {
+        /*
+         * No easing, the servos move with their own speed. The move lasts for their estimated travel time,
+         * so a queued target, e.g. of the attention move, is started only after they arrived.
+         */
+        for (uint_fast8_t i = 0; i < GIMBAL_NUMBER_OF_AXES; ++i) {
+            writeGimbalAxisDegree(&sGimbalAxes[i], sGimbalAxes[i].TargetDegree);
+            sGimbalAxes[i].StartDegree = sGimbalAxes[i].TargetDegree; // the timer callback then writes only the target
+        }
+        sGimbalMoveDurationMillis = tMaxDelta * SERVO_TRAVEL_MILLIS_PER_DEGREE;
+    } else {
+        sGimbalMoveDurationMillis = (tMaxDelta * 1000) / ServoPanSpeed;
+    }
+    sGimbalMoveStartMillis = millis();
+    if (!sGimbalIsMoving) {
+        sGimbalIsMoving = true;
+        esp_timer_start_periodic(sGimbalTimer, SERVO_UPDATE_INTERVAL_MILLIS * 1000);
+    }
+}
+
+void gimbalTimerCallback(void *aArgument) {
+    (void) aArgument;
+    // Must not wait for the lock, this would block all other esp_timer callbacks. The next period retries.
+    if (xSemaphoreTake(sGimbalLock, 0) != pdTRUE) {
+        return;
+    }
+    if (sGimbalIsMoving) {
+        unsigned long tMillisSinceStart = millis() - sGimbalMoveStartMillis;
+        if (tMillisSinceStart >= sGimbalMoveDurationMillis) {
+            for (uint_fast8_t i = 0; i < GIMBAL_NUMBER_OF_AXES; ++i) {
+                writeGimbalAxisDegree(&sGimbalAxes[i], sGimbalAxes[i].TargetDegree);
+            }
+            if (sGimbalTargetQueueLength > 0) {
+                GimbalTargetStruct tNextTarget = sGimbalTargetQueue[0];
+                sGimbalTargetQueueLength--;
+                memmove(&sGimbalTargetQueue[0], &sGimbalTargetQueue[1], sGimbalTargetQueueLength * sizeof(sGimbalTargetQueue[0]));
+                startGimbalMove(tNextTarget.PanDegree, tNextTarget.TiltDegree);
+            } else {
+                sGimbalIsMoving = false;
+                esp_timer_stop(sGimbalTimer);
+            }
+        } else {
+            // Same ratio for both axes keeps them synchronized
+            float tRatio = computePanEasing((float) tMillisSinceStart / sGimbalMoveDurationMillis);
+            for (uint_fast8_t i = 0; i < GIMBAL_NUMBER_OF_AXES; ++i) {
+                GimbalAxisStruct *tAxis = &sGimbalAxes[i];
+                writeGimbalAxisDegree(tAxis, tAxis->StartDegree + ((tAxis->TargetDegree - tAxis->StartDegree) * tRatio));
+            }
+        }
+    }
+    xSemaphoreGive(sGimbalLock);
+}
+
+bool isGimbalMoving() {
+    return sGimbalIsMoving;
+}
+
+/*
+ * Moves to aNewDegree after all moves before are finished. Does not change ServoPanDegree, which is the position set by the user.
+ * @param aNewDegree 0 is left and 180 is right
+ */
+void queueServoPan(int aNewDegree) {
+    int tServoDegree = constrain((180 - aNewDegree), 0, 180);
+    xSemaphoreTake(sGimbalLock, portMAX_DELAY);
+    if (!sGimbalIsMoving) {
+        startGimbalMove(tServoDegree, GIMBAL_KEEP_DEGREE);
+    } else if (sGimbalTargetQueueLength < GIMBAL_TARGET_QUEUE_SIZE) {
+        sGimbalTargetQueue[sGimbalTargetQueueLength].PanDegree = tServoDegree;
+        sGimbalTargetQueue[sGimbalTargetQueueLength].TiltDegree = GIMBAL_KEEP_DEGREE;
+        sGimbalTargetQueueLength++;
+    }
+    xSemaphoreGive(sGimbalLock);
+}
+
+/*
+ * The attention move is a trajectory of 3 queued pan positions
+ */
+void startAttention() {
     if (sPanServoIsSupported) {
-        int tOriginalServoPanDegree = ServoPanDegree;
-        setServoPan(70);
-        delay(400);
-        setServoPan(110);
-        delay(400);
-        setServoPan(tOriginalServoPanDegree);
+        queueServoPan(70);
+        queueServoPan(110);
+        queueServoPan(180 - ServoPanDegree); // back to the position set by the user
+    }
+}
+
+/*
+ * The motor is updated by a one shot esp_timer exactly at the next ramp step or at the computed stop time,
+ * independent of the loop. The lock protects DCMotor against concurrent access by the timer task and the http server task.
+ */
+#define MOTOR_TIMER_RETRY_MICROS        500 // if the lock is held by the http server task
+esp_timer_handle_t sMotorTimer;
+SemaphoreHandle_t sMotorLock;
+
+/*
+ * For measuring the accuracy of the stop position
+ */
+unsigned long LastMotorStopLatenessMillis;
+unsigned long MaxMotorStopLatenessMillis;
+
+/*
+ * Closed loop distance and speed with wheel encoder.
+ * The motor is stopped at the target count, the open loop stop time of PWMDcMotor is only used as timeout.
+ */
+#define ENCODER_POLL_MILLIS             10  // interval for checking target count while driving
+#define ENCODER_SPEED_CONTROL_MILLIS    200 // interval for measuring and correcting the speed
+#define ENCODER_TIMEOUT_FACTOR          2   // timeout is 2 times the open loop duration
+struct EncoderDriveStruct {
+    bool IsActive;
+    uint32_t TargetCount;               // stop if EncoderCount reaches this value
+    uint16_t TargetCountsPerSecond;     // speed for DriveSpeedPWM as expected by the open loop calibration
+    uint32_t CountOfLastSpeedControl;
+    unsigned long MillisOfLastSpeedControl;
+};
+EncoderDriveStruct sEncoderDrive;
+uint16_t EncoderCountsPerSecond;        // last measured speed
+
+/*
+ * Must be called with sMotorLock taken
+ */
+void setEncoderTargetSpeed() {
+    sEncoderDrive.TargetCountsPerSecond = convertMillimeterToEncoderCount(DCMotor.convertMillisToMillimeter(DCMotor.DriveSpeedPWM, 1000));
+    if (sEncoderDrive.TargetCountsPerSecond == 0) {
+        sEncoderDrive.TargetCountsPerSecond = 1;
+    }
+}
+
+/*
+ * Reads the encoder, stops the motor at the target count and corrects the speed.
+ * Must be called with sMotorLock taken and before DCMotor.updateMotor(), to suppress the open loop lateness statistics.
+ */
+void updateEncoderDrive(unsigned long aMillis) {
+    updateEncoder(DCMotor.CurrentDirection == DIRECTION_BACKWARD); // counts after the stop are added to the last direction
+    if (!sEncoderDrive.IsActive) {
+        return;
+    }
+    if (DCMotor.isStopped()) {
+        // stopped by timeout
+        sEncoderDrive.IsActive = false;
+        return;
+    }
+    if ((int32_t) (EncoderCount - sEncoderDrive.TargetCount) >= 0) {
+        DCMotor.stop(STOP_MODE_BRAKE); // Brake for exact position
+        sEncoderDrive.IsActive = false;
+        return;
+    }
+
+    unsigned long tMillisSinceLastControl = aMillis - sEncoderDrive.MillisOfLastSpeedControl;
+    if (tMillisSinceLastControl >= ENCODER_SPEED_CONTROL_MILLIS) {
+        EncoderCountsPerSecond = ((EncoderCount - sEncoderDrive.CountOfLastSpeedControl) * 1000) / tMillisSinceLastControl;
+        sEncoderDrive.CountOfLastSpeedControl = EncoderCount;
+        sEncoderDrive.MillisOfLastSpeedControl = aMillis;
+#if !defined(DO_NOT_SUPPORT_RAMP)
+        if (DCMotor.MotorRampState == MOTOR_STATE_DRIVE) {
+#endif
+            // Proportional control, half of the error is corrected each time
+            int tSpeedError = (int) sEncoderDrive.TargetCountsPerSecond - EncoderCountsPerSecond;
+            int tNewSpeedPWM = DCMotor.RequestedSpeedPWM
+                    + (tSpeedError * DCMotor.DriveSpeedPWM) / (2 * (int) sEncoderDrive.TargetCountsPerSecond);
+            DCMotor.setSpeedPWM(constrain(tNewSpeedPWM, DEFAULT_START_SPEED_PWM, MAX_SPEED_PWM));
+#if !defined(DO_NOT_SUPPORT_RAMP)
+        }
+#endif
+    }
+}
+
+/*
+ * Must be called with sMotorLock taken, after DCMotor.startGoDistanceMillimeterWithSpeed()
+ */
+void startEncoderDrive(unsigned int aDistanceMillimeter) {
+    unsigned long tMillis = millis();
+    updateEncoder(DCMotor.CurrentDirection == DIRECTION_BACKWARD);
+    if (DCMotor.isStopped()) {
+        sEncoderDrive.IsActive = false;
+        return;
+    }
+    sEncoderDrive.TargetCount = EncoderCount + convertMillimeterToEncoderCount(aDistanceMillimeter);
+    sEncoderDrive.CountOfLastSpeedControl = EncoderCount;
+    sEncoderDrive.MillisOfLastSpeedControl = tMillis;
+    setEncoderTargetSpeed();
+    DCMotor.computedMillisOfMotorStopForDistance = tMillis
+            + (DCMotor.computedMillisOfMotorStopForDistance - tMillis) * ENCODER_TIMEOUT_FACTOR;
+    sEncoderDrive.IsActive = true;
+}
+
+/*
+ * @return LastMotorSpeed adjusted to the measured supply voltage
+ */
+uint8_t getCompensatedDriveSpeedPWM() {
+    if (sMotorSupplyMillivolt == 0) {
+        return LastMotorSpeed;
+    }
+    return DCMotor.getVoltageAdjustedSpeedPWM((uint8_t) LastMotorSpeed, sMotorSupplyMillivolt);
+}
+
+/*
+ * Called by the battery monitor with the filtered supply voltage.
+ * Adjusts the reference PWM for 2 volt, which is used for converting distance to time, and the drive speed PWM.
+ */
+void setMotorSupplyMillivolt(uint16_t aMillivolt) {
+    if (aMillivolt < FULL_BRIDGE_LOSS_MILLIVOLT + 1000) {
+        return; // Implausible, e.g. divider not connected
+    }
+    if (abs((int) aMillivolt - (int) sMotorSupplyMillivolt) < MOTOR_SUPPLY_HYSTERESIS_MILLIVOLT) {
+        return;
+    }
+    xSemaphoreTake(sMotorLock, portMAX_DELAY);
+    sMotorSupplyMillivolt = aMillivolt;
+    DCMotor.setDriveSpeedPWMFor2Volt(aMillivolt);
+    uint8_t tDriveSpeedPWM = getCompensatedDriveSpeedPWM();
+    DCMotor.setDriveSpeedPWM(tDriveSpeedPWM);
+#if !defined(DO_NOT_SUPPORT_RAMP)
+    // Change speed of running motor, but do not disturb ramps or the encoder speed control
+    if (DCMotor.MotorRampState == MOTOR_STATE_DRIVE && !sEncoderDrive.IsActive) {
+#else
+    if (!DCMotor.isStopped() && !sEncoderDrive.IsActive) {
+#endif
+        DCMotor.changeSpeedPWM(tDriveSpeedPWM);
+    }
+    setEncoderTargetSpeed();
+    xSemaphoreGive(sMotorLock);
+}
+
+/*
+ * Stall detection. The motor is stalled if it is powered, but neither the encoder counts nor the stream image changes
+ * for STALL_DETECTION_MILLIS. Without encoder, the stream task reports whether the image changed,
+ * which is decided by the motion estimator or by the size of the JPEG frames.
+ * If there is no encoder and no stream is running, a stall can not be detected.
+ */
+#define STALL_POLL_MILLIS           50
+#define STALL_DETECTION_MILLIS      250
+#define STALL_START_GRACE_MILLIS    400 // time for ramp up and the first frames after start
+#define STALL_FRAME_MAX_AGE_MILLIS  200 // older frames indicate that the stream is not running
+struct StallDetectionStruct {
+    bool IsStalled;                 // set at stall, reset by the next move command
+    bool IsReversing;
+    bool WasRunning;
+    unsigned long MillisOfLastMovement;
+    uint32_t LastEncoderCount;
+};
+StallDetectionStruct sStallDetection;
+uint16_t StallReverseMillis = STALL_REVERSE_DEFAULT_MILLIS;
+uint32_t NumberOfMotorStalls;
+// Written by the stream task
+volatile unsigned long sMillisOfLastStreamFrame;
+volatile unsigned long sMillisOfLastStreamFrameChange;
+
+/*
+ * Called by the stream task for each frame
+ */
+void noteStreamFrameForStallDetection(bool aImageHasChanged) {
+    unsigned long tMillis = millis();
+    if (aImageHasChanged) {
+        sMillisOfLastStreamFrameChange = tMillis;
+    }
+    sMillisOfLastStreamFrame = tMillis;
+}
+
+/*
+ * Must be called for each start and stop of the motor. checkForStall() sees a stop only if it is called while the motor is stopped,
+ * but the motor timer is not restarted after the motor has stopped. The next start then sets the start grace time.
+ */
+static void resetStallDetection() {
+    sStallDetection.WasRunning = false;
+    sStallDetection.IsReversing = false;
+}
+
+/*
+ * Cuts the power of a stalled motor and optionally reverses for StallReverseMillis.
+ * Must be called with sMotorLock taken and before DCMotor.updateMotor(), to suppress the open loop lateness statistics.
+ */
+void checkForStall(unsigned long aMillis) {
+    if (DCMotor.isStopped()) {
+        sStallDetection.WasRunning = false;
+        sStallDetection.IsReversing = false;
+        return;
+    }
+    if (!sStallDetection.WasRunning) {
+        // Motor was started
+        sStallDetection.WasRunning = true;
+        sStallDetection.MillisOfLastMovement = aMillis + STALL_START_GRACE_MILLIS;
+        sStallDetection.LastEncoderCount = EncoderCount;
+        return;
+    }
+    if (sStallDetection.IsReversing) {
+        return;
+    }
+    if (sEncoderIsSupported) {
+        if (EncoderCount != sStallDetection.LastEncoderCount) {
+            sStallDetection.LastEncoderCount = EncoderCount;
+            if ((long) (aMillis - sStallDetection.MillisOfLastMovement) > 0) {
+                sStallDetection.MillisOfLastMovement = aMillis;
+            }
+        }
+    } else if (aMillis - sMillisOfLastStreamFrame < STALL_FRAME_MAX_AGE_MILLIS) {
+        unsigned long tMillisOfLastStreamFrameChange = sMillisOfLastStreamFrameChange;
+        if ((long) (tMillisOfLastStreamFrameChange - sStallDetection.MillisOfLastMovement) > 0) {
+            sStallDetection.MillisOfLastMovement = tMillisOfLastStreamFrameChange;
+        }
+    } else {
+        return;
+    }
+    if ((long) (aMillis - sStallDetection.MillisOfLastMovement) <= STALL_DETECTION_MILLIS) {
+        return;
+    }
+
+    uint8_t tDirection = DCMotor.CurrentDirection;
+    DCMotor.stop(STOP_MODE_RELEASE);
+    sEncoderDrive.IsActive = false;
+    sStallDetection.IsStalled = true;
+    NumberOfMotorStalls++;
+    Serial.print("Motor stalled at ");
+    Serial.print(aMillis);
+    Serial.println(" ms");
+    if (StallReverseMillis > 0) {
+        DCMotor.setSpeedPWMAndDirection(DCMotor.DriveSpeedPWM, tDirection ^ DIRECTION_FORWARD_BACKWARD_MASK);
+        DCMotor.computedMillisOfMotorStopForDistance = aMillis + StallReverseMillis;
+        DCMotor.CheckStopConditionInUpdateMotor = true;
+        sStallDetection.IsReversing = true;
+    }
+}
+
+bool isMotorStalled() {
+    return sStallDetection.IsStalled;
+}
+
+/*
+ * Link loss failsafe. It is armed by the first heartbeat of a client.
+ * If then no heartbeat is received for HeartbeatTimeoutMillis, the heartbeat timer stops the motor
+ * and aborts a running motion queue, which would start the motor again.
+ */
+esp_timer_handle_t sHeartbeatTimer;
+uint16_t HeartbeatTimeoutMillis = HEARTBEAT_DEFAULT_TIMEOUT_MILLIS;
+FailsafeStatisticsStruct FailsafeStatistics;
+volatile bool sFailsafeIsSuspended = false;
+volatile bool sFailsafeExpiredWhileSuspended = false;
+
+/*
+ * Must be called with sMotorLock held
+ */
+static void stopMotorAndTimer() {
+    esp_timer_stop(sMotorTimer);
+    DCMotor.stop(STOP_MODE_KEEP);
+    sEncoderDrive.IsActive = false;
+    resetStallDetection(); // IsStalled is kept for the status
+}
+
+void heartbeatTimerCallback(void *aArgument) {
+    (void) aArgument;
+    bool tMotorWasRunning = !isMotorStopped();
+    if (sFailsafeIsSuspended && !tMotorWasRunning) {
+        // A suspension never covers a moving car, so check again until resumeFailsafe()
+        sFailsafeExpiredWhileSuspended = true;
+        esp_timer_start_once(sHeartbeatTimer, HEARTBEAT_RETRY_MILLIS * 1000);
+        return;
+    }
+    if (tMotorWasRunning) {
+        // Must not wait for the motor lock, this would block all other esp_timer callbacks
+        if (xSemaphoreTake(sMotorLock, 0) != pdTRUE) {
+            esp_timer_start_once(sHeartbeatTimer, HEARTBEAT_RETRY_MILLIS * 1000);
+            return;
+        }
+        stopMotorAndTimer();
+        xSemaphoreGive(sMotorLock);
+    }
+    // Must not wait for a running capture step either
+    bool tQueueWasRunning = requestMotionQueueAbort();
+    if (!tMotorWasRunning && !tQueueWasRunning) {
+        return;
+    }
+    FailsafeStatistics.NumberOfStops++;
+    FailsafeStatistics.LastStopMillis = millis();
+    FailsafeStatistics.LastStopTime = 0;
+    Serial.printf("Failsafe: no heartbeat for %u ms, motor stopped at %lu ms", HeartbeatTimeoutMillis,
+            FailsafeStatistics.LastStopMillis);
+    if (haveTime) {
+        FailsafeStatistics.LastStopTime = time(NULL);
+        struct tm tTimeInfo;
+        localtime_r(&FailsafeStatistics.LastStopTime, &tTimeInfo);
+        Serial.print(&tTimeInfo, ", %Y-%m-%d %H:%M:%S");
+    }
+    Serial.println();
+}
+
+/*
+ * Called for each heartbeat of the client. Restarts the failsafe timeout.
+ * @param aTimeoutMillis new timeout, 0 disables the failsafe, -1 keeps the current timeout
+ */
+void receiveHeartbeat(int aTimeoutMillis) {
+    unsigned long tMillis = millis();
+    if (FailsafeStatistics.LastHeartbeatMillis != 0
+            && FailsafeStatistics.MaxHeartbeatGapMillis < tMillis - FailsafeStatistics.LastHeartbeatMillis) {
+        FailsafeStatistics.MaxHeartbeatGapMillis = tMillis - FailsafeStatistics.LastHeartbeatMillis;
+    }
+    FailsafeStatistics.LastHeartbeatMillis = tMillis;
+    sFailsafeExpiredWhileSuspended = false;
+    if (aTimeoutMillis >= 0) {
+        HeartbeatTimeoutMillis = min(aTimeoutMillis, HEARTBEAT_MAX_TIMEOUT_MILLIS);
+    }
+    esp_timer_stop(sHeartbeatTimer); // returns error if timer is not running, which can be ignored
+    if (HeartbeatTimeoutMillis > 0) {
+        esp_timer_start_once(sHeartbeatTimer, (uint64_t) HeartbeatTimeoutMillis * 1000);
+    }
+}
+
+/*
+ * Called by http handlers around slow camera or SPIFFS work, e.g. a high resolution capture or a SPIFFS write,
+ * which can block the single task of the server on port 80 for longer than the timeout.
+ * The heartbeats of the client wait in the server queue meanwhile.
+ * Sending the response is not covered, it can block for the whole socket timeout.
+ * The suspension is ignored while the motor is running, a moving car is always stopped at the deadline.
+ */
+void suspendFailsafe() {
+    sFailsafeIsSuspended = true;
+}
+
+/*
+ * If the timeout expired during the suspension, restart it to give the waiting heartbeats a chance
+ */
+void resumeFailsafe() {
+    sFailsafeIsSuspended = false;
+    if (sFailsafeExpiredWhileSuspended) {
+        sFailsafeExpiredWhileSuspended = false;
+        esp_timer_stop(sHeartbeatTimer);
+        if (HeartbeatTimeoutMillis > 0) {
+            esp_timer_start_once(sHeartbeatTimer, (uint64_t) HeartbeatTimeoutMillis * 1000);
+        }
+    }
+}
+
+/*
+ * @return number of characters printed
+ */
+int printFailsafeStatistics(char *aBuffer) {
+    return sprintf(aBuffer, "\"failsafe_timeout_ms\":%u,\"failsafe_stops\":%lu,\"failsafe_last_stop_ms\":%lu,"
+            "\"failsafe_last_stop_time\":%lld,\"heartbeat_max_gap_ms\":%lu,", HeartbeatTimeoutMillis,
+            (unsigned long) FailsafeStatistics.NumberOfStops, FailsafeStatistics.LastStopMillis,
+            (long long) FailsafeStatistics.LastStopTime, FailsafeStatistics.MaxHeartbeatGapMillis);
+}
+
+/*
+ * Calls DCMotor.updateMotor() and arms the timer for the next ramp step or the computed stop time.
+ * Must be called with sMotorLock taken.
+ */
+void updateMotorAndArmTimer() {
+    unsigned long tMillisOfUpdate = millis();
+    if (sEncoderIsSupported) {
+        updateEncoderDrive(tMillisOfUpdate);
+    }
+    checkForStall(tMillisOfUpdate);
+    bool tWasCheckingStopCondition = DCMotor.CheckStopConditionInUpdateMotor;
+    unsigned long tMillisOfMotorStop = DCMotor.computedMillisOfMotorStopForDistance;
+
+    DCMotor.updateMotor();
+
+    int64_t tMicros = esp_timer_get_time();
+    unsigned long tMillis = tMicros / 1000; // same as millis()
+    if (tWasCheckingStopCondition && !DCMotor.CheckStopConditionInUpdateMotor) {
+        // Motor was stopped in this call
+        LastMotorStopLatenessMillis = tMillis - tMillisOfMotorStop;
+        if (MaxMotorStopLatenessMillis < LastMotorStopLatenessMillis) {
+            MaxMotorStopLatenessMillis = LastMotorStopLatenessMillis;
+        }
+    }
+
+    bool tUpdateRequired = false;
+    long tMillisUntilNextUpdate = LONG_MAX;
+#if !defined(DO_NOT_SUPPORT_RAMP)
+    if (DCMotor.MotorRampState == MOTOR_STATE_START || DCMotor.MotorRampState == MOTOR_STATE_RAMP_UP
+            || DCMotor.MotorRampState == MOTOR_STATE_RAMP_DOWN) {
+        tUpdateRequired = true;
+        tMillisUntilNextUpdate = (long) (DCMotor.NextRampChangeMillis - tMillis);
+    }
+#endif
+    if (DCMotor.CheckStopConditionInUpdateMotor) {
+        tUpdateRequired = true;
+        // updateMotor() stops the motor if millis() > computedMillisOfMotorStopForDistance
+        long tMillisUntilStop = (long) (DCMotor.computedMillisOfMotorStopForDistance + 1 - tMillis);
+        if (tMillisUntilNextUpdate > tMillisUntilStop) {
+            tMillisUntilNextUpdate = tMillisUntilStop;
+        }
+    }
+    if (sEncoderDrive.IsActive) {
+        tUpdateRequired = true;
+        if (tMillisUntilNextUpdate > ENCODER_POLL_MILLIS) {
+            tMillisUntilNextUpdate = ENCODER_POLL_MILLIS;
+        }
+    }
+    if (!DCMotor.isStopped()) {
+        tUpdateRequired = true;
+        if (tMillisUntilNextUpdate > STALL_POLL_MILLIS) {
+            tMillisUntilNextUpdate = STALL_POLL_MILLIS;
+        }
+    }
+    if (tUpdateRequired) {
+        // Fire at the start of the millisecond, in which the condition becomes true
+        int64_t tMicrosUntilNextUpdate = (int64_t) tMillisUntilNextUpdate * 1000 - (tMicros % 1000);
+        if (tMicrosUntilNextUpdate < 100) {
+            tMicrosUntilNextUpdate = 100;
+        }
+        esp_timer_start_once(sMotorTimer, tMicrosUntilNextUpdate);
+    }
+}
+
+void motorTimerCallback(void *aArgument) {
+    (void) aArgument;
+    // Must not wait for the lock, this would block all other esp_timer callbacks.
+    // If the lock holder restarts or stops the timer meanwhile, the retry is not required, but harmless.
+    if (xSemaphoreTake(sMotorLock, 0) != pdTRUE) {
+        esp_timer_start_once(sMotorTimer, MOTOR_TIMER_RETRY_MICROS);
+        return;
     }
+    updateMotorAndArmTimer();
+    xSemaphoreGive(sMotorLock);
+}
+
+/*
+ * To be called with sMotorLock taken, after the motor was started or its speed changed
+ */
+void restartMotorTimer() {
+    esp_timer_stop(sMotorTimer); // returns error if timer is not running, which can be ignored
+    updateMotorAndArmTimer();
 }
 
 void initServoAndMotorPinsAndChannels(bool aIsAccesspoint) {
+    // Created also without motor, since ServoAndMotorCommandInterpreter() uses them
+    sMotorLock = xSemaphoreCreateMutex();
+    esp_timer_create_args_t tMotorTimerArgs = { };
+    tMotorTimerArgs.callback = motorTimerCallback;
+    tMotorTimerArgs.name = "motor";
+    esp_timer_create(&tMotorTimerArgs, &sMotorTimer);
+    esp_timer_create_args_t tHeartbeatTimerArgs = { };
+    tHeartbeatTimerArgs.callback = heartbeatTimerCallback;
+    tHeartbeatTimerArgs.name = "heartbeat";
+    esp_timer_create(&tHeartbeatTimerArgs, &sHeartbeatTimer);
+    sGimbalLock = xSemaphoreCreateMutex();
+    esp_timer_create_args_t tGimbalTimerArgs = { };
+    tGimbalTimerArgs.callback = gimbalTimerCallback;
+    tGimbalTimerArgs.name = "gimbal";
+    esp_timer_create(&tGimbalTimerArgs, &sGimbalTimer);
+
+    if (sTiltServoIsSupported) {
+        TiltServo.setChannel(LEDC_TILT_SERVO_CHANNEL);
+        TiltServo.attach(TILT_SERVO_PIN);
+        sGimbalAxes[GIMBAL_AXIS_TILT].IsAttached = true;
+        writeGimbalAxisDegree(&sGimbalAxes[GIMBAL_AXIS_TILT], TILT_HORIZONTAL_DEGREE);
+    }
+
     if (sPanServoIsSupported) {
         /*
          * Servo
          */
+        PanServo.setChannel(LEDC_PAN_SERVO_CHANNEL);
         PanServo.attach(PAN_SERVO_PIN);
-        PanServo.write(90);
+        sGimbalAxes[GIMBAL_AXIS_PAN].IsAttached = true;
+        writeGimbalAxisDegree(&sGimbalAxes[GIMBAL_AXIS_PAN], 90);
 
-        // Feedback
-        delay(400);
-        doAttention();
-        delay(1000);
+        // Feedback, done by the gimbal timer
+        startAttention();
     }
 
     if (sOnePWMMotorIsSupported) {
@@ -140,69 +790,250 @@ void initServoAndMotorPinsAndChannels(bool aIsAccesspoint) {
          * Motor
          */
         DCMotor.init(DC_MOTOR_FORWARD_PIN, DC_MOTOR_BACKWARD_PIN, DC_MOTOR_SPEED_PIN);
+        if (sEncoderIsSupported) {
+            Serial.print("Init encoder on pin ");
+            Serial.println(ENCODER_PIN);
+            initEncoder();
+        }
         LastMotorSpeed = DCMotor.DriveSpeedPWM;
         Serial.print("Init motor PWM. Speed: ");
         Serial.println(DCMotor.DriveSpeedPWM);
         // Feedback - go forward for (standalone) access point mode and backward for (known) network mode
 //        PWMDcMotor::printSettings(&Serial);
+        xSemaphoreTake(sMotorLock, portMAX_DELAY);
         if (aIsAccesspoint) {
-            DCMotor.goDistanceMillimeter(20, DIRECTION_BACKWARD);
+            DCMotor.startGoDistanceMillimeter(20, DIRECTION_BACKWARD);
         } else {
-            DCMotor.goDistanceMillimeter(20, DIRECTION_FORWARD);
+            DCMotor.startGoDistanceMillimeter(20, DIRECTION_FORWARD);
         }
+        if (sEncoderIsSupported) {
+            startEncoderDrive(20);
+        }
+        restartMotorTimer();
+        xSemaphoreGive(sMotorLock);
     }
 }
 
-void updateMotor() {
-    DCMotor.updateMotor();
-    LastMotorSpeed = DCMotor.DriveSpeedPWM;
-}
-
-void checkForAttention() {
-    if (millis() - sMillisOfLastAction > MILLIS_OF_INACTIVITY_BEFORE_REMINDER_MOVE) {
-        sMillisOfLastAction += MILLIS_OF_INACTIVITY_BETWEEN_REMINDER_MOVE;
-        doAttention();
-        // next attention in 1 minute
+/*
+ * @return milliseconds until the next call is required
+ */
+uint32_t checkForAttention() {
+    unsigned long tMillisSinceLastAction = millis() - sMillisOfLastAction;
+    if (tMillisSinceLastAction <= MILLIS_OF_INACTIVITY_BEFORE_REMINDER_MOVE) {
+        return min((unsigned long) LOOP_SCHEDULER_MAX_SLEEP_MILLIS,
+                (MILLIS_OF_INACTIVITY_BEFORE_REMINDER_MOVE + 1) - tMillisSinceLastAction);
     }
+    // next attention in 2 minutes
+    sMillisOfLastAction += MILLIS_OF_INACTIVITY_BETWEEN_REMINDER_MOVE;
+    startAttention();
+    return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
 }
 
+/*
+ * Starts an eased move to aNewDegree and discards all queued moves
+ */
 void setServoPan(int aNewDegree) {
     if (aNewDegree != -1) {
         // From the GUI we get 0 for left and 180 for right, which is the inverse of the servo definition :-(
         aNewDegree = constrain((180 - aNewDegree), 0, 180);
         ServoPanDegree = aNewDegree;
-        PanServo.write(aNewDegree); // the
-//        ledcServoWrite(PAN_SERVO_CHANNEL, aNewDegree); // channel, value
+        xSemaphoreTake(sGimbalLock, portMAX_DELAY);
+        sGimbalTargetQueueLength = 0;
+        startGimbalMove(aNewDegree, GIMBAL_KEEP_DEGREE);
+        xSemaphoreGive(sGimbalLock);
         Serial.print("Servo pan: ");
         Serial.print(aNewDegree);
         Serial.println(" degree");
     }
 }
 
-bool ServoAndMotorCommandInterpreter(char *aCommandString, int aCommandValue) {
+/*
+ * Starts an eased move to aNewDegree and discards all queued moves
+ * @param aNewDegree 0 is down, 90 is horizontal and 180 is up
+ */
+void setServoTilt(int aNewDegree) {
+    if (aNewDegree != -1) {
+        aNewDegree = constrain(aNewDegree, 0, 180);
+        ServoTiltDegree = aNewDegree;
+        xSemaphoreTake(sGimbalLock, portMAX_DELAY);
+        sGimbalTargetQueueLength = 0;
+        startGimbalMove(GIMBAL_KEEP_DEGREE, aNewDegree);
+        xSemaphoreGive(sGimbalLock);
+        Serial.print("Servo tilt: ");
+        Serial.print(aNewDegree);
+        Serial.println(" degree");
+    }
+}
+
+/*
+ * Coordinated move of both axes, which arrive at the same time. Discards all queued moves.
+ * @param aPanDegree 0 is left and 180 is right, -1 keeps the pan position
+ * @param aTiltDegree 0 is down and 180 is up, -1 keeps the tilt position
+ */
+void setGimbal(int aPanDegree, int aTiltDegree) {
+    int tPanServoDegree = GIMBAL_KEEP_DEGREE;
+    if (aPanDegree != -1) {
+        tPanServoDegree = constrain((180 - aPanDegree), 0, 180);
+        ServoPanDegree = tPanServoDegree;
+    }
+    if (aTiltDegree != -1) {
+        aTiltDegree = constrain(aTiltDegree, 0, 180);
+        ServoTiltDegree = aTiltDegree;
+    }
+    xSemaphoreTake(sGimbalLock, portMAX_DELAY);
+    sGimbalTargetQueueLength = 0;
+    startGimbalMove(tPanServoDegree, aTiltDegree);
+    xSemaphoreGive(sGimbalLock);
+    Serial.printf("Gimbal look pan=%d tilt=%d\r\n", aPanDegree, aTiltDegree);
+}
+
+/*
+ * Parses "<pan>,<tilt>" or the name of a preset like "crown" and starts the coordinated move
+ * @return false if aValue is neither a preset nor a pair of numbers
+ */
+bool startGimbalLook(const char *aValue) {
+    for (uint_fast8_t i = 0; i < sizeof(GimbalPresets) / sizeof(GimbalPresets[0]); ++i) {
+        if (!strcmp(aValue, GimbalPresets[i].Name)) {
+            setGimbal(GimbalPresets[i].PanDegree, GimbalPresets[i].TiltDegree);
+            return true;
+        }
+    }
+    int tPanDegree;
+    int tTiltDegree;
+    if (sscanf(aValue, "%d,%d", &tPanDegree, &tTiltDegree) != 2) {
+        return false;
+    }
+    setGimbal(tPanDegree, tTiltDegree);
+    return true;
+}
+
+/*
+ * Negative values go backward. Non blocking, the motor is stopped by its timer.
+ */
+void startMotorDistanceCentimeter(int aCentimeter) {
+    xSemaphoreTake(sMotorLock, portMAX_DELAY);
+    sStallDetection.IsStalled = false;
+    resetStallDetection();
+    DCMotor.startGoDistanceMillimeterWithSpeed(DCMotor.DriveSpeedPWM, aCentimeter * 10); // *10 since aCentimeter is cm
+    uint16_t tMillimeterPerSecond = getCalibratedMillimeterPerSecond(LastMotorSpeed);
+    if (tMillimeterPerSecond > 0 && !DCMotor.isStopped()) {
+        // Use the measured curve instead of the linear scale
+        DCMotor.computedMillisOfMotorStopForDistance = millis() + ((uint32_t) abs(aCentimeter) * 10000) / tMillimeterPerSecond;
+    }
+    if (sEncoderIsSupported) {
+        startEncoderDrive(abs(aCentimeter) * 10);
+    }
+    restartMotorTimer();
+    xSemaphoreGive(sMotorLock);
+    Serial.print("Start go distance millimeter: ");
+    Serial.println(aCentimeter * 10);
+}
+
+/*
+ * Drives forward for aMillis with the voltage compensated aSpeedPWM. Used for calibration.
+ */
+void startMotorForMillis(uint8_t aSpeedPWM, uint16_t aMillis) {
+    xSemaphoreTake(sMotorLock, portMAX_DELAY);
+    sEncoderDrive.IsActive = false;
+    sStallDetection.IsStalled = false;
+    resetStallDetection();
+    if (sMotorSupplyMillivolt != 0) {
+        aSpeedPWM = DCMotor.getVoltageAdjustedSpeedPWM(aSpeedPWM, sMotorSupplyMillivolt);
+    }
+    DCMotor.setSpeedPWMAndDirectionWithRamp(aSpeedPWM, DIRECTION_FORWARD);
+    DCMotor.computedMillisOfMotorStopForDistance = millis() + aMillis;
+    DCMotor.CheckStopConditionInUpdateMotor = true;
+    restartMotorTimer();
+    xSemaphoreGive(sMotorLock);
+}
+
+/*
+ * Sets MillisPerCentimeter to the calibrated speed at 2 volt, which is used by the PWMDcMotor conversion functions
+ */
+void setMillisPerCentimeterFromCalibration() {
+    uint16_t tMillimeterPerSecond = getCalibratedMillimeterPerSecond((2000 * MAX_SPEED_PWM) / FULL_BRIDGE_OUTPUT_MILLIVOLT);
+    if (tMillimeterPerSecond == 0) {
+        return;
+    }
+    xSemaphoreTake(sMotorLock, portMAX_DELAY);
+    DCMotor.MillisPerCentimeter = constrain(10000 / tMillimeterPerSecond, 1, UINT8_MAX);
+    setEncoderTargetSpeed();
+    xSemaphoreGive(sMotorLock);
+    Serial.print("MillisPerCentimeter=");
+    Serial.println(DCMotor.MillisPerCentimeter);
+}
+
+void stopMotor() {
+    xSemaphoreTake(sMotorLock, portMAX_DELAY);
+    stopMotorAndTimer();
+    xSemaphoreGive(sMotorLock);
+}
+
+bool isMotorStopped() {
+    return DCMotor.isStopped();
+}
+
+/*
+ * Expected speed of the running motor, from the calibration curve if available, else from MillisPerCentimeter.
+ * @return negative value for backward, 0 if stopped
+ */
+int16_t getMotorMillimeterPerSecond() {
+    xSemaphoreTake(sMotorLock, portMAX_DELAY);
+    int16_t tMillimeterPerSecond = 0;
+    if (!DCMotor.isStopped()) {
+        tMillimeterPerSecond = getCalibratedMillimeterPerSecond(LastMotorSpeed);
+        if (tMillimeterPerSecond == 0) {
+            tMillimeterPerSecond = 10000 / DCMotor.MillisPerCentimeter;
+        }
+        if (DCMotor.CurrentDirection == DIRECTION_BACKWARD) {
+            tMillimeterPerSecond = -tMillimeterPerSecond;
+        }
+    }
+    xSemaphoreGive(sMotorLock);
+    return tMillimeterPerSecond;
+}
+
+/*
+ * @return measured distance since boot, backward distances are subtracted. 0 if encoder is not supported.
+ */
+int32_t getOdometerMillimeter() {
+    if (!sEncoderIsSupported) {
+        return 0;
+    }
+    xSemaphoreTake(sMotorLock, portMAX_DELAY);
+    updateEncoder(DCMotor.CurrentDirection == DIRECTION_BACKWARD);
+    int32_t tOdometerMillimeter = getEncoderOdometerMillimeter();
+    xSemaphoreGive(sMotorLock);
+    return tOdometerMillimeter;
+}
+
+bool ServoAndMotorCommandInterpreter(const char *aCommandString, int aCommandValue) {
     if (!strcmp(aCommandString, "pan")) {
         setServoPan(aCommandValue);
+    } else if (!strcmp(aCommandString, "tilt")) {
+        setServoTilt(aCommandValue);
+    } else if (!strcmp(aCommandString, "pan-speed")) {
+        ServoPanSpeed = constrain(aCommandValue, 0, 1000);
+        Serial.print("Pan speed: ");
+        Serial.print(ServoPanSpeed);
+        Serial.println(" degree per second");
+    } else if (!strcmp(aCommandString, "pan-easing")) {
+        ServoPanEasing = constrain(aCommandValue, PAN_EASE_LINEAR, PAN_EASE_CUBIC);
     } else if (!strcmp(aCommandString, "motor-speed")) {
-        DCMotor.updateDriveSpeedPWM(aCommandValue);
+        xSemaphoreTake(sMotorLock, portMAX_DELAY);
+        LastMotorSpeed = aCommandValue;
+        DCMotor.updateDriveSpeedPWM(getCompensatedDriveSpeedPWM());
+        setEncoderTargetSpeed();
+        restartMotorTimer(); // speed change may start a ramp
+        xSemaphoreGive(sMotorLock);
         Serial.print("Speed: ");
         Serial.println(DCMotor.DriveSpeedPWM);
+    } else if (!strcmp(aCommandString, "stall-reverse")) {
+        StallReverseMillis = constrain(aCommandValue, 0, 2000);
     } else if (!strcmp(aCommandString, "move-car")) {
-        DCMotor.startGoDistanceMillimeterWithSpeed(DCMotor.DriveSpeedPWM, aCommandValue * 10); // *10 since aCommandValue is cm
-        Serial.print("Start go distance millimeter: ");
-        Serial.println(aCommandValue * 10);
+        startMotorDistanceCentimeter(aCommandValue);
     } else {
         return false;
     }
     return true;
 }
-
-//void setServoTilt(int aNewDegree) {
-//    if (aNewDegree != -1) {
-//        aNewDegree = constrain(aNewDegree, 0, 180);
-//        ServoTiltDegree = aNewDegree;
-//        ledcServoWrite(TILT_SERVO_CHANNEL, aNewDegree);
-//        Serial.print("Servo tilt: ");
-//        Serial.print(aNewDegree);
-//        Serial.println(" degree");
-//    }
-//}
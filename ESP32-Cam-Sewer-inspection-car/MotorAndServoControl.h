@@ -24,14 +24,69 @@
 #ifndef _MOTOR_AND_SERVO_CONTROL_H
 #define _MOTOR_AND_SERVO_CONTROL_H
 
+#include <stddef.h>
+#include <time.h>
 #include "PWMDcMotor.h"
 extern PWMDcMotor DCMotor;
 extern unsigned long sMillisOfLastAction;
 
-void updateMotor();
-void checkForAttention();
+extern unsigned long LastMotorStopLatenessMillis;
+extern unsigned long MaxMotorStopLatenessMillis;
+extern uint16_t EncoderCountsPerSecond;
+
+#define HEARTBEAT_DEFAULT_TIMEOUT_MILLIS    1000 // the GUI sends a heartbeat every 300 ms
+#define HEARTBEAT_MAX_TIMEOUT_MILLIS        10000
+#define HEARTBEAT_RETRY_MILLIS              20 // recheck interval if the motor lock is busy or the failsafe is suspended
+struct FailsafeStatisticsStruct {
+    uint32_t NumberOfStops;
+    unsigned long LastStopMillis;
+    time_t LastStopTime;            // 0 if time is not available
+    unsigned long LastHeartbeatMillis;
+    unsigned long MaxHeartbeatGapMillis;
+};
+extern uint16_t HeartbeatTimeoutMillis;
+
+#define STALL_REVERSE_DEFAULT_MILLIS        300 // reverse after a stall to free the car. 0 = no reverse
+extern uint16_t StallReverseMillis;
+extern uint32_t NumberOfMotorStalls;
+extern FailsafeStatisticsStruct FailsafeStatistics;
+
+/*
+ * Tilt in GUI degree, 0 is down and 180 is up
+ */
+#define TILT_HORIZONTAL_DEGREE  90
+#define TILT_CROWN_DEGREE       170 // look at the top of the pipe
+#define TILT_INVERT_DEGREE      10  // look at the bottom of the pipe
+
+#define PAN_EASE_LINEAR     0
+#define PAN_EASE_QUADRATIC  1
+#define PAN_EASE_CUBIC      2
+extern int ServoPanSpeed;
+extern uint8_t ServoPanEasing;
+
+uint32_t checkForAttention();
+void startAttention();
 void setServoPan(int aNewDegree);
+void setServoTilt(int aNewDegree);
+void setGimbal(int aPanDegree, int aTiltDegree);
+bool startGimbalLook(const char *aValue);
+void queueServoPan(int aNewDegree);
+bool isGimbalMoving();
+void startMotorDistanceCentimeter(int aCentimeter);
+void startMotorForMillis(uint8_t aSpeedPWM, uint16_t aMillis);
+void setMillisPerCentimeterFromCalibration();
+void stopMotor();
+void receiveHeartbeat(int aTimeoutMillis);
+void suspendFailsafe();
+void resumeFailsafe();
+int printFailsafeStatistics(char *aBuffer);
+bool isMotorStopped();
+bool isMotorStalled();
+void noteStreamFrameForStallDetection(bool aImageHasChanged);
+int32_t getOdometerMillimeter();
+int16_t getMotorMillimeterPerSecond();
+void setMotorSupplyMillivolt(uint16_t aMillivolt);
 void initServoAndMotorPinsAndChannels(bool aIsAccesspoint);
-bool ServoAndMotorCommandInterpreter(char *aCommandString, int aCommandValue);
+bool ServoAndMotorCommandInterpreter(const char *aCommandString, int aCommandValue);
 
 #endif //#ifndef _MOTOR_AND_SERVO_CONTROL_H
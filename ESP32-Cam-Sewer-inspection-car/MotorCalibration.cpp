@@ -0,0 +1,261 @@
+/*
+ * MotorCalibration.cpp
+ *
+ *  Calibration of the motor speed. The car drives forward for a fixed time at a given PWM.
+ *  The distance is measured by the encoder if available, otherwise it is entered by the operator.
+ *  After each run a line is fitted through all points. Distance commands then use this line instead of MillisPerCentimeter.
+ *  The points are stored on SPIFFS and are exported as JSON by /calibrate.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+
+#include <Arduino.h>
+
+#include "MotorCalibration.h"
+#include "JsonScanner.h"
+#include "LoopScheduler.h"
+#include "esp32-cam-webserver.h"
+#include "MotorAndServoControl.h"
+#include "EncoderOdometry.h"
+
+MotorCalibrationStruct MotorCalibration;
+
+struct MotorCalibrationRunStruct {
+    uint8_t State;                  // MOTOR_CALIBRATION_IDLE, MOTOR_CALIBRATION_RUNNING or MOTOR_CALIBRATION_WAIT_FOR_DISTANCE
+    uint8_t SpeedPWM;
+    uint16_t Millis;
+    uint32_t StartEncoderCount;
+    unsigned long StopMillis;       // 0 until stop was detected
+};
+MotorCalibrationRunStruct sMotorCalibrationRun;
+
+static void fitMotorCalibration() {
+    MotorCalibration.IsValid = false;
+    uint_fast8_t n = MotorCalibration.NumberOfPoints;
+    if (n == 0) {
+        return;
+    }
+    if (n == 1) {
+        // Line through origin
+        MotorCalibration.Slope = (float) MotorCalibration.Points[0].MillimeterPerSecond / MotorCalibration.Points[0].SpeedPWM;
+        MotorCalibration.Intercept = 0;
+    } else {
+        float tSumX = 0, tSumY = 0, tSumXX = 0, tSumXY = 0;
+        for (uint_fast8_t i = 0; i < n; ++i) {
+            float x = MotorCalibration.Points[i].SpeedPWM;
+            float y = MotorCalibration.Points[i].MillimeterPerSecond;
+            tSumX += x;
+            tSumY += y;
+            tSumXX += x * x;
+            tSumXY += x * y;
+        }
+        float tDenominator = n * tSumXX - tSumX * tSumX;
+        if (tDenominator == 0) {
+            return; // all points have the same PWM
+        }
+        MotorCalibration.Slope = (n * tSumXY - tSumX * tSumY) / tDenominator;
+        MotorCalibration.Intercept = (tSumY - MotorCalibration.Slope * tSumX) / n;
+    }
+    MotorCalibration.IsValid = MotorCalibration.Slope > 0;
+    Serial.printf("Motor calibration: mm/s = %.3f * PWM %+.1f\r\n", MotorCalibration.Slope, MotorCalibration.Intercept);
+    setMillisPerCentimeterFromCalibration();
+}
+
+/*
+ * Replaces a point with the same PWM
+ */
+static bool addMotorCalibrationPoint(uint8_t aSpeedPWM, uint16_t aMillimeterPerSecond) {
+    uint_fast8_t i;
+    for (i = 0; i < MotorCalibration.NumberOfPoints; ++i) {
+        if (MotorCalibration.Points[i].SpeedPWM == aSpeedPWM) {
+            break;
+        }
+    }
+    if (i >= MOTOR_CALIBRATION_MAX_POINTS) {
+        Serial.println("Motor calibration: too many points");
+        return false;
+    }
+    if (i == MotorCalibration.NumberOfPoints) {
+        MotorCalibration.NumberOfPoints++;
+    }
+    MotorCalibration.Points[i].SpeedPWM = aSpeedPWM;
+    MotorCalibration.Points[i].MillimeterPerSecond = aMillimeterPerSecond;
+    Serial.printf("Motor calibration point: PWM=%u %u mm/s\r\n", aSpeedPWM, aMillimeterPerSecond);
+    fitMotorCalibration();
+    return true;
+}
+
+void clearMotorCalibration() {
+    MotorCalibration.NumberOfPoints = 0;
+    MotorCalibration.IsValid = false;
+}
+
+/*
+ * @return 0 if not calibrated or aSpeedPWM is below the start PWM of the fitted line
+ */
+uint16_t getCalibratedMillimeterPerSecond(uint8_t aSpeedPWM) {
+    if (!MotorCalibration.IsValid) {
+        return 0;
+    }
+    float tMillimeterPerSecond = MotorCalibration.Slope * aSpeedPWM + MotorCalibration.Intercept;
+    if (tMillimeterPerSecond < 1) {
+        return 0;
+    }
+    return tMillimeterPerSecond + 0.5;
+}
+
+/*
+ * Drives forward for aMillis. Must be followed by setMotorCalibrationDistance() if there is no encoder.
+ * @return false if a run is active, the motor is running or parameters are invalid
+ */
+bool startMotorCalibrationRun(uint8_t aSpeedPWM, uint16_t aMillis) {
+    if (sMotorCalibrationRun.State == MOTOR_CALIBRATION_RUNNING || !isMotorStopped() || aSpeedPWM == 0
+            || aMillis > MOTOR_CALIBRATION_MAX_MILLIS) {
+        return false;
+    }
+    sMotorCalibrationRun.SpeedPWM = aSpeedPWM;
+    sMotorCalibrationRun.Millis = aMillis;
+    sMotorCalibrationRun.StopMillis = 0;
+    if (sEncoderIsSupported) {
+        getOdometerMillimeter(); // updates EncoderCount
+        sMotorCalibrationRun.StartEncoderCount = EncoderCount;
+    }
+    sMotorCalibrationRun.State = MOTOR_CALIBRATION_RUNNING;
+    Serial.printf("Motor calibration run: PWM=%u for %u ms\r\n", aSpeedPWM, aMillis);
+    startMotorForMillis(aSpeedPWM, aMillis);
+    wakeLoopScheduler();
+    return true;
+}
+
+/*
+ * Distance driven in the last run, entered by the operator
+ */
+bool setMotorCalibrationDistance(uint16_t aMillimeter) {
+    if (sMotorCalibrationRun.State != MOTOR_CALIBRATION_WAIT_FOR_DISTANCE || aMillimeter == 0) {
+        return false;
+    }
+    sMotorCalibrationRun.State = MOTOR_CALIBRATION_IDLE;
+    return addMotorCalibrationPoint(sMotorCalibrationRun.SpeedPWM,
+            ((uint32_t) aMillimeter * 1000) / sMotorCalibrationRun.Millis);
+}
+
+/*
+ * Detects the end of a run and reads the encoder after the car stands still
+ */
+uint32_t motorCalibrationLoopTask() {
+    if (sMotorCalibrationRun.State != MOTOR_CALIBRATION_RUNNING) {
+        return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+    }
+    if (!isMotorStopped()) {
+        return 50;
+    }
+    if (sMotorCalibrationRun.StopMillis == 0) {
+        sMotorCalibrationRun.StopMillis = millis();
+        return MOTOR_CALIBRATION_COAST_MILLIS;
+    }
+    if (millis() - sMotorCalibrationRun.StopMillis < MOTOR_CALIBRATION_COAST_MILLIS) {
+        return 50;
+    }
+    if (sEncoderIsSupported) {
+        getOdometerMillimeter(); // updates EncoderCount
+        uint32_t tMillimeter = convertEncoderCountToMillimeter(EncoderCount - sMotorCalibrationRun.StartEncoderCount);
+        sMotorCalibrationRun.State = MOTOR_CALIBRATION_IDLE;
+        addMotorCalibrationPoint(sMotorCalibrationRun.SpeedPWM, (tMillimeter * 1000) / sMotorCalibrationRun.Millis);
+    } else {
+        sMotorCalibrationRun.State = MOTOR_CALIBRATION_WAIT_FOR_DISTANCE;
+        Serial.println("Motor calibration: enter driven distance by /calibrate?distance=<mm>");
+    }
+    return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+}
+
+/*
+ * Called by the JSON scanner for the keys "pwm<n>" and "mmps<n>" of the calibration file
+ */
+static void addMotorCalibrationEntry(const char *aKey, const char *aValue, void *aContext) {
+    (void) aContext;
+    int tIndex;
+    if (!strncmp(aKey, "pwm", 3)) {
+        tIndex = atoi(aKey + 3);
+        if (tIndex >= 0 && tIndex < MOTOR_CALIBRATION_MAX_POINTS) {
+            MotorCalibration.Points[tIndex].SpeedPWM = atoi(aValue);
+        }
+    } else if (!strncmp(aKey, "mmps", 4)) {
+        tIndex = atoi(aKey + 4);
+        if (tIndex >= 0 && tIndex < MOTOR_CALIBRATION_MAX_POINTS) {
+            MotorCalibration.Points[tIndex].MillimeterPerSecond = atoi(aValue);
+        }
+    } else if (!strcmp(aKey, "points")) {
+        MotorCalibration.NumberOfPoints = constrain(atoi(aValue), 0, MOTOR_CALIBRATION_MAX_POINTS);
+    }
+}
+
+/*
+ * Must be called after motor init, since it changes DCMotor.MillisPerCentimeter
+ */
+void loadMotorCalibration(fs::FS &fs) {
+    static char sCalibrationBuffer[512];
+    clearMotorCalibration();
+    File file = fs.open(MOTOR_CALIBRATION_FILENAME, FILE_READ);
+    if (!file) {
+        return;
+    }
+    size_t tSize = file.size();
+    if (tSize < sizeof(sCalibrationBuffer) && file.read((uint8_t*) sCalibrationBuffer, tSize) == tSize) {
+        sCalibrationBuffer[tSize] = '\0';
+        if (scanFlatJsonObject(sCalibrationBuffer, tSize, addMotorCalibrationEntry, NULL) == JSON_SCANNER_ERROR) {
+            Serial.println(MOTOR_CALIBRATION_FILENAME " is not valid JSON, ignored");
+            clearMotorCalibration();
+        } else {
+            fitMotorCalibration();
+        }
+    }
+    file.close();
+}
+
+bool saveMotorCalibration(fs::FS &fs) {
+    static char sCalibrationBuffer[512];
+    printMotorCalibration(sCalibrationBuffer);
+    File file = fs.open(MOTOR_CALIBRATION_FILENAME, FILE_WRITE);
+    if (!file) {
+        Serial.println("Failed to create " MOTOR_CALIBRATION_FILENAME);
+        return false;
+    }
+    file.print(sCalibrationBuffer);
+    file.close();
+    return true;
+}
+
+/*
+ * Prints points and fit as flat JSON object. This is also the format of the calibration file.
+ * @return number of characters printed
+ */
+int printMotorCalibration(char *aBuffer) {
+    const char *const tStateNames[] = { "idle", "running", "wait_for_distance" };
+    char *p = aBuffer;
+    p += sprintf(p, "{\"state\":\"%s\",\"points\":%u,", tStateNames[sMotorCalibrationRun.State],
+            MotorCalibration.NumberOfPoints);
+    for (uint_fast8_t i = 0; i < MotorCalibration.NumberOfPoints; ++i) {
+        p += sprintf(p, "\"pwm%u\":%u,\"mmps%u\":%u,", i, MotorCalibration.Points[i].SpeedPWM, i,
+                MotorCalibration.Points[i].MillimeterPerSecond);
+    }
+    p += sprintf(p, "\"valid\":%d,\"slope\":%.4f,\"intercept\":%.2f}", MotorCalibration.IsValid, MotorCalibration.Slope,
+            MotorCalibration.Intercept);
+    return p - aBuffer;
+}
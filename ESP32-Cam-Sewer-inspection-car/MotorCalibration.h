@@ -0,0 +1,68 @@
+/*
+ * MotorCalibration.h
+ *
+ *  Measured speed versus PWM curve of the motor, used instead of the linear MillisPerCentimeter scale.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _MOTOR_CALIBRATION_H
+#define _MOTOR_CALIBRATION_H
+
+#include <stdint.h>
+#include "FS.h"
+
+#define MOTOR_CALIBRATION_FILENAME          "/motor-calibration.json"
+#define MOTOR_CALIBRATION_MAX_POINTS        6
+#define MOTOR_CALIBRATION_DEFAULT_MILLIS    2000
+#define MOTOR_CALIBRATION_MAX_MILLIS        10000
+#define MOTOR_CALIBRATION_COAST_MILLIS      300 // wait after stop until car stands still, before encoder is read
+
+#define MOTOR_CALIBRATION_IDLE              0
+#define MOTOR_CALIBRATION_RUNNING           1
+#define MOTOR_CALIBRATION_WAIT_FOR_DISTANCE 2 // without encoder, the operator must enter the measured distance
+
+struct MotorCalibrationPointStruct {
+    uint8_t SpeedPWM;               // for FULL_BRIDGE_INPUT_MILLIVOLT, i.e. value of motor-speed command
+    uint16_t MillimeterPerSecond;
+};
+
+/*
+ * Least squares fit of MillimeterPerSecond = Slope * SpeedPWM + Intercept.
+ * The intercept is negative, since the motor does not start below a minimum PWM.
+ */
+struct MotorCalibrationStruct {
+    uint8_t NumberOfPoints;
+    MotorCalibrationPointStruct Points[MOTOR_CALIBRATION_MAX_POINTS];
+    float Slope;
+    float Intercept;
+    bool IsValid;                   // at least one point and positive slope
+};
+extern MotorCalibrationStruct MotorCalibration;
+
+void loadMotorCalibration(fs::FS &fs);
+bool saveMotorCalibration(fs::FS &fs);
+void clearMotorCalibration();
+bool startMotorCalibrationRun(uint8_t aSpeedPWM, uint16_t aMillis);
+bool setMotorCalibrationDistance(uint16_t aMillimeter);
+uint16_t getCalibratedMillimeterPerSecond(uint8_t aSpeedPWM);
+uint32_t motorCalibrationLoopTask();
+int printMotorCalibration(char *aBuffer);
+
+#endif // _MOTOR_CALIBRATION_H
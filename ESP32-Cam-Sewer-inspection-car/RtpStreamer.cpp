@@ -0,0 +1,315 @@
+/*
+ * RtpStreamer.cpp
+ *
+ *  Alternative to the MJPEG over HTTP stream, which freezes at each lost TCP segment until it is retransmitted.
+ *  Each frame is split into UDP packets. A lost packet only drops its frame at the receiver, the next frame is shown
+ *  without waiting. The JPEG header is removed, width, height and sampling are sent in the RTP/JPEG header,
+ *  the quantization tables in the first packet of each frame (Q = 255). Huffman tables are the standard ones,
+ *  which the sensor uses as well.
+ *  The stream is sent by its own task to one destination, which is set by /rtp. The SDP file is available at /stream.sdp.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "esp_camera.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+
+#include "RtpStreamer.h"
+#include "StillSequencer.h"
+
+RtpStatisticsStruct RtpStatistics;
+
+static volatile bool sRtpIsRunning = false;
+static volatile bool sRtpTaskIsAlive = false; // the task still runs for one frame after stopRtpStream()
+static int sRtpSocket = -1;
+static struct sockaddr_in sRtpDestination;  // written by the http server task, copied by the RTP task for each frame
+static SemaphoreHandle_t sRtpDestinationLock = NULL;
+static uint16_t sRtpSequenceNumber;
+static uint32_t sRtpSSRC;
+
+/*
+ * The parts of a JPEG, which are required for RFC 2435
+ */
+struct JpegInfoStruct {
+    uint8_t Type;                   // 0 for 4:2:2, 1 for 4:2:0, +64 if restart markers are used
+    uint16_t Width;
+    uint16_t Height;
+    uint16_t RestartInterval;
+    const uint8_t *QuantizationTables[2]; // 64 bytes each, in zigzag order, luminance first
+    const uint8_t *ScanData;
+    size_t ScanLength;
+};
+
+/*
+ * @return false if the JPEG is not baseline with 8 bit tables and 2 components of 8 x 8 luminance and 16 x 8 or 16 x 16 chrominance
+ */
+static bool parseJpeg(const uint8_t *aJpeg, size_t aLength, JpegInfoStruct *aInfo) {
+    memset(aInfo, 0, sizeof(JpegInfoStruct));
+    if (aLength < 4 || aJpeg[0] != 0xFF || aJpeg[1] != 0xD8) {
+        return false;
+    }
+    size_t tIndex = 2;
+    while (tIndex + 4 <= aLength) {
+        if (aJpeg[tIndex] != 0xFF) {
+            return false;
+        }
+        uint8_t tMarker = aJpeg[tIndex + 1];
+        uint16_t tSegmentLength = (aJpeg[tIndex + 2] << 8) | aJpeg[tIndex + 3];
+        const uint8_t *tSegment = &aJpeg[tIndex + 4];
+        if (tIndex + 2 + tSegmentLength > aLength) {
+            return false;
+        }
+        if (tMarker == 0xDB) {
+            // DQT, may contain several tables
+            for (int i = 0; i + 65 <= tSegmentLength - 2; i += 65) {
+                uint8_t tPrecisionAndId = tSegment[i];
+                if ((tPrecisionAndId >> 4) != 0 || (tPrecisionAndId & 0x0F) > 1) {
+                    return false; // only 8 bit tables 0 and 1
+                }
+                aInfo->QuantizationTables[tPrecisionAndId & 0x0F] = &tSegment[i + 1];
+            }
+        } else if (tMarker == 0xC0) {
+            // SOF0, baseline
+            aInfo->Height = (tSegment[1] << 8) | tSegment[2];
+            aInfo->Width = (tSegment[3] << 8) | tSegment[4];
+            uint8_t tLuminanceSampling = tSegment[7];
+            if (tLuminanceSampling == 0x21) {
+                aInfo->Type = 0;
+            } else if (tLuminanceSampling == 0x22) {
+                aInfo->Type = 1;
+            } else {
+                return false;
+            }
+        } else if (tMarker == 0xDD) {
+            aInfo->RestartInterval = (tSegment[0] << 8) | tSegment[1];
+        } else if (tMarker == 0xDA) {
+            // SOS, entropy coded data follows until EOI
+            aInfo->ScanData = &aJpeg[tIndex + 2 + tSegmentLength];
+            const uint8_t *tEnd = aJpeg + aLength;
+            while (tEnd - 2 > aInfo->ScanData && !(tEnd[-2] == 0xFF && tEnd[-1] == 0xD9)) {
+                tEnd--; // skip padding after EOI
+            }
+            if (tEnd - 2 <= aInfo->ScanData) {
+                return false; // no EOI, frame is truncated
+            }
+            aInfo->ScanLength = (tEnd - 2) - aInfo->ScanData;
+            break;
+        } else if (tMarker >= 0xC1 && tMarker <= 0xCF && tMarker != 0xC4 && tMarker != 0xC8 && tMarker != 0xCC) {
+            return false; // not baseline
+        }
+        tIndex += 2 + tSegmentLength;
+    }
+    if (aInfo->RestartInterval != 0) {
+        aInfo->Type += 64;
+    }
+    return aInfo->ScanData != NULL && aInfo->QuantizationTables[0] != NULL && aInfo->QuantizationTables[1] != NULL
+            && aInfo->Width > 0 && aInfo->Width <= 2040 && aInfo->Height > 0 && aInfo->Height <= 2040;
+}
+
+/*
+ * Sends one frame as a sequence of RTP packets with the same timestamp. The last packet has the marker bit set.
+ */
+static void sendRtpFrame(const JpegInfoStruct *aInfo, uint32_t aTimestamp, const struct sockaddr_in *aDestination) {
+    static uint8_t sPacket[RTP_MAX_PACKET_SIZE];
+    size_t tOffset = 0;
+    while (tOffset < aInfo->ScanLength) {
+        uint8_t *p = sPacket;
+        // RTP header
+        *p++ = 0x80; // version 2
+        *p++ = RTP_PAYLOAD_TYPE_JPEG;
+        *p++ = sRtpSequenceNumber >> 8;
+        *p++ = sRtpSequenceNumber;
+        *p++ = aTimestamp >> 24;
+        *p++ = aTimestamp >> 16;
+        *p++ = aTimestamp >> 8;
+        *p++ = aTimestamp;
+        *p++ = sRtpSSRC >> 24;
+        *p++ = sRtpSSRC >> 16;
+        *p++ = sRtpSSRC >> 8;
+        *p++ = sRtpSSRC;
+        // JPEG header
+        *p++ = 0; // type specific
+        *p++ = tOffset >> 16;
+        *p++ = tOffset >> 8;
+        *p++ = tOffset;
+        *p++ = aInfo->Type;
+        *p++ = 255; // Q, tables are sent in band
+        *p++ = aInfo->Width / 8;
+        *p++ = aInfo->Height / 8;
+        if (aInfo->Type >= 64) {
+            // Restart marker header, we do not split at restart intervals, so first and last bits are set
+            *p++ = aInfo->RestartInterval >> 8;
+            *p++ = aInfo->RestartInterval;
+            *p++ = 0xFF;
+            *p++ = 0xFF;
+        }
+        if (tOffset == 0) {
+            // Quantization table header
+            *p++ = 0; // MBZ
+            *p++ = 0; // 8 bit precision for both tables
+            *p++ = 0;
+            *p++ = 128;
+            memcpy(p, aInfo->QuantizationTables[0], 64);
+            memcpy(p + 64, aInfo->QuantizationTables[1], 64);
+            p += 128;
+        }
+        size_t tPayloadLength = min((size_t) (sPacket + RTP_MAX_PACKET_SIZE - p), aInfo->ScanLength - tOffset);
+        if (tOffset + tPayloadLength >= aInfo->ScanLength) {
+            sPacket[1] |= 0x80; // marker bit for last packet of frame
+        }
+        memcpy(p, aInfo->ScanData + tOffset, tPayloadLength);
+        p += tPayloadLength;
+        if (sendto(sRtpSocket, sPacket, p - sPacket, 0, (const struct sockaddr*) aDestination, sizeof(struct sockaddr_in)) < 0) {
+            RtpStatistics.SendErrors++;
+        } else {
+            RtpStatistics.Packets++;
+        }
+        sRtpSequenceNumber++;
+        tOffset += tPayloadLength;
+    }
+}
+
+static void rtpTask(void *aParameter) {
+    (void) aParameter;
+    while (sRtpIsRunning) {
+        if (isStillSequenceActive()) {
+            // the still sequencer needs all frames until the framesize is switched back
+            vTaskDelay(pdMS_TO_TICKS(10));
+            continue;
+        }
+        camera_fb_t *tFrame = esp_camera_fb_get();
+        if (tFrame == NULL) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+            continue;
+        }
+        int64_t tStartMicros = esp_timer_get_time();
+        JpegInfoStruct tInfo;
+        if (tFrame->format == PIXFORMAT_JPEG && parseJpeg(tFrame->buf, tFrame->len, &tInfo)) {
+            struct sockaddr_in tDestination;
+            xSemaphoreTake(sRtpDestinationLock, portMAX_DELAY);
+            tDestination = sRtpDestination;
+            xSemaphoreGive(sRtpDestinationLock);
+            sendRtpFrame(&tInfo, (uint32_t) ((tStartMicros * (RTP_CLOCK_RATE / 1000)) / 1000), &tDestination);
+            RtpStatistics.Frames++;
+            RtpStatistics.LastFrameMicros = esp_timer_get_time() - tStartMicros;
+            if (RtpStatistics.MaxFrameMicros < RtpStatistics.LastFrameMicros) {
+                RtpStatistics.MaxFrameMicros = RtpStatistics.LastFrameMicros;
+            }
+        } else {
+            RtpStatistics.InvalidFrames++;
+        }
+        esp_camera_fb_return(tFrame);
+    }
+    close(sRtpSocket);
+    sRtpSocket = -1;
+    sRtpTaskIsAlive = false;
+    Serial.println("RTP stream stopped");
+    vTaskDelete(NULL);
+}
+
+/*
+ * Starts the sender task or changes the destination of the running stream.
+ * A task, which is stopped but still sends its last frame, is awaited, since it closes the socket at its end.
+ * @param aDestinationAddress IPv4 address in network byte order
+ */
+bool startRtpStream(uint32_t aDestinationAddress, uint16_t aPort) {
+    for (int i = 0; !sRtpIsRunning && sRtpTaskIsAlive && i < RTP_STOP_TIMEOUT_MILLIS / 10; ++i) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (!sRtpIsRunning && sRtpTaskIsAlive) {
+        Serial.println("RTP: previous stream did not stop");
+        return false;
+    }
+    if (sRtpDestinationLock == NULL) {
+        sRtpDestinationLock = xSemaphoreCreateMutex(); // all calls come from the http server task
+        if (sRtpDestinationLock == NULL) {
+            return false;
+        }
+    }
+    // The running task may just be sending a frame with the old destination
+    xSemaphoreTake(sRtpDestinationLock, portMAX_DELAY);
+    sRtpDestination.sin_family = AF_INET;
+    sRtpDestination.sin_port = htons(aPort);
+    sRtpDestination.sin_addr.s_addr = aDestinationAddress;
+    xSemaphoreGive(sRtpDestinationLock);
+    if (sRtpTaskIsAlive) {
+        return true; // destination of the running stream is changed
+    }
+    sRtpSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sRtpSocket < 0) {
+        Serial.println("RTP: no socket available");
+        return false;
+    }
+    sRtpSSRC = esp_random();
+    sRtpSequenceNumber = esp_random();
+    sRtpIsRunning = true;
+    sRtpTaskIsAlive = true;
+    // Same priority as the http server tasks
+    if (xTaskCreatePinnedToCore(rtpTask, "RTP", RTP_TASK_STACK_SIZE, NULL, 5, NULL, 1) != pdPASS) {
+        close(sRtpSocket);
+        sRtpSocket = -1;
+        sRtpIsRunning = false;
+        sRtpTaskIsAlive = false;
+        return false;
+    }
+    Serial.printf("RTP stream started to %s:%u\r\n", inet_ntoa(sRtpDestination.sin_addr), aPort);
+    return true;
+}
+
+/*
+ * The task ends after sending the current frame
+ */
+void stopRtpStream() {
+    sRtpIsRunning = false;
+}
+
+bool isRtpStreamRunning() {
+    return sRtpIsRunning;
+}
+
+/*
+ * Session description for receivers like ffplay or VLC
+ * @return number of characters printed
+ */
+int printRtpSdp(char *aBuffer, const char *aLocalIP) {
+    uint16_t tPort = ntohs(sRtpDestination.sin_port);
+    if (tPort == 0) {
+        tPort = RTP_DEFAULT_PORT; // not yet started
+    }
+    return sprintf(aBuffer, "v=0\r\no=- %lu 1 IN IP4 %s\r\ns=ESP32-CAM RTP/JPEG\r\nc=IN IP4 %s\r\nt=0 0\r\n"
+            "m=video %u RTP/AVP %u\r\na=rtpmap:%u JPEG/%u\r\n", (unsigned long) sRtpSSRC, aLocalIP,
+            inet_ntoa(sRtpDestination.sin_addr), tPort, RTP_PAYLOAD_TYPE_JPEG, RTP_PAYLOAD_TYPE_JPEG,
+            RTP_CLOCK_RATE);
+}
+
+/*
+ * @return number of characters printed
+ */
+int printRtpStatus(char *aBuffer) {
+    return sprintf(aBuffer, "\"rtp_running\":%d,\"rtp_destination\":\"%s:%u\",\"rtp_frames\":%lu,\"rtp_packets\":%lu,"
+            "\"rtp_send_errors\":%lu,\"rtp_invalid_frames\":%lu,\"rtp_frame_us\":%lu,\"rtp_max_frame_us\":%lu,", sRtpIsRunning,
+            inet_ntoa(sRtpDestination.sin_addr), ntohs(sRtpDestination.sin_port), (unsigned long) RtpStatistics.Frames,
+            (unsigned long) RtpStatistics.Packets, (unsigned long) RtpStatistics.SendErrors,
+            (unsigned long) RtpStatistics.InvalidFrames, (unsigned long) RtpStatistics.LastFrameMicros,
+            (unsigned long) RtpStatistics.MaxFrameMicros);
+}
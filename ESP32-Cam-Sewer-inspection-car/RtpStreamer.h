@@ -0,0 +1,53 @@
+/*
+ * RtpStreamer.h
+ *
+ *  RTP/JPEG (RFC 2435) video stream over UDP.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _RTP_STREAMER_H
+#define _RTP_STREAMER_H
+
+#include <stdint.h>
+
+#define RTP_DEFAULT_PORT            5004
+#define RTP_MAX_PACKET_SIZE         1400    // below the WiFi MTU, so no IP fragmentation takes place
+#define RTP_PAYLOAD_TYPE_JPEG       26
+#define RTP_CLOCK_RATE              90000
+#define RTP_TASK_STACK_SIZE         4096
+#define RTP_STOP_TIMEOUT_MILLIS     1000    // for sending the last frame after stop
+
+struct RtpStatisticsStruct {
+    uint32_t Frames;
+    uint32_t Packets;
+    uint32_t SendErrors;            // packets not sent, e.g. since the WiFi buffers were full
+    uint32_t InvalidFrames;         // no valid JPEG or not supported by RFC 2435
+    uint32_t LastFrameMicros;       // from fetching the frame until the last packet was sent
+    uint32_t MaxFrameMicros;
+};
+extern RtpStatisticsStruct RtpStatistics;
+
+bool startRtpStream(uint32_t aDestinationAddress, uint16_t aPort);
+void stopRtpStream();
+bool isRtpStreamRunning();
+int printRtpSdp(char *aBuffer, const char *aLocalIP);
+int printRtpStatus(char *aBuffer);
+
+#endif // _RTP_STREAMER_H
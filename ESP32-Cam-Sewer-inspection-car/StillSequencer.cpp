@@ -0,0 +1,247 @@
+/*
+ * StillSequencer.cpp
+ *
+ *  The live stream runs with a small framesize. A still request switches the sensor to STILL_FRAMESIZE,
+ *  takes all pending stills, and switches back, all in one sequence. So the stills of several requests
+ *  share one pair of switches and one stream gap.
+ *  After each switch, only frames with the old size, which were already in the frame buffers,
+ *  and StillWarmupFrames frames of the new size are discarded. While a sequence is active,
+ *  the stream skips all frames. Stills are stored in a ring in PSRAM and fetched by their number.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "freertos/semphr.h"
+
+#include "StillSequencer.h"
+#include "LoopScheduler.h"
+#include "CameraSettings.h"
+#include "esp32-cam-webserver.h"
+
+StillSequencerStatisticsStruct StillSequencerStatistics;
+uint8_t StillWarmupFrames = STILL_WARMUP_DEFAULT_FRAMES;
+
+static StillStruct sStills[STILL_RING_SIZE];
+static uint8_t sNextStillIndex = 0;
+static uint32_t sNextStillNumber = 1;
+static volatile uint8_t sNumberOfPendingStills = 0;
+static volatile bool sSequenceIsActive = false;
+static volatile unsigned long sMillisOfLastStreamFrame;
+static volatile bool sStreamGapIsOpen = false; // set by a sequence, reset by the next stream frame
+SemaphoreHandle_t sStillLock; // serializes the sequences of the loop task and the http server and protects the ring
+
+void initStillSequencer() {
+    sStillLock = xSemaphoreCreateMutex();
+}
+
+/*
+ * The stills are taken by the next run of the loop task
+ * @return number of the first still or -1 if too many stills are pending or no PSRAM is available
+ */
+int queueStills(uint8_t aNumberOfStills) {
+    if (!psramFound() || aNumberOfStills == 0) {
+        return -1;
+    }
+    // The loop task decrements the pending stills, so check and increment must be done with the lock taken
+    xSemaphoreTake(sStillLock, portMAX_DELAY);
+    if (sNumberOfPendingStills + aNumberOfStills > STILL_MAX_PENDING) {
+        xSemaphoreGive(sStillLock);
+        return -1;
+    }
+    int tFirstNumber = sNextStillNumber + sNumberOfPendingStills;
+    sNumberOfPendingStills += aNumberOfStills;
+    xSemaphoreGive(sStillLock);
+    wakeLoopScheduler();
+    return tFirstNumber;
+}
+
+bool isStillSequenceActive() {
+    return sSequenceIsActive;
+}
+
+/*
+ * Called by the stream task for each sent frame
+ */
+void noteStreamFrameForStillGap() {
+    unsigned long tMillis = millis();
+    if (sStreamGapIsOpen && !sSequenceIsActive) {
+        sStreamGapIsOpen = false;
+        StillSequencerStatistics.LastStreamGapMillis = tMillis - sMillisOfLastStreamFrame;
+        if (StillSequencerStatistics.MaxStreamGapMillis < StillSequencerStatistics.LastStreamGapMillis) {
+            StillSequencerStatistics.MaxStreamGapMillis = StillSequencerStatistics.LastStreamGapMillis;
+        }
+    }
+    sMillisOfLastStreamFrame = tMillis;
+}
+
+/*
+ * Switches the framesize and returns the first frame with the new size after StillWarmupFrames frames
+ * @return NULL if no frame with the new size arrived
+ */
+static camera_fb_t* switchFramesize(sensor_t *aSensor, framesize_t aFramesize, uint8_t aWarmupFrames) {
+    writeCameraSetting(aSensor, findCameraSetting("framesize"), aFramesize);
+    uint8_t tFramesWithNewSize = 0;
+    for (int i = 0; i < STILL_MAX_SWITCH_FRAMES + aWarmupFrames; ++i) {
+        camera_fb_t *tFrame = esp_camera_fb_get();
+        if (tFrame == NULL) {
+            return NULL;
+        }
+        if (tFrame->width == resolution[aFramesize].width && tFramesWithNewSize++ >= aWarmupFrames) {
+            return tFrame;
+        }
+        StillSequencerStatistics.LastDiscardedFrames++;
+        esp_camera_fb_return(tFrame);
+    }
+    return NULL;
+}
+
+/*
+ * @return true if the frame was copied to the ring
+ */
+static bool storeStill(camera_fb_t *aFrame, uint8_t aFramesize) {
+    uint32_t tNumber = sNextStillNumber++; // the number is used even if storing fails, it was returned by queueStills()
+    StillStruct *tStill = &sStills[sNextStillIndex];
+    free(tStill->Buffer);
+    tStill->Buffer = (uint8_t*) ps_malloc(aFrame->len);
+    if (tStill->Buffer == NULL) {
+        tStill->Number = 0;
+        return false;
+    }
+    memcpy(tStill->Buffer, aFrame->buf, aFrame->len);
+    tStill->Length = aFrame->len;
+    tStill->Framesize = aFramesize;
+    tStill->Millis = millis();
+    tStill->Number = tNumber;
+    sNextStillIndex = (sNextStillIndex + 1) % STILL_RING_SIZE;
+    return true;
+}
+
+/*
+ * Takes all pending stills in one sequence. Blocks for the duration of the sequence, i.e. some 100 ms.
+ * @return number of the last still taken or 0 if none was taken
+ */
+uint32_t runStillSequence() {
+    xSemaphoreTake(sStillLock, portMAX_DELAY);
+    if (sNumberOfPendingStills == 0) {
+        xSemaphoreGive(sStillLock);
+        return 0;
+    }
+    unsigned long tStartMillis = millis();
+    sensor_t *tSensor = esp_camera_sensor_get();
+    framesize_t tStreamFramesize = tSensor->status.framesize;
+    if (tStreamFramesize == STILL_FRAMESIZE) {
+        // No switch required. The stream is not blocked here.
+        tStreamFramesize = FRAMESIZE_INVALID;
+    } else {
+        sStreamGapIsOpen = (streamCount > 0);
+        sSequenceIsActive = true;
+    }
+    StillSequencerStatistics.LastDiscardedFrames = 0;
+    if (autoLampValue && (lampBrightnessPercentage != -1)) {
+        setLamp(lampBrightnessPercentage);
+    }
+
+    uint32_t tLastNumber = 0;
+    camera_fb_t *tFrame;
+    if (tStreamFramesize == FRAMESIZE_INVALID) {
+        tFrame = esp_camera_fb_get();
+    } else {
+        tFrame = switchFramesize(tSensor, STILL_FRAMESIZE, StillWarmupFrames);
+    }
+    while (sNumberOfPendingStills > 0) {
+        if (tFrame == NULL) {
+            StillSequencerStatistics.Errors += sNumberOfPendingStills;
+            sNextStillNumber += sNumberOfPendingStills;
+            sNumberOfPendingStills = 0;
+            break;
+        }
+        if (storeStill(tFrame, STILL_FRAMESIZE)) {
+            tLastNumber = sNextStillNumber - 1;
+            StillSequencerStatistics.Stills++;
+            imagesServed++;
+        } else {
+            StillSequencerStatistics.Errors++;
+        }
+        esp_camera_fb_return(tFrame);
+        sNumberOfPendingStills--;
+        tFrame = (sNumberOfPendingStills > 0) ? esp_camera_fb_get() : NULL;
+    }
+
+    if (tStreamFramesize != FRAMESIZE_INVALID) {
+        // Back to stream framesize, the first frame with this size is for the stream
+        tFrame = switchFramesize(tSensor, tStreamFramesize, 0);
+        if (tFrame != NULL) {
+            esp_camera_fb_return(tFrame);
+        }
+        sSequenceIsActive = false;
+    }
+    updateLamp();
+    StillSequencerStatistics.Sequences++;
+    StillSequencerStatistics.LastSequenceMillis = millis() - tStartMillis;
+    if (StillSequencerStatistics.MaxSequenceMillis < StillSequencerStatistics.LastSequenceMillis) {
+        StillSequencerStatistics.MaxSequenceMillis = StillSequencerStatistics.LastSequenceMillis;
+    }
+    xSemaphoreGive(sStillLock);
+    Serial.printf("Still sequence: %lu ms, %u frames discarded, last still %lu\r\n",
+            (unsigned long) StillSequencerStatistics.LastSequenceMillis, StillSequencerStatistics.LastDiscardedFrames,
+            (unsigned long) tLastNumber);
+    return tLastNumber;
+}
+
+/*
+ * Loop scheduler task for the stills queued by queueStills()
+ */
+uint32_t stillSequencerLoopTask() {
+    if (sNumberOfPendingStills > 0) {
+        runStillSequence();
+    }
+    return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+}
+
+/*
+ * Calls aSendFunction with the still of number aNumber, while the ring is locked
+ * @return false if the still is not (longer) in the ring or sending failed
+ */
+bool sendStill(uint32_t aNumber, bool (*aSendFunction)(const StillStruct *aStill, void *aContext), void *aContext) {
+    bool tSuccess = false;
+    xSemaphoreTake(sStillLock, portMAX_DELAY);
+    for (int i = 0; i < STILL_RING_SIZE; ++i) {
+        if (sStills[i].Number == aNumber && aNumber != 0) {
+            tSuccess = aSendFunction(&sStills[i], aContext);
+            break;
+        }
+    }
+    xSemaphoreGive(sStillLock);
+    return tSuccess;
+}
+
+/*
+ * @return number of characters printed
+ */
+int printStillSequencerStatus(char *aBuffer) {
+    return sprintf(aBuffer, "\"still_sequences\":%lu,\"stills\":%lu,\"still_errors\":%lu,\"still_sequence_ms\":%u,"
+            "\"still_max_sequence_ms\":%u,\"still_stream_gap_ms\":%u,\"still_max_stream_gap_ms\":%u,\"still_discarded_frames\":%u,",
+            (unsigned long) StillSequencerStatistics.Sequences, (unsigned long) StillSequencerStatistics.Stills,
+            (unsigned long) StillSequencerStatistics.Errors, StillSequencerStatistics.LastSequenceMillis,
+            StillSequencerStatistics.MaxSequenceMillis, StillSequencerStatistics.LastStreamGapMillis,
+            StillSequencerStatistics.MaxStreamGapMillis, StillSequencerStatistics.LastDiscardedFrames);
+}
@@ -0,0 +1,70 @@
+/*
+ * StillSequencer.h
+ *
+ *  High resolution stills taken between the frames of a low resolution live stream.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _STILL_SEQUENCER_H
+#define _STILL_SEQUENCER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_camera.h"
+
+#if !defined(STILL_FRAMESIZE)
+#define STILL_FRAMESIZE                 FRAMESIZE_UXGA
+#endif
+#define STILL_RING_SIZE                 4   // stills are kept in PSRAM until fetched or overwritten
+#define STILL_MAX_PENDING               STILL_RING_SIZE // more would overwrite the first stills of a sequence before they are fetched
+#define STILL_WARMUP_DEFAULT_FRAMES     1   // frames of the new size discarded after a switch for settling exposure
+#define STILL_MAX_SWITCH_FRAMES         8   // limit for frames with the old size after a switch
+
+struct StillStruct {
+    uint8_t *Buffer;                // in PSRAM, NULL if empty
+    size_t Length;
+    uint8_t Framesize;
+    unsigned long Millis;           // time of capture
+    uint32_t Number;                // running number since boot, 0 for empty slot
+};
+
+struct StillSequencerStatisticsStruct {
+    uint32_t Sequences;             // each sequence switches once to the still framesize and back
+    uint32_t Stills;
+    uint32_t Errors;
+    uint16_t LastSequenceMillis;    // from first switch until stream framesize is back
+    uint16_t MaxSequenceMillis;
+    uint16_t LastStreamGapMillis;   // longest time between 2 stream frames caused by the last sequence
+    uint16_t MaxStreamGapMillis;
+    uint8_t LastDiscardedFrames;    // frames discarded for both switches of the last sequence
+};
+extern StillSequencerStatisticsStruct StillSequencerStatistics;
+extern uint8_t StillWarmupFrames;
+
+void initStillSequencer();
+int queueStills(uint8_t aNumberOfStills);
+uint32_t runStillSequence();
+uint32_t stillSequencerLoopTask();
+bool isStillSequenceActive();
+void noteStreamFrameForStillGap();
+bool sendStill(uint32_t aNumber, bool (*aSendFunction)(const StillStruct *aStill, void *aContext), void *aContext);
+int printStillSequencerStatus(char *aBuffer);
+
+#endif // _STILL_SEQUENCER_H
@@ -0,0 +1,102 @@
+/*
+ * StreamThinning.cpp
+ *
+ *  During surveys the car stands still for long times and the stream would send nearly identical frames at full rate.
+ *  A frame is static if the motor is stopped, the JPEG size is close to the last sent frame and the motion estimator,
+ *  if enabled, reports no change of its luminance grid. After STREAM_STATIC_SETTLE_FRAMES static frames,
+ *  only one frame every StreamKeepaliveMillis is sent. The first changed frame is sent immediately.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+#include "StreamThinning.h"
+
+StreamThinningStatisticsStruct StreamThinningStatistics;
+uint16_t StreamKeepaliveMillis = STREAM_KEEPALIVE_DEFAULT_MILLIS;
+
+// Only accessed by the stream task
+static size_t sLengthOfLastSentFrame;
+static unsigned long sMillisOfLastSentFrame;
+static uint8_t sNumberOfStaticFrames;
+static bool sIsThinning = false;
+static bool sIsResuming = false;
+
+/*
+ * @param aImageHasChanged  result of the motion check of this frame
+ * @return false if the frame can be skipped
+ */
+bool isStreamFrameRequired(size_t aLength, bool aImageHasChanged, bool aMotorIsRunning) {
+    size_t tDelta = (aLength > sLengthOfLastSentFrame) ? aLength - sLengthOfLastSentFrame : sLengthOfLastSentFrame - aLength;
+    bool tIsStatic = !aMotorIsRunning && !aImageHasChanged
+            && tDelta * 100 <= sLengthOfLastSentFrame * STREAM_STATIC_SIZE_PERCENT;
+    if (!tIsStatic) {
+        sNumberOfStaticFrames = 0;
+        if (sIsThinning) {
+            sIsThinning = false;
+            sIsResuming = true;
+        }
+        return true;
+    }
+    if (StreamKeepaliveMillis == 0) {
+        return true;
+    }
+    if (sNumberOfStaticFrames < STREAM_STATIC_SETTLE_FRAMES) {
+        sNumberOfStaticFrames++;
+        return true;
+    }
+    sIsThinning = true;
+    if (millis() - sMillisOfLastSentFrame >= StreamKeepaliveMillis) {
+        return true;
+    }
+    StreamThinningStatistics.SkippedFrames++;
+    StreamThinningStatistics.SavedBytes += aLength;
+    return false;
+}
+
+/*
+ * @param aFetchMicros  esp_timer_get_time() value at fetching the frame from the camera
+ */
+void noteStreamFrameSent(size_t aLength, int64_t aFetchMicros) {
+    sLengthOfLastSentFrame = aLength;
+    sMillisOfLastSentFrame = millis();
+    StreamThinningStatistics.SentFrames++;
+    if (sIsResuming) {
+        sIsResuming = false;
+        StreamThinningStatistics.Resumes++;
+        StreamThinningStatistics.LastResumeMicros = esp_timer_get_time() - aFetchMicros;
+        if (StreamThinningStatistics.MaxResumeMicros < StreamThinningStatistics.LastResumeMicros) {
+            StreamThinningStatistics.MaxResumeMicros = StreamThinningStatistics.LastResumeMicros;
+        }
+    }
+}
+
+/*
+ * @return number of characters printed
+ */
+int printStreamThinningStatistics(char *aBuffer) {
+    return sprintf(aBuffer, "\"stream_frames_sent\":%lu,\"stream_frames_skipped\":%lu,\"stream_bytes_saved\":%llu,"
+            "\"stream_resumes\":%lu,\"stream_resume_us\":%lu,\"stream_max_resume_us\":%lu,",
+            (unsigned long) StreamThinningStatistics.SentFrames, (unsigned long) StreamThinningStatistics.SkippedFrames,
+            (unsigned long long) StreamThinningStatistics.SavedBytes, (unsigned long) StreamThinningStatistics.Resumes,
+            (unsigned long) StreamThinningStatistics.LastResumeMicros, (unsigned long) StreamThinningStatistics.MaxResumeMicros);
+}
@@ -0,0 +1,50 @@
+/*
+ * StreamThinning.h
+ *
+ *  Suppression of duplicate stream frames while the car stands still and the scene is static.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _STREAM_THINNING_H
+#define _STREAM_THINNING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define STREAM_KEEPALIVE_DEFAULT_MILLIS 1000    // frame interval of a static scene, 0 disables thinning
+#define STREAM_STATIC_SIZE_PERCENT      1       // maximum change of JPEG size against the last sent frame for a static scene
+#define STREAM_STATIC_SETTLE_FRAMES     5       // frames of a static scene sent at full rate, before thinning starts
+
+struct StreamThinningStatisticsStruct {
+    uint32_t SentFrames;
+    uint32_t SkippedFrames;
+    uint64_t SavedBytes;
+    uint32_t Resumes;               // number of changes from thinned to full rate
+    uint32_t LastResumeMicros;      // from fetching the first changed frame until it was sent
+    uint32_t MaxResumeMicros;
+};
+extern StreamThinningStatisticsStruct StreamThinningStatistics;
+extern uint16_t StreamKeepaliveMillis;
+
+bool isStreamFrameRequired(size_t aLength, bool aImageHasChanged, bool aMotorIsRunning);
+void noteStreamFrameSent(size_t aLength, int64_t aFetchMicros);
+int printStreamThinningStatistics(char *aBuffer);
+
+#endif // _STREAM_THINNING_H
@@ -20,6 +20,7 @@
 #include <esp_camera.h>
 
 #include <esp_task_wdt.h>
+#include "lwip/sockets.h"
 #include <Arduino.h>
 #include <WiFi.h>
 
@@ -35,6 +36,19 @@
 #include "favicons.h"
 #include "logo.h"
 #include "storage.h"
+#include "CameraSettings.h"
+#include "CameraProfiles.h"
+#include "JsonScanner.h"
+#include "LoopScheduler.h"
+#include "MotionQueue.h"
+#include "BatteryMonitor.h"
+#include "MotorCalibration.h"
+#include "MotionEstimator.h"
+#include "StreamThinning.h"
+#include "AutoLampController.h"
+#include "BandingTest.h"
+#include "StillSequencer.h"
+#include "RtpStreamer.h"
 
 #include "esp32-cam-webserver.h"
 #include "MotorAndServoControl.h"
@@ -48,6 +62,7 @@ typedef struct {
 static const char *_STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
 static const char *_STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
 static const char *_STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n";
+static const char *_STREAM_PART_ODOMETER = "Content-Type: image/jpeg\r\nContent-Length: %u\r\nX-Odometer-Mm: %ld\r\n\r\n";
 
 httpd_handle_t stream_httpd = NULL;
 httpd_handle_t camera_httpd = NULL;
@@ -148,12 +163,63 @@ void serialDump() {
     return;
 }
 
+static bool sendStillResponse(const StillStruct *aStill, void *aContext) {
+    httpd_req_t *req = (httpd_req_t*) aContext;
+    httpd_resp_set_type(req, "image/jpeg");
+    httpd_resp_set_hdr(req, "Content-Disposition", "inline");
+    return httpd_resp_send(req, (const char*) aStill->Buffer, aStill->Length) == ESP_OK;
+}
+
+/*
+ * /capture?hires=1 switches to STILL_FRAMESIZE for one still and back, the stream keeps its framesize
+ * /capture?hires=<n>&queue=1 queues n stills, which are taken in one sequence. Returns the number of the first still.
+ * /capture?still=<number> returns a still taken by hires
+ */
+static esp_err_t hires_capture_handler(httpd_req_t *req, const char *aQuery) {
+    char tValue[12];
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    int tStillNumber;
+    if (httpd_query_key_value(aQuery, "still", tValue, sizeof(tValue)) == ESP_OK) {
+        tStillNumber = atoi(tValue);
+    } else {
+        httpd_query_key_value(aQuery, "hires", tValue, sizeof(tValue));
+        int tNumberOfStills = constrain(atoi(tValue), 1, STILL_MAX_PENDING);
+        tStillNumber = queueStills(tNumberOfStills);
+        if (tStillNumber < 0) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Too many stills pending or no PSRAM");
+            return ESP_FAIL;
+        }
+        if (httpd_query_key_value(aQuery, "queue", tValue, sizeof(tValue)) == ESP_OK) {
+            char tResponse[48];
+            sprintf(tResponse, "{\"first_still\":%d,\"stills\":%d}", tStillNumber, tNumberOfStills);
+            httpd_resp_set_type(req, "application/json");
+            return httpd_resp_send(req, tResponse, strlen(tResponse));
+        }
+        suspendFailsafe();
+        runStillSequence(); // takes also the stills queued before
+        resumeFailsafe();
+    }
+    if (!sendStill(tStillNumber, sendStillResponse, req)) {
+        httpd_resp_send_404(req);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
 static esp_err_t capture_handler(httpd_req_t *req) {
     camera_fb_t *fb = NULL;
     esp_err_t res = ESP_OK;
 
     sMillisOfLastAction = millis();
     Serial.println("Capture Requested");
+    char tQuery[48];
+    if (httpd_req_get_url_query_str(req, tQuery, sizeof(tQuery)) == ESP_OK) {
+        char tValue[12];
+        if (httpd_query_key_value(tQuery, "hires", tValue, sizeof(tValue)) == ESP_OK
+                || httpd_query_key_value(tQuery, "still", tValue, sizeof(tValue)) == ESP_OK) {
+            return hires_capture_handler(req, tQuery);
+        }
+    }
     if (autoLampValue && (lampBrightnessPercentage != -1)) {
         setLamp(lampBrightnessPercentage);
     } else {
@@ -162,6 +228,7 @@ static esp_err_t capture_handler(httpd_req_t *req) {
 
     int64_t fr_start = esp_timer_get_time();
 
+    suspendFailsafe();
     fb = esp_camera_fb_get();
 
     /*
@@ -171,6 +238,7 @@ static esp_err_t capture_handler(httpd_req_t *req) {
         esp_camera_fb_return(fb); // dispose the buffered image
         fb = esp_camera_fb_get(); // get fresh image
     }
+    resumeFailsafe();
 
     if (!fb) {
         Serial.println("CAPTURE: failed to acquire frame");
@@ -181,9 +249,18 @@ static esp_err_t capture_handler(httpd_req_t *req) {
         return ESP_FAIL;
     }
 
+    if (BootTiming.FirstFrameMillis == 0) {
+        BootTiming.FirstFrameMillis = millis();
+    }
     httpd_resp_set_type(req, "image/jpeg");
     httpd_resp_set_hdr(req, "Content-Disposition", "inline");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    // Header values must be valid until the response is sent
+    static char tOdometerString[12];
+    if (sEncoderIsSupported) {
+        sprintf(tOdometerString, "%ld", (long) getOdometerMillimeter());
+        httpd_resp_set_hdr(req, "X-Odometer-Mm", tOdometerString);
+    }
 
     size_t fb_len = 0;
     if (fb->format == PIXFORMAT_JPEG) {
@@ -214,6 +291,7 @@ static esp_err_t stream_handler(httpd_req_t *req) {
     Serial.println("Stream requested");
     if (autoLampValue && (lampBrightnessPercentage != -1))
         setLamp(lampBrightnessPercentage);
+    restartAutoLamp(); // the controller starts with the full lamp value
     streamCount = 1; // at present we only have one stream handler, so values are 0 or 1..
     flashLED(75); // double flash of status LED
     delay(75);
@@ -247,19 +325,43 @@ static esp_err_t stream_handler(httpd_req_t *req) {
             } else {
                 sLastFrameTime = esp_timer_get_time();
                 sFpsFrameCount++;
+                if (BootTiming.FirstFrameMillis == 0) {
+                    BootTiming.FirstFrameMillis = millis();
+                }
                 _jpg_buf_len = fb->len;
                 _jpg_buf = fb->buf;
             }
         }
-        if (res == ESP_OK) {
-            res = httpd_resp_send_chunk(req, _STREAM_BOUNDARY, strlen(_STREAM_BOUNDARY));
-        }
-        if (res == ESP_OK) {
-            size_t hlen = snprintf((char*) part_buf, 64, _STREAM_PART, _jpg_buf_len);
-            res = httpd_resp_send_chunk(req, (const char*) part_buf, hlen);
+        bool tSendFrame = true;
+        if (res == ESP_OK && isStillSequenceActive()) {
+            tSendFrame = false; // frame has the still framesize or is a warm up frame
+        } else if (res == ESP_OK) {
+            // Before sending, since the result also decides if a frame of a static scene is skipped
+            bool tImageHasChanged = checkFrameForMotion(fb, sMotionEstimatorIsSupported);
+            if (sOnePWMMotorIsSupported) {
+                noteStreamFrameForStallDetection(tImageHasChanged);
+            }
+            tSendFrame = isStreamFrameRequired(_jpg_buf_len, tImageHasChanged, sOnePWMMotorIsSupported && !isMotorStopped());
         }
-        if (res == ESP_OK) {
-            res = httpd_resp_send_chunk(req, (const char*) _jpg_buf, _jpg_buf_len);
+        if (res == ESP_OK && tSendFrame) {
+            res = httpd_resp_send_chunk(req, _STREAM_BOUNDARY, strlen(_STREAM_BOUNDARY));
+            if (res == ESP_OK) {
+                size_t hlen;
+                if (sEncoderIsSupported) {
+                    hlen = snprintf((char*) part_buf, sizeof(part_buf), _STREAM_PART_ODOMETER, _jpg_buf_len,
+                            (long) getOdometerMillimeter());
+                } else {
+                    hlen = snprintf((char*) part_buf, 64, _STREAM_PART, _jpg_buf_len);
+                }
+                res = httpd_resp_send_chunk(req, (const char*) part_buf, hlen);
+            }
+            if (res == ESP_OK) {
+                res = httpd_resp_send_chunk(req, (const char*) _jpg_buf, _jpg_buf_len);
+            }
+            if (res == ESP_OK) {
+                noteStreamFrameSent(_jpg_buf_len, sLastFrameTime);
+                noteStreamFrameForStillGap();
+            }
         }
         if (fb) {
             esp_camera_fb_return(fb); // release frame buffer
@@ -294,14 +396,230 @@ static esp_err_t stream_handler(httpd_req_t *req) {
     return res;
 }
 
+#define CONTROL_OK          0
+#define CONTROL_UNCHANGED   1   // Camera setting already had this value, sensor was not written
+#define CONTROL_COALESCED   2   // Camera setting was overwritten by a later item of the same batch
+#define CONTROL_ERROR       (-1)
+
 /*
- * handles request to change a control value
+ * Applies one control value. Used for single and batched requests.
+ * @return CONTROL_OK, CONTROL_UNCHANGED or CONTROL_ERROR
  */
+static int applyControl(const char *aName, const char *aValue) {
+    int val = atoi(aValue);
+    const CameraSettingStruct *tCameraSetting = findCameraSetting(aName);
+    if (tCameraSetting != NULL) {
+        int tResult = writeCameraSetting(esp_camera_sensor_get(), tCameraSetting, val);
+        if (tResult == CAMERA_SETTING_UNCHANGED) {
+            return CONTROL_UNCHANGED;
+        } else if (tResult == CAMERA_SETTING_ERROR) {
+            return CONTROL_ERROR;
+        }
+    } else if (!strcmp(aName, "rotate")) {
+        myRotation = val;
+    } else if (!strcmp(aName, "autolamp") && (lampBrightnessPercentage != -1)) {
+        autoLampValue = val;
+        updateLamp();
+    } else if (!strcmp(aName, "lamp") && (lampBrightnessPercentage != -1)) {
+        lampBrightnessPercentage = constrain(val, 0, 100);
+        updateLamp();
+    } else if (!strcmp(aName, "lamp-frequency") && (lampBrightnessPercentage != -1)) {
+        if (!setLampFrequency(val)) {
+            return CONTROL_ERROR;
+        }
+    } else if (!strcmp(aName, "lamp-exposure") && (lampBrightnessPercentage != -1)) {
+        AutoLampExposureTargetLines = constrain(val, 0, 2000);
+        updateLamp();
+    } else if (!strcmp(aName, "profile")) {
+        if (applyCameraProfile(aValue) < 0) {
+            return CONTROL_ERROR;
+        }
+    } else if (!strcmp(aName, "save_profile")) {
+        suspendFailsafe();
+        bool tSuccess = filesystem && saveCameraProfile(SPIFFS, aValue);
+        resumeFailsafe();
+        if (!tSuccess) {
+            return CONTROL_ERROR;
+        }
+    } else if (!strcmp(aName, "save_prefs")) {
+        if (filesystem) {
+            suspendFailsafe();
+            savePrefs(SPIFFS);
+            resumeFailsafe();
+        }
+    } else if (!strcmp(aName, "clear_prefs")) {
+        if (filesystem)
+            removePrefs(SPIFFS);
+    } else if (!strcmp(aName, "reboot")) {
+        // If the TWDT was not initialized automatically on startup, manually intialize it now
+#if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(3, 0, 0)
+        esp_task_wdt_config_t twdt_config = { .timeout_ms = 3000, .idle_core_mask = 0x03,    // Bitmask of all cores
+                .trigger_panic = true, };
+        esp_task_wdt_init(&twdt_config);  // schedule a a watchdog panic event for 3 seconds in the future
+#else
+        esp_task_wdt_init(3, true);  // schedule a a watchdog panic event for 3 seconds in the future
+#endif
+
+        esp_task_wdt_add(NULL);
+        periph_module_disable(PERIPH_I2C0_MODULE);  // try to shut I2C down properly
+        periph_module_disable(PERIPH_I2C1_MODULE);
+        periph_module_reset(PERIPH_I2C0_MODULE);
+        periph_module_reset(PERIPH_I2C1_MODULE);
+        Serial.print("REBOOT requested");
+        while (true) {
+            flashLED(50);
+            delay(150);
+            Serial.print('.');
+        }
+    } else if (!strcmp(aName, "stream-keepalive")) {
+        StreamKeepaliveMillis = constrain(val, 0, 10000);
+    } else if (!strcmp(aName, "look")) {
+        // "<pan>,<tilt>" or a preset name, which can not be handled by the integer value of ServoAndMotorCommandInterpreter()
+        if (!startGimbalLook(aValue)) {
+            return CONTROL_ERROR;
+        }
+    } else if (ServoAndMotorCommandInterpreter(aName, val)) {
+        // do nothing here;
+    } else {
+        Serial.print("String=");
+        Serial.print(aName);
+        Serial.print(" value=");
+        Serial.println(val);
+        return CONTROL_ERROR;
+    }
+    return CONTROL_OK;
+}
+
+/*
+ * Batch of controls of one request. Name and value point into the request buffer.
+ */
+#define CONTROL_BATCH_MAX_ITEMS     32
+struct ControlItemStruct {
+    const char *Name;
+    const char *Value;
+    uint8_t Order;  // Index in CameraSettings table, NumberOfCameraSettings for all other controls
+    int8_t Result;
+};
+struct ControlBatchStruct {
+    uint8_t NumberOfItems;
+    uint8_t NumberOfDroppedItems; // items beyond CONTROL_BATCH_MAX_ITEMS, the batch is then rejected
+    ControlItemStruct Items[CONTROL_BATCH_MAX_ITEMS];
+};
+static ControlBatchStruct sControlBatch; // requests are handled sequentially by the http server task
+
+static void addControlItem(const char *aName, const char *aValue, void *aContext) {
+    ControlBatchStruct *tBatch = (ControlBatchStruct*) aContext;
+    if (tBatch->NumberOfItems >= CONTROL_BATCH_MAX_ITEMS) {
+        if (tBatch->NumberOfDroppedItems < UINT8_MAX) {
+            tBatch->NumberOfDroppedItems++;
+        }
+        return;
+    }
+    ControlItemStruct *tItem = &tBatch->Items[tBatch->NumberOfItems++];
+    tItem->Name = aName;
+    tItem->Value = aValue;
+    int tIndex = findCameraSettingIndex(aName);
+    tItem->Order = (tIndex < 0) ? NumberOfCameraSettings : tIndex;
+    tItem->Result = CONTROL_ERROR;
+}
+
+/*
+ * Parses "framesize=8&quality=12&lamp=50" in place
+ * @return number of items or -1 if a pair has no value
+ */
+static int parseControlQuery(char *aQuery, ControlBatchStruct *aBatch) {
+    char *tPair = aQuery;
+    while (tPair != NULL && *tPair != '\0') {
+        char *tNextPair = strchr(tPair, '&');
+        if (tNextPair != NULL) {
+            *tNextPair++ = '\0';
+        }
+        char *tValue = strchr(tPair, '=');
+        if (tValue == NULL) {
+            return -1;
+        }
+        *tValue++ = '\0';
+        addControlItem(tPair, tValue, aBatch);
+        tPair = tNextPair;
+    }
+    return aBatch->NumberOfItems;
+}
+
+/*
+ * Applies all items in dependency order, i.e. camera settings in the sequence of the CameraSettings table
+ * (framesize before quality, aec before aec_value etc.) followed by all other controls in request order.
+ * Sends one JSON response with the result of each item.
+ * A batch with more than CONTROL_BATCH_MAX_ITEMS items is rejected with 400 without applying any item.
+ */
+static esp_err_t applyControlBatch(httpd_req_t *req, ControlBatchStruct *aBatch) {
+    if (aBatch->NumberOfDroppedItems > 0) {
+        Serial.printf("Control batch rejected, %u items more than %d\r\n", aBatch->NumberOfDroppedItems, CONTROL_BATCH_MAX_ITEMS);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Too many controls in batch");
+        return ESP_FAIL;
+    }
+    // stable insertion sort by order
+    for (uint_fast8_t i = 1; i < aBatch->NumberOfItems; ++i) {
+        ControlItemStruct tItem = aBatch->Items[i];
+        int_fast8_t j = i - 1;
+        while (j >= 0 && aBatch->Items[j].Order > tItem.Order) {
+            aBatch->Items[j + 1] = aBatch->Items[j];
+            j--;
+        }
+        aBatch->Items[j + 1] = tItem;
+    }
+
+    static char json_response[2048];
+    char *p = json_response;
+    *p++ = '{';
+    int tNumberOfErrors = 0;
+    for (uint_fast8_t i = 0; i < aBatch->NumberOfItems; ++i) {
+        ControlItemStruct *tItem = &aBatch->Items[i];
+        if (tItem->Order < NumberOfCameraSettings && i + 1 < aBatch->NumberOfItems && aBatch->Items[i + 1].Order == tItem->Order) {
+            // Same camera setting follows, only the last one is written
+            tItem->Result = CONTROL_COALESCED;
+            CameraSettingsStatistics.CoalescedWrites++;
+        } else {
+            tItem->Result = applyControl(tItem->Name, tItem->Value);
+        }
+        if (tItem->Result == CONTROL_ERROR) {
+            tNumberOfErrors++;
+        }
+        if (p - json_response < (int) sizeof(json_response) - 64) {
+            const char *tResultString = "error";
+            if (tItem->Result == CONTROL_OK) {
+                tResultString = "ok";
+            } else if (tItem->Result == CONTROL_UNCHANGED) {
+                tResultString = "unchanged";
+            } else if (tItem->Result == CONTROL_COALESCED) {
+                tResultString = "coalesced";
+            }
+            p += snprintf(p, 64, "\"%.32s\":\"%s\",", tItem->Name, tResultString);
+        }
+    }
+    p += sprintf(p, "\"errors\":%d", tNumberOfErrors);
+    *p++ = '}';
+    *p++ = 0;
+    Serial.printf("Control batch with %u items applied, %d errors\r\n", aBatch->NumberOfItems, tNumberOfErrors);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    return httpd_resp_send(req, json_response, strlen(json_response));
+}
+
+/*
+ * Handles request to change one or more control values
+ * Single value: GET /control?var=framesize&val=8 - empty response or error 500
+ * Batch:        GET /control?framesize=8&quality=12&lamp=50 or
+ *               POST /control with body {"framesize":8,"quality":12,"lamp":50} or framesize=8&quality=12&lamp=50
+ *               Response is JSON with the result of each item, e.g. {"framesize":"ok","quality":"unchanged","lamp":"ok","errors":0}
+ *               Result "coalesced" means, that the same setting occurs later in the batch and only the later value is written.
+ */
+#define CONTROL_POST_MAX_SIZE   1024
 static esp_err_t cmd_handler(httpd_req_t *req) {
     char *buf;
     size_t buf_len;
     char tCommandString[32] = { 0, };
     char value[32] = { 0, };
+    esp_err_t tResult;
 
     /*
      * Signal processing of a request
@@ -309,6 +627,53 @@ static esp_err_t cmd_handler(httpd_req_t *req) {
     flashLED(75);
     sMillisOfLastAction = millis();
 
+    if (req->method == HTTP_POST) {
+        if (req->content_len == 0 || req->content_len > CONTROL_POST_MAX_SIZE) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid body size");
+            return ESP_FAIL;
+        }
+        buf_len = req->content_len;
+        buf = (char*) malloc(buf_len + 1);
+        if (!buf) {
+            httpd_resp_send_500(req);
+            return ESP_FAIL;
+        }
+        size_t tReceived = 0;
+        while (tReceived < buf_len) {
+            int tLength = httpd_req_recv(req, buf + tReceived, buf_len - tReceived);
+            if (tLength <= 0) {
+                if (tLength == HTTPD_SOCK_ERR_TIMEOUT) {
+                    continue;
+                }
+                free(buf);
+                return ESP_FAIL;
+            }
+            tReceived += tLength;
+        }
+        buf[buf_len] = '\0';
+
+        sControlBatch.NumberOfItems = 0;
+        sControlBatch.NumberOfDroppedItems = 0;
+        char *tBody = buf;
+        while (isspace(*tBody)) {
+            tBody++;
+        }
+        int tNumberOfItems;
+        if (*tBody == '{') {
+            tNumberOfItems = scanFlatJsonObject(tBody, strlen(tBody), addControlItem, &sControlBatch);
+        } else {
+            tNumberOfItems = parseControlQuery(tBody, &sControlBatch);
+        }
+        if (tNumberOfItems <= 0) {
+            free(buf);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid control batch");
+            return ESP_FAIL;
+        }
+        tResult = applyControlBatch(req, &sControlBatch);
+        free(buf);
+        return tResult;
+    }
+
     buf_len = httpd_req_get_url_query_len(req) + 1;
     if (buf_len > 1) {
         buf = (char*) malloc(buf_len);
@@ -320,9 +685,19 @@ static esp_err_t cmd_handler(httpd_req_t *req) {
             if (httpd_query_key_value(buf, "var", tCommandString, sizeof(tCommandString)) == ESP_OK
                     && httpd_query_key_value(buf, "val", value, sizeof(value)) == ESP_OK) {
             } else {
+                /*
+                 * No var and val -> batch request
+                 */
+                sControlBatch.NumberOfItems = 0;
+                sControlBatch.NumberOfDroppedItems = 0;
+                if (parseControlQuery(buf, &sControlBatch) <= 0) {
+                    free(buf);
+                    httpd_resp_send_404(req);
+                    return ESP_FAIL;
+                }
+                tResult = applyControlBatch(req, &sControlBatch);
                 free(buf);
-                httpd_resp_send_404(req);
-                return ESP_FAIL;
+                return tResult;
             }
         } else {
             free(buf);
@@ -335,117 +710,7 @@ static esp_err_t cmd_handler(httpd_req_t *req) {
         return ESP_FAIL;
     }
 
-    int val = atoi(value);
-    sensor_t *s = esp_camera_sensor_get();
-    int res = 0;
-    if (!strcmp(tCommandString, "framesize")) {
-        if (s->pixformat == PIXFORMAT_JPEG)
-            res = s->set_framesize(s, (framesize_t) val);
-    } else if (!strcmp(tCommandString, "quality"))
-        res = s->set_quality(s, val);
-    else if (!strcmp(tCommandString, "contrast"))
-        res = s->set_contrast(s, val);
-    else if (!strcmp(tCommandString, "brightness"))
-        res = s->set_brightness(s, val);
-    else if (!strcmp(tCommandString, "saturation"))
-        res = s->set_saturation(s, val);
-    else if (!strcmp(tCommandString, "gainceiling"))
-        res = s->set_gainceiling(s, (gainceiling_t) val);
-    else if (!strcmp(tCommandString, "colorbar"))
-        res = s->set_colorbar(s, val);
-    else if (!strcmp(tCommandString, "awb"))
-        res = s->set_whitebal(s, val);
-    else if (!strcmp(tCommandString, "agc"))
-        res = s->set_gain_ctrl(s, val);
-    else if (!strcmp(tCommandString, "aec"))
-        res = s->set_exposure_ctrl(s, val);
-    else if (!strcmp(tCommandString, "hmirror"))
-        res = s->set_hmirror(s, val);
-    else if (!strcmp(tCommandString, "vflip"))
-        res = s->set_vflip(s, val);
-    else if (!strcmp(tCommandString, "awb_gain"))
-        res = s->set_awb_gain(s, val);
-    else if (!strcmp(tCommandString, "agc_gain"))
-        res = s->set_agc_gain(s, val);
-    else if (!strcmp(tCommandString, "aec_value"))
-        res = s->set_aec_value(s, val);
-    else if (!strcmp(tCommandString, "aec2"))
-        res = s->set_aec2(s, val);
-    else if (!strcmp(tCommandString, "dcw"))
-        res = s->set_dcw(s, val);
-    else if (!strcmp(tCommandString, "bpc"))
-        res = s->set_bpc(s, val);
-    else if (!strcmp(tCommandString, "wpc"))
-        res = s->set_wpc(s, val);
-    else if (!strcmp(tCommandString, "raw_gma"))
-        res = s->set_raw_gma(s, val);
-    else if (!strcmp(tCommandString, "lenc"))
-        res = s->set_lenc(s, val);
-    else if (!strcmp(tCommandString, "special_effect"))
-        res = s->set_special_effect(s, val);
-    else if (!strcmp(tCommandString, "wb_mode"))
-        res = s->set_wb_mode(s, val);
-    else if (!strcmp(tCommandString, "ae_level"))
-        res = s->set_ae_level(s, val);
-    else if (!strcmp(tCommandString, "rotate"))
-        myRotation = val;
-    else if (!strcmp(tCommandString, "autolamp") && (lampBrightnessPercentage != -1)) {
-        autoLampValue = val;
-        if (autoLampValue) {
-            if (streamCount > 0)
-                setLamp(lampBrightnessPercentage);
-            else
-                setLamp(0);
-        } else {
-            setLamp(lampBrightnessPercentage);
-        }
-    } else if (!strcmp(tCommandString, "lamp") && (lampBrightnessPercentage != -1)) {
-        lampBrightnessPercentage = constrain(val, 0, 100);
-        if (autoLampValue) {
-            if (streamCount > 0)
-                setLamp(lampBrightnessPercentage);
-            else
-                setLamp(0);
-        } else {
-            setLamp(lampBrightnessPercentage);
-        }
-    } else if (!strcmp(tCommandString, "save_prefs")) {
-        if (filesystem)
-            savePrefs(SPIFFS);
-    } else if (!strcmp(tCommandString, "clear_prefs")) {
-        if (filesystem)
-            removePrefs(SPIFFS);
-    } else if (!strcmp(tCommandString, "reboot")) {
-        // If the TWDT was not initialized automatically on startup, manually intialize it now
-#if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(3, 0, 0)
-        esp_task_wdt_config_t twdt_config = { .timeout_ms = 3000, .idle_core_mask = 0x03,    // Bitmask of all cores
-                .trigger_panic = true, };
-        esp_task_wdt_init(&twdt_config);  // schedule a a watchdog panic event for 3 seconds in the future
-#else
-        esp_task_wdt_init(3, true);  // schedule a a watchdog panic event for 3 seconds in the future
-#endif
-
-        esp_task_wdt_add(NULL);
-        periph_module_disable(PERIPH_I2C0_MODULE);  // try to shut I2C down properly
-        periph_module_disable(PERIPH_I2C1_MODULE);
-        periph_module_reset(PERIPH_I2C0_MODULE);
-        periph_module_reset(PERIPH_I2C1_MODULE);
-        Serial.print("REBOOT requested");
-        while (true) {
-            flashLED(50);
-            delay(150);
-            Serial.print('.');
-        }
-    } else if (ServoAndMotorCommandInterpreter(tCommandString, val)) {
-        // do nothing here;
-    } else {
-        res = -1;
-        Serial.print("String=");
-        Serial.print(tCommandString);
-        Serial.print(" value=");
-        Serial.println(val);
-    }
-    if (res) {
+    if (applyControl(tCommandString, value) == CONTROL_ERROR) {
         return httpd_resp_send_500(req);
     }
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
@@ -460,20 +725,40 @@ static esp_err_t status_handler(httpd_req_t *req) {
     Serial.print("LastMotorSpeed=");
     Serial.println(LastMotorSpeed);
 
-    static char json_response[1024];
+    static char json_response[1536];
     sensor_t *s = esp_camera_sensor_get();
     char *p = json_response;
     *p++ = '{';
     if (lampBrightnessPercentage != -1) {
         p += sprintf(p, "\"lamp\":%d,", lampBrightnessPercentage);
         p += sprintf(p, "\"autolamp\":%d,", autoLampValue);
+        p += sprintf(p, "\"lamp-exposure\":%u,", AutoLampExposureTargetLines);
+        p += sprintf(p, "\"lamp-frequency\":%d,", lampPWMFrequency);
     }
     if (sPanServoIsSupported) {
         p += sprintf(p, "\"pan\":%d,", ServoPanDegree);
     }
+    if (sTiltServoIsSupported) {
+        p += sprintf(p, "\"tilt\":%d,", ServoTiltDegree);
+    }
     if (sOnePWMMotorIsSupported) {
         p += sprintf(p, "\"motor-speed\":%d,", LastMotorSpeed);
+        p += sprintf(p, "\"stalled\":%d,", isMotorStalled());
+        p += sprintf(p, "\"stall-reverse\":%u,", StallReverseMillis);
+    }
+    if (sEncoderIsSupported) {
+        p += sprintf(p, "\"odometer_mm\":%ld,", (long) getOdometerMillimeter());
+        p += sprintf(p, "\"encoder_speed\":%u,", EncoderCountsPerSecond);
+    }
+    if (sBatteryMonitorIsSupported) {
+        p += sprintf(p, "\"battery_mv\":%u,", BatteryStatus.Millivolt);
+        p += sprintf(p, "\"battery_low\":%d,", BatteryStatus.IsLow);
     }
+    if (sMotionEstimatorIsSupported) {
+        p += sprintf(p, "\"visual_odometer_mm\":%ld,", (long) MotionEstimate.VisualOdometerMillimeter);
+        p += sprintf(p, "\"scene_change\":%u,", MotionEstimate.SceneChangeScore);
+    }
+    p += sprintf(p, "\"stream-keepalive\":%u,", StreamKeepaliveMillis);
     p += sprintf(p, "\"framesize\":%u,", s->status.framesize);
     p += sprintf(p, "\"quality\":%u,", s->status.quality);
     p += sprintf(p, "\"brightness\":%d,", s->status.brightness);
@@ -503,6 +788,9 @@ static esp_err_t status_handler(httpd_req_t *req) {
     p += sprintf(p, "\"code_ver\":\"%s\",", sCompileTimestamp);
     p += sprintf(p, "\"rotate\":\"%d\",", myRotation);
     p += sprintf(p, "\"rssi\":\"%d\",", WiFi.RSSI());
+    p += sprintf(p, "\"profiles\":\"");
+    p += printCameraProfileNames(p);
+    p += sprintf(p, "\",");
     p += sprintf(p, "\"stream_url\":\"%s\"", streamURL);
     *p++ = '}';
     *p++ = 0;
@@ -538,12 +826,63 @@ static esp_err_t fps_info_handler(httpd_req_t *req) {
 }
 
 static esp_err_t info_handler(httpd_req_t *req) {
-    static char json_response[256];
+    static char json_response[320];
     char *p = json_response;
     *p++ = '{';
     p += sprintf(p, "\"cam_name\":\"%s\",", sApplicationName);
     p += sprintf(p, "\"rotate\":\"%d\",", myRotation);
-    p += sprintf(p, "\"stream_url\":\"%s\"", streamURL);
+    p += sprintf(p, "\"stream_url\":\"%s\",", streamURL);
+    p += sprintf(p, "\"http_url\":\"%s\"", httpURL); // for the heartbeat of the viewer
+    *p++ = '}';
+    *p++ = 0;
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    return httpd_resp_send(req, json_response, strlen(json_response));
+}
+
+/*
+ * Performance figures for remote monitoring
+ */
+static esp_err_t metrics_handler(httpd_req_t *req) {
+    static char json_response[3072];
+    char *p = json_response;
+    *p++ = '{';
+    p += sprintf(p, "\"uptime_ms\":%lu,", millis());
+    p += sprintf(p, "\"boot_camera_ms\":%lu,", BootTiming.CameraReadyMillis);
+    p += sprintf(p, "\"boot_filesystem_ms\":%lu,", BootTiming.FilesystemReadyMillis);
+    p += sprintf(p, "\"boot_prefs_ms\":%lu,", BootTiming.PreferencesLoadedMillis);
+    p += sprintf(p, "\"boot_wifi_ms\":%lu,", BootTiming.WifiReadyMillis);
+    p += sprintf(p, "\"boot_server_ms\":%lu,", BootTiming.ServerStartedMillis);
+    p += sprintf(p, "\"first_frame_ms\":%lu,", BootTiming.FirstFrameMillis);
+    p += sprintf(p, "\"wifi_rssi\":%d,", WiFi.RSSI());
+    p += sprintf(p, "\"wifi_reconnects\":%lu,", (unsigned long) WifiStatistics.Reconnects);
+    p += sprintf(p, "\"wifi_last_reconnect_ms\":%lu,", WifiStatistics.LastReconnectMillis);
+    p += sprintf(p, "\"wifi_max_reconnect_ms\":%lu,", WifiStatistics.MaxReconnectMillis);
+    p += sprintf(p, "\"wifi_fast_connects\":%lu,", (unsigned long) WifiStatistics.FastConnects);
+    p += sprintf(p, "\"wifi_scans\":%lu,", (unsigned long) WifiStatistics.Scans);
+    p += sprintf(p, "\"wifi_roams\":%lu,", (unsigned long) WifiStatistics.Roams);
+    p += printCameraSettingsStatistics(p);
+    p += sprintf(p, "\"motor_stop_late_ms\":%lu,", LastMotorStopLatenessMillis);
+    p += sprintf(p, "\"motor_stop_max_late_ms\":%lu,", MaxMotorStopLatenessMillis);
+    if (sBatteryMonitorIsSupported) {
+        p += printBatteryStatus(p);
+    }
+    if (sOnePWMMotorIsSupported) {
+        p += printFailsafeStatistics(p);
+        p += sprintf(p, "\"motor_stalls\":%lu,", (unsigned long) NumberOfMotorStalls);
+    }
+    if (sMotionEstimatorIsSupported) {
+        p += printMotionEstimate(p);
+    }
+    p += printStreamThinningStatistics(p);
+    p += printStillSequencerStatus(p);
+    p += printRtpStatus(p);
+    if (lampBrightnessPercentage != -1) {
+        p += printAutoLampStatus(p);
+    }
+    p += printLoopSchedulerStatistics(p);
+    p += sprintf(p, "\"free_heap\":%lu,", (unsigned long) ESP.getFreeHeap());
+    p += sprintf(p, "\"min_free_heap\":%lu", (unsigned long) ESP.getMinFreeHeap());
     *p++ = '}';
     *p++ = 0;
     httpd_resp_set_type(req, "application/json");
@@ -551,6 +890,225 @@ static esp_err_t info_handler(httpd_req_t *req) {
     return httpd_resp_send(req, json_response, strlen(json_response));
 }
 
+/*
+ * /motion?queue=drive:20,pan:45,dwell:1000,capture submits a new motion queue
+ * /motion?abort=1 stops the queue and the motor
+ * /motion?survey=<step_cm>,<waypoints>,<pan>,<pan>... submits a survey
+ * /motion?still=<n> returns a still captured by the queue, with distance and pan as headers
+ * All except still return the progress of the queue
+ */
+static esp_err_t motion_handler(httpd_req_t *req) {
+    // static, since the stack of the http server task is small
+    static char json_response[160 + (MOTION_MAX_STILLS * 64)];
+    static char tValue[MOTION_QUEUE_MAX_STEPS * 12];
+    // Holds the longest accepted query, so no value can be truncated by httpd_query_key_value()
+    static char tQuery[sizeof("survey=") + sizeof(tValue)];
+
+    sMillisOfLastAction = millis();
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    esp_err_t tQueryResult = httpd_req_get_url_query_str(req, tQuery, sizeof(tQuery));
+    if (tQueryResult == ESP_ERR_HTTPD_RESULT_TRUNC) {
+        // A truncated queue or survey would be executed partially
+        httpd_resp_send_err(req, HTTPD_414_URI_TOO_LONG, "Motion query too long");
+        return ESP_FAIL;
+    }
+    if (tQueryResult == ESP_OK) {
+        if (httpd_query_key_value(tQuery, "still", tValue, sizeof(tValue)) == ESP_OK) {
+            char tFilename[32];
+            int tStillIndex = atoi(tValue);
+            getMotionStillFilename(tFilename, tStillIndex, "jpg");
+            if (!filesystem || tStillIndex < 0 || tStillIndex >= MOTION_MAX_STILLS || !SPIFFS.exists(tFilename)) {
+                return httpd_resp_send_404(req);
+            }
+            File tFile = SPIFFS.open(tFilename, FILE_READ);
+            httpd_resp_set_type(req, "image/jpeg");
+            httpd_resp_set_hdr(req, "Content-Disposition", "inline");
+            // Header values must be valid until the response is sent
+            static char tDistanceString[8];
+            static char tPanString[4];
+            if (MotionStillInfos[tStillIndex].IsValid) {
+                sprintf(tDistanceString, "%d", MotionStillInfos[tStillIndex].DistanceCentimeter);
+                sprintf(tPanString, "%u", MotionStillInfos[tStillIndex].PanDegree);
+                httpd_resp_set_hdr(req, "X-Distance-Cm", tDistanceString);
+                httpd_resp_set_hdr(req, "X-Pan-Degree", tPanString);
+            }
+            static uint8_t tChunk[1024];
+            size_t tLength;
+            while ((tLength = tFile.read(tChunk, sizeof(tChunk))) > 0) {
+                if (httpd_resp_send_chunk(req, (const char*) tChunk, tLength) != ESP_OK) {
+                    tFile.close();
+                    return ESP_FAIL;
+                }
+            }
+            tFile.close();
+            return httpd_resp_send_chunk(req, NULL, 0);
+        }
+        if (httpd_query_key_value(tQuery, "abort", tValue, sizeof(tValue)) == ESP_OK) {
+            abortMotionQueue();
+        } else if (httpd_query_key_value(tQuery, "queue", tValue, sizeof(tValue)) == ESP_OK) {
+            if (submitMotionQueue(tValue) < 0) {
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid motion queue");
+                return ESP_FAIL;
+            }
+        } else if (httpd_query_key_value(tQuery, "survey", tValue, sizeof(tValue)) == ESP_OK) {
+            if (submitSurvey(tValue) < 0) {
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid survey");
+                return ESP_FAIL;
+            }
+        }
+    }
+    printMotionQueueStatus(json_response);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json_response, strlen(json_response));
+}
+
+/*
+ * /calibrate?run=<pwm>[&ms=<ms>] drives forward for a fixed time, default 2000 ms
+ * /calibrate?distance=<mm> enters the measured distance of the last run, if there is no encoder
+ * /calibrate?save=1 stores the points, /calibrate?clear=1 removes all points
+ * Always returns the points and the fitted line as JSON
+ */
+static esp_err_t calibrate_handler(httpd_req_t *req) {
+    static char json_response[128 + (MOTOR_CALIBRATION_MAX_POINTS * 32)];
+    static char tQuery[64];
+    char tValue[8];
+
+    sMillisOfLastAction = millis();
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    bool tSuccess = true;
+    if (httpd_req_get_url_query_str(req, tQuery, sizeof(tQuery)) == ESP_OK) {
+        if (httpd_query_key_value(tQuery, "run", tValue, sizeof(tValue)) == ESP_OK) {
+            uint8_t tSpeedPWM = constrain(atoi(tValue), 0, UINT8_MAX);
+            uint16_t tMillis = MOTOR_CALIBRATION_DEFAULT_MILLIS;
+            if (httpd_query_key_value(tQuery, "ms", tValue, sizeof(tValue)) == ESP_OK) {
+                tMillis = atoi(tValue);
+            }
+            tSuccess = startMotorCalibrationRun(tSpeedPWM, tMillis);
+        } else if (httpd_query_key_value(tQuery, "distance", tValue, sizeof(tValue)) == ESP_OK) {
+            tSuccess = setMotorCalibrationDistance(atoi(tValue));
+        } else if (httpd_query_key_value(tQuery, "save", tValue, sizeof(tValue)) == ESP_OK) {
+            tSuccess = filesystem && saveMotorCalibration(SPIFFS);
+        } else if (httpd_query_key_value(tQuery, "clear", tValue, sizeof(tValue)) == ESP_OK) {
+            clearMotorCalibration();
+        }
+    }
+    if (!tSuccess) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Calibration request not possible now");
+        return ESP_FAIL;
+    }
+    printMotorCalibration(json_response);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json_response, strlen(json_response));
+}
+
+/*
+ * /banding[?exposure=<lines>] takes a test frame with lamp on and short manual exposure and returns the row profile
+ * and the banding score. Compare the score for /control?var=lamp-frequency&val=1000 and val=78125.
+ */
+static esp_err_t banding_handler(httpd_req_t *req) {
+    static char json_response[BANDING_TEST_RESPONSE_SIZE];
+    char tQuery[24];
+    char tValue[8];
+
+    sMillisOfLastAction = millis();
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    uint16_t tExposureLines = BANDING_TEST_DEFAULT_EXPOSURE_LINES;
+    if (httpd_req_get_url_query_str(req, tQuery, sizeof(tQuery)) == ESP_OK
+            && httpd_query_key_value(tQuery, "exposure", tValue, sizeof(tValue)) == ESP_OK) {
+        tExposureLines = constrain(atoi(tValue), 1, 1200);
+    }
+    suspendFailsafe();
+    int tLength = runBandingTest(json_response, tExposureLines);
+    resumeFailsafe();
+    if (tLength < 0) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json_response, tLength);
+}
+
+/*
+ * /rtp[?host=<ip>][&port=<port>] starts the RTP/JPEG stream, default is the requesting client and port 5004
+ * /rtp?stop=1 stops it. Both return the RTP status as JSON.
+ * If the MJPEG stream is running too, each frame goes to only one of them.
+ */
+static esp_err_t rtp_handler(httpd_req_t *req) {
+    static char json_response[320];
+    char tQuery[64];
+    char tValue[16];
+
+    sMillisOfLastAction = millis();
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    // A plain /rtp has no query and starts the stream to the client at the default port
+    bool tHasQuery = httpd_req_get_url_query_str(req, tQuery, sizeof(tQuery)) == ESP_OK;
+    if (tHasQuery && httpd_query_key_value(tQuery, "stop", tValue, sizeof(tValue)) == ESP_OK) {
+        stopRtpStream();
+    } else {
+        uint16_t tPort = RTP_DEFAULT_PORT;
+        if (tHasQuery && httpd_query_key_value(tQuery, "port", tValue, sizeof(tValue)) == ESP_OK) {
+            tPort = atoi(tValue);
+        }
+        uint32_t tDestinationAddress;
+        if (tHasQuery && httpd_query_key_value(tQuery, "host", tValue, sizeof(tValue)) == ESP_OK) {
+            tDestinationAddress = inet_addr(tValue);
+        } else {
+            // The http server uses IPv6 sockets, the IPv4 address of the client is the IPv4 mapped part
+            struct sockaddr_in6 tClientAddress;
+            socklen_t tAddressSize = sizeof(tClientAddress);
+            if (getpeername(httpd_req_to_sockfd(req), (struct sockaddr*) &tClientAddress, &tAddressSize) < 0) {
+                httpd_resp_send_500(req);
+                return ESP_FAIL;
+            }
+            tDestinationAddress = tClientAddress.sin6_addr.un.u32_addr[3];
+        }
+        if (tPort == 0 || tDestinationAddress == IPADDR_NONE || !startRtpStream(tDestinationAddress, tPort)) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "RTP stream not started");
+            return ESP_FAIL;
+        }
+    }
+    char *p = json_response;
+    *p++ = '{';
+    p += printRtpStatus(p);
+    p[-1] = '}'; // replace last comma
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json_response, p - json_response);
+}
+
+/*
+ * Session description of the RTP stream for ffplay, VLC or GStreamer
+ */
+static esp_err_t sdp_handler(httpd_req_t *req) {
+    static char sdp_response[256];
+    char tLocalIP[16];
+
+    sprintf(tLocalIP, "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+    int tLength = printRtpSdp(sdp_response, tLocalIP);
+    httpd_resp_set_type(req, "application/sdp");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    return httpd_resp_send(req, sdp_response, tLength);
+}
+
+/*
+ * /heartbeat[?timeout=<ms>] keeps the link loss failsafe from stopping the motor. timeout=0 disables the failsafe.
+ * No logging here, since it is called every 300 ms by the GUI.
+ */
+static esp_err_t heartbeat_handler(httpd_req_t *req) {
+    char tQuery[24];
+    char tValue[8];
+    int tTimeoutMillis = -1;
+    if (httpd_req_get_url_query_str(req, tQuery, sizeof(tQuery)) == ESP_OK
+            && httpd_query_key_value(tQuery, "timeout", tValue, sizeof(tValue)) == ESP_OK) {
+        tTimeoutMillis = atoi(tValue);
+    }
+    receiveHeartbeat(tTimeoutMillis);
+    char tResponse[32];
+    sprintf(tResponse, "{\"failsafe_timeout_ms\":%u}", HeartbeatTimeoutMillis);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    return httpd_resp_send(req, tResponse, strlen(tResponse));
+}
+
 static esp_err_t favicon_16x16_handler(httpd_req_t *req) {
     httpd_resp_set_type(req, "image/png");
     httpd_resp_set_hdr(req, "Content-Encoding", "identity");
@@ -794,7 +1352,7 @@ static esp_err_t index_handler(httpd_req_t *req) {
 
 void startCameraServer(int hPort, int sPort) {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.max_uri_handlers = 12; // we use more than the default 8 (on port 80)
+    config.max_uri_handlers = 20; // we use more than the default 8 (on port 80)
 
     httpd_uri_t index_uri = { .uri = "/", .method = HTTP_GET, .handler = index_handler, .user_ctx = NULL, .is_websocket = false,
             .handle_ws_control_frames = false, .supported_subprotocol = NULL };
@@ -802,6 +1360,8 @@ void startCameraServer(int hPort, int sPort) {
             false, .handle_ws_control_frames = false, .supported_subprotocol = NULL };
     httpd_uri_t cmd_uri = { .uri = "/control", .method = HTTP_GET, .handler = cmd_handler, .user_ctx = NULL, .is_websocket = false,
             .handle_ws_control_frames = false, .supported_subprotocol = NULL };
+    httpd_uri_t cmd_post_uri = { .uri = "/control", .method = HTTP_POST, .handler = cmd_handler, .user_ctx = NULL, .is_websocket =
+            false, .handle_ws_control_frames = false, .supported_subprotocol = NULL };
     httpd_uri_t capture_uri = { .uri = "/capture", .method = HTTP_GET, .handler = capture_handler, .user_ctx = NULL, .is_websocket =
             false, .handle_ws_control_frames = false, .supported_subprotocol = NULL };
     httpd_uri_t style_uri = { .uri = "/style.css", .method = HTTP_GET, .handler = style_handler, .user_ctx = NULL, .is_websocket =
@@ -822,6 +1382,20 @@ void startCameraServer(int hPort, int sPort) {
             .is_websocket = false, .handle_ws_control_frames = false, .supported_subprotocol = NULL };
     httpd_uri_t fps_info_uri = { .uri = "/fps_info", .method = HTTP_GET, .handler = fps_info_handler, .user_ctx = NULL,
             .is_websocket = false, .handle_ws_control_frames = false, .supported_subprotocol = NULL };
+    httpd_uri_t metrics_uri = { .uri = "/metrics", .method = HTTP_GET, .handler = metrics_handler, .user_ctx = NULL,
+            .is_websocket = false, .handle_ws_control_frames = false, .supported_subprotocol = NULL };
+    httpd_uri_t motion_uri = { .uri = "/motion", .method = HTTP_GET, .handler = motion_handler, .user_ctx = NULL,
+            .is_websocket = false, .handle_ws_control_frames = false, .supported_subprotocol = NULL };
+    httpd_uri_t calibrate_uri = { .uri = "/calibrate", .method = HTTP_GET, .handler = calibrate_handler, .user_ctx = NULL,
+            .is_websocket = false, .handle_ws_control_frames = false, .supported_subprotocol = NULL };
+    httpd_uri_t heartbeat_uri = { .uri = "/heartbeat", .method = HTTP_GET, .handler = heartbeat_handler, .user_ctx = NULL,
+            .is_websocket = false, .handle_ws_control_frames = false, .supported_subprotocol = NULL };
+    httpd_uri_t banding_uri = { .uri = "/banding", .method = HTTP_GET, .handler = banding_handler, .user_ctx = NULL,
+            .is_websocket = false, .handle_ws_control_frames = false, .supported_subprotocol = NULL };
+    httpd_uri_t rtp_uri = { .uri = "/rtp", .method = HTTP_GET, .handler = rtp_handler, .user_ctx = NULL, .is_websocket = false,
+            .handle_ws_control_frames = false, .supported_subprotocol = NULL };
+    httpd_uri_t sdp_uri = { .uri = "/stream.sdp", .method = HTTP_GET, .handler = sdp_handler, .user_ctx = NULL,
+            .is_websocket = false, .handle_ws_control_frames = false, .supported_subprotocol = NULL };
     httpd_uri_t info_uri = { .uri = "/info", .method = HTTP_GET, .handler = info_handler, .user_ctx = NULL, .is_websocket = false,
             .handle_ws_control_frames = false, .supported_subprotocol = NULL };
     httpd_uri_t error_uri = { .uri = "/", .method = HTTP_GET, .handler = error_handler, .user_ctx = NULL, .is_websocket = false,
@@ -839,9 +1413,20 @@ void startCameraServer(int hPort, int sPort) {
         } else {
             httpd_register_uri_handler(camera_httpd, &index_uri);
             httpd_register_uri_handler(camera_httpd, &cmd_uri);
+            httpd_register_uri_handler(camera_httpd, &cmd_post_uri);
             httpd_register_uri_handler(camera_httpd, &status_uri);
             httpd_register_uri_handler(camera_httpd, &fps_info_uri);
             httpd_register_uri_handler(camera_httpd, &capture_uri);
+            httpd_register_uri_handler(camera_httpd, &motion_uri);
+            httpd_register_uri_handler(camera_httpd, &rtp_uri);
+            httpd_register_uri_handler(camera_httpd, &sdp_uri);
+            if (lampBrightnessPercentage != -1) {
+                httpd_register_uri_handler(camera_httpd, &banding_uri);
+            }
+            if (sOnePWMMotorIsSupported) {
+                httpd_register_uri_handler(camera_httpd, &calibrate_uri);
+                httpd_register_uri_handler(camera_httpd, &heartbeat_uri);
+            }
         }
         httpd_register_uri_handler(camera_httpd, &style_uri);
         httpd_register_uri_handler(camera_httpd, &favicon_16x16_uri);
@@ -849,6 +1434,7 @@ void startCameraServer(int hPort, int sPort) {
         httpd_register_uri_handler(camera_httpd, &favicon_ico_uri);
         httpd_register_uri_handler(camera_httpd, &logo_svg_uri);
         httpd_register_uri_handler(camera_httpd, &dump_uri);
+        httpd_register_uri_handler(camera_httpd, &metrics_uri);
     }
 
     config.server_port = sPort;
@@ -22,7 +22,9 @@ extern unsigned long imagesServed;
 extern int myRotation;
 extern int lampBrightnessPercentage;
 extern bool autoLampValue;
+extern int lampPWMFrequency;
 extern int ServoPanDegree;
+extern int ServoTiltDegree;
 extern int LastMotorSpeed;
 extern bool filesystem;
 extern String critERR;
@@ -35,11 +37,40 @@ extern bool otaEnabled;
 extern char otaPassword[];
 
 extern const bool sPanServoIsSupported;
+extern const bool sTiltServoIsSupported;
 extern const bool sOnePWMMotorIsSupported;
+extern const bool sEncoderIsSupported;
+extern const bool sBatteryMonitorIsSupported;
+extern const bool sMotionEstimatorIsSupported;
 extern int sNumberOfFramebuffer;
 
+/*
+ * Milliseconds since boot at the end of each boot stage, 0 if stage not (yet) completed
+ */
+struct BootTimingStruct {
+    unsigned long CameraReadyMillis;
+    unsigned long FilesystemReadyMillis;
+    unsigned long PreferencesLoadedMillis;
+    unsigned long WifiReadyMillis;
+    unsigned long ServerStartedMillis;
+    unsigned long FirstFrameMillis; // first frame sent by stream or capture handler
+};
+extern BootTimingStruct BootTiming;
+
+struct WifiStatisticsStruct {
+    uint32_t Reconnects;
+    unsigned long LastReconnectMillis;  // time from disconnect to got IP
+    unsigned long MaxReconnectMillis;
+    uint32_t FastConnects;              // connects to cached BSSID without scan
+    uint32_t Scans;
+    uint32_t Roams;
+};
+extern WifiStatisticsStruct WifiStatistics;
+
 
 // Functions from the main .ino
 void flashLED(int flashtime);
 void setLamp(int newVal);
+void updateLamp();
+bool setLampFrequency(int aFrequency);
 void printLocalTime(bool extraData);
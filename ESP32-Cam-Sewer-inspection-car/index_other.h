@@ -62,6 +62,7 @@ const uint8_t streamviewer_html[] = R"=====(<!doctype html>
       <div id="rotate" class="default-action hidden">0</div>
       <div id="cam_name" class="default-action hidden"></div>
       <div id="stream_url" class="default-action hidden"></div>
+      <div id="http_url" class="default-action hidden"></div>
     </div>
     <img id="ESP32-Cam-stream" src="">
   </section>
@@ -70,6 +71,7 @@ const uint8_t streamviewer_html[] = R"=====(<!doctype html>
 document.addEventListener('DOMContentLoaded', function (event) {
   var baseHost = document.location.origin;
   var streamURL = 'Undefined';
+  var httpURL = 'Undefined';
 
   const rotate = document.getElementById('rotate')
   const stream = document.getElementById('ESP32-Cam-stream')
@@ -100,6 +102,8 @@ document.addEventListener('DOMContentLoaded', function (event) {
       } else if(el.id === "stream_url"){
         streamURL = value;
         console.log('Stream URL set to:' + value);
+      } else if(el.id === "http_url"){
+        httpURL = value;
       }
     }
   }
@@ -146,6 +150,14 @@ document.addEventListener('DOMContentLoaded', function (event) {
       ESP32-Cam-stream.msRequestFullscreen();
     }
   }
+
+  // Heartbeat for the link loss failsafe of the car. The viewer is served by the stream server, the heartbeat by the http server.
+  function sendHeartbeat(){
+    if (httpURL !== 'Undefined') {
+      fetch(`${httpURL}heartbeat`).catch(function () {})
+    }
+  }
+  setInterval(sendHeartbeat, 300);
 })
 </script>
 </body>
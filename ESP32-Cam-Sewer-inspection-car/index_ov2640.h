@@ -56,6 +56,12 @@ const uint8_t index_ov2640_html[] = R"=====(<!doctype html>
                 <input type="range" id="pan" min="20" max="160" value="42" class="default-action">
                 <div class="range-max">Right</div>
               </div>
+              <div class="input-group hidden" id="tilt-group">
+                <label id="tilt-label" for="tilt">Tilt</label>
+                <div class="range-min">Down</div>
+                <input type="range" id="tilt" min="0" max="180" value="90" class="default-action">
+                <div class="range-max">Up</div>
+              </div>
               <div class="input-group hidden" id="speed-group">
                 <label id="speed-label" for="motor-speed">Speed</label>
                 <div class="range-min">0</div>
@@ -72,6 +78,13 @@ const uint8_t index_ov2640_html[] = R"=====(<!doctype html>
               <button id="go-forward20" title="Go forward 20 cm" name="move-car" value="20">20</button>
               <button id="move-forward" title="Move forward" name="move-car" value="1000">&gt;</button>
             </div>
+              <div class="input-group hidden" id="profile-group">
+                <label for="profile">Profile</label>
+                <select id="profile" title="Apply all settings of a stored profile">
+                  <option value="" selected="selected">-</option>
+                </select>
+                <button id="save_profile" title="Save current settings as profile">Save</button>
+              </div>
               <div class="input-group" id="framesize-group">
                 <label for="framesize">Resolution</label>
                 <select id="framesize" class="default-action">
@@ -332,6 +345,9 @@ const uint8_t index_ov2640_html[] = R"=====(<!doctype html>
     const backwardGo5Button = document.getElementById('go-backward5')
     const backwardGo20Button = document.getElementById('go-backward20')
     const backwardMoveButton = document.getElementById('move-backward')
+    const profileGroup = document.getElementById('profile-group')
+    const profileSelect = document.getElementById('profile')
+    const saveProfileButton = document.getElementById('save_profile')
 
     const hide = el => {
       el.classList.add('hidden')
@@ -355,6 +371,8 @@ const uint8_t index_ov2640_html[] = R"=====(<!doctype html>
         document.getElementById('lamp-label').innerHTML = "Light " + el.value + "%";
       } else if(el.id === "pan"){
         document.getElementById('pan-label').innerHTML = "Pan " + el.value + "&deg;";
+      } else if(el.id === "tilt"){
+        document.getElementById('tilt-label').innerHTML = "Tilt " + el.value + "&deg;";
       } else if(el.id === "motor-speed"){
         document.getElementById('speed-label').innerHTML = "Speed " + Math.round((el.value * 100) / 255) + "%";
       } else if(el.id === "quality"){
@@ -368,7 +386,7 @@ const uint8_t index_ov2640_html[] = R"=====(<!doctype html>
     if(!updateRemote){
     // Change visibility of elements and set some special values
       if(typeof value != 'undefined') {
-        if(el.id === "pan" || el.id === "motor-speed" || el.id === "lamp"){
+        if(el.id === "pan" || el.id === "tilt" || el.id === "motor-speed" || el.id === "lamp"){
           el.parentElement.classList.remove('hidden') // show hidden element, if value is not undefined, i.e. sent from host
           if(el.id === "motor-speed"){
             show(document.getElementById('move-group')); // enable this group too if we set the speed
@@ -493,6 +511,14 @@ const uint8_t index_ov2640_html[] = R"=====(<!doctype html>
           })
   }
 
+//
+// Heartbeat for the link loss failsafe of the car, which stops the motor if heartbeats are missing for 1 second
+//
+  function sendHeartbeat(){
+    fetch(`${baseHost}/heartbeat`).catch(function () {})
+  }
+  setInterval(sendHeartbeat, 300);
+
 //
 // Start document processing
 // Get status from host and set GUI values accordingly
@@ -506,20 +532,34 @@ const uint8_t index_ov2640_html[] = R"=====(<!doctype html>
       })
 
     // read initial values
-    fetch(`${baseHost}/status`)
-      .then(function (response) {
-        return response.json()
-      })
-      .then(function (state) {
-        document
-          .querySelectorAll('.default-action')
-          .forEach(el => {
-            updateValue(el, state[el.id], false) // set value and show element if hidden
-          })
-        hide(waitSettings);
-        show(settings);
-        show(streamButton);
+    function readStatus () {
+      fetch(`${baseHost}/status`)
+        .then(function (response) {
+          return response.json()
+        })
+        .then(function (state) {
+          document
+            .querySelectorAll('.default-action')
+            .forEach(el => {
+              updateValue(el, state[el.id], false) // set value and show element if hidden
+            })
+          if (typeof state.profiles != 'undefined' && state.profiles.length > 0) {
+            updateProfileList(state.profiles.split(','));
+          }
+          hide(waitSettings);
+          show(settings);
+          show(streamButton);
+        })
+    }
+    readStatus();
+
+    function updateProfileList (aProfileNames) {
+      profileSelect.length = 1; // keep the "-" entry
+      aProfileNames.forEach(name => {
+        profileSelect.add(new Option(name, name));
       })
+      show(profileGroup);
+    }
 
     // Put some helpful text on the 'Still' button
     stillButton.setAttribute("title", `Capture a still image :: ${baseHost}/capture`);
@@ -688,6 +728,28 @@ const uint8_t index_ov2640_html[] = R"=====(<!doctype html>
         })
     }
 
+    // Apply profile and read back the changed settings
+    profileSelect.onchange = () => {
+      if (profileSelect.value !== '') {
+        fetch(`${baseHost}/control?var=profile&val=${profileSelect.value}`)
+          .then(response => {
+            console.log(`Profile ${profileSelect.value} applied, status: ${response.status}`)
+            readStatus();
+          })
+      }
+    }
+
+    saveProfileButton.onclick = () => {
+      let name = prompt("Save current settings as profile", profileSelect.value);
+      if (name) {
+        fetch(`${baseHost}/control?var=save_profile&val=${encodeURIComponent(name)}`)
+          .then(response => {
+            console.log(`Profile ${name} saved, status: ${response.status}`)
+            readStatus();
+          })
+      }
+    }
+
     saveStillButton.setAttribute("title", `Download a still image :: ${baseHost}/capture`);
 
     saveStillButton.onclick = () => {
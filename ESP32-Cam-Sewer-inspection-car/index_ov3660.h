@@ -600,6 +600,14 @@ const uint8_t index_ov3660_html[] = R"=====(<!doctype html>
       }
     }
 
+//
+// Heartbeat for the link loss failsafe of the car, which stops the motor if heartbeats are missing for 1 second
+//
+    function sendHeartbeat(){
+      fetch(`${baseHost}/heartbeat`).catch(function () {})
+    }
+    setInterval(sendHeartbeat, 300);
+
   })
   </script>
 </html>)=====";
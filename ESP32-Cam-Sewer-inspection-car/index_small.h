@@ -60,6 +60,12 @@ const uint8_t index_simple_html[] = R"=====(<!doctype html>
             <input type="range" id="pan" min="20" max="160" value="42" class="default-action">
             <div class="range-max">Right</div>
           </div>
+          <div class="input-group hidden" id="tilt-group">
+            <label id="tilt-label" for="tilt">Tilt</label>
+            <div class="range-min">Down</div>
+            <input type="range" id="tilt" min="0" max="180" value="90" class="default-action">
+            <div class="range-max">Up</div>
+          </div>
           <div class="input-group hidden" id="speed-group">
             <label id="speed-label" for="motor-speed">Speed</label>
             <div class="range-min">0</div>
@@ -182,6 +188,8 @@ document.addEventListener('DOMContentLoaded', function (event) {
       document.getElementById('lamp-label').innerHTML = "Light " + el.value + "%";
     } else if(el.id === "pan"){
       document.getElementById('pan-label').innerHTML = "Pan " + el.value + "&deg;";
+    } else if(el.id === "tilt"){
+      document.getElementById('tilt-label').innerHTML = "Tilt " + el.value + "&deg;";
     } else if(el.id === "motor-speed"){
       document.getElementById('speed-label').innerHTML = "Speed " + Math.round((el.value * 100) / 255) + "%";
     } else if(el.id === "quality"){
@@ -195,7 +203,7 @@ document.addEventListener('DOMContentLoaded', function (event) {
     if(!updateRemote){
     // Change visibility of elements and set some special values
       if(typeof value != 'undefined') {
-        if(el.id === "pan" || el.id === "motor-speed" || el.id === "lamp"){
+        if(el.id === "pan" || el.id === "tilt" || el.id === "motor-speed" || el.id === "lamp"){
           el.parentElement.classList.remove('hidden') // show hidden element, if value is not undefined, i.e. sent from host
           if(el.id === "motor-speed"){
             show(document.getElementById('move-group')); // enable this group too if we set the speed
@@ -300,6 +308,14 @@ document.addEventListener('DOMContentLoaded', function (event) {
           })
   }
 
+//
+// Heartbeat for the link loss failsafe of the car, which stops the motor if heartbeats are missing for 1 second
+//
+  function sendHeartbeat(){
+    fetch(`${baseHost}/heartbeat`).catch(function () {})
+  }
+  setInterval(sendHeartbeat, 300);
+
 //
 // Start document processing
 // Get status from host and set GUI values accordingly
@@ -160,6 +160,9 @@ struct station stationList[] = {{"ssid1", "pass1", true},
 // Define the startup lamp power setting (as a percentage, defaults to 0%)
 // #define LAMP_DEFAULT 0
 
+// Uncomment to start the lamp PWM with 78 kHz instead of 1 kHz, which avoids bands at short exposure times
+// #define LAMP_ANTI_BANDING
+
 // Assume the module used has a SPIFFS/LittleFS partition, and use that for persistent setting storage
 // Uncomment to disable this this, the controls will still be shown in the UI but are inoperative.
 // #define NO_FS
@@ -1,12 +1,13 @@
 #include "esp_camera.h"
-#include "jsonlib.h"
 #include "storage.h"
+#include "JsonScanner.h"
+#include "CameraSettings.h"
 
 // These are defined in the main .ino file
 extern void flashLED(int flashtime);
 extern int myRotation;              // Rotation
 extern int lampBrightnessPercentage;                 // The current Lamp value
-extern int autoLampValue;                // Automatic lamp mode
+extern bool autoLampValue;               // Automatic lamp mode
 
 /*
  * Useful utility when debugging... 
@@ -43,83 +44,85 @@ void listDir(fs::FS &fs, const char * dirname, uint8_t levels){
   }
 }
 
+/*
+ * Reads the whole preferences file in one block into the static buffer and terminates it.
+ * @return number of bytes read, 0 if file does not exist or -1 if file is corrupt
+ */
+static char sPrefsBuffer[PREFERENCES_MAX_SIZE + 1];
+static int readPrefsFile(fs::FS &fs) {
+  if (!fs.exists(PREFERENCES_FILE)) {
+    return 0;
+  }
+  File file = fs.open(PREFERENCES_FILE, FILE_READ);
+  if (!file) {
+    Serial.println("Failed to open preferences file for reading, maybe corrupt");
+    return -1;
+  }
+  size_t size = file.size();
+  if (size > PREFERENCES_MAX_SIZE) {
+    Serial.println("Preferences file size is too large, maybe corrupt");
+    file.close();
+    return -1;
+  }
+  size_t tBytesRead = file.read((uint8_t *) sPrefsBuffer, size);
+  file.close();
+  if (tBytesRead != size) {
+    Serial.println("Preferences file failed to load properly, maybe corrupt");
+    return -1;
+  }
+  sPrefsBuffer[size] = '\0';
+  return size;
+}
+
 void dumpPrefs(fs::FS &fs){
-  if (fs.exists(PREFERENCES_FILE)) {
+  int tSize = readPrefsFile(fs);
+  if (tSize > 0) {
     // Dump contents for debug
-    File file = fs.open(PREFERENCES_FILE, FILE_READ);
-    int countSize = 0;
-    while (file.available() && countSize <= PREFERENCES_MAX_SIZE) {
-        Serial.print(char(file.read()));
-        countSize++;
-    }
-    Serial.println("");
-    file.close();
-  } else {
+    Serial.println(sPrefsBuffer);
+  } else if (tSize == 0) {
     Serial.printf("%s not found, nothing to dump.\r\n", PREFERENCES_FILE);
   }
 }
 
-void loadPrefs(fs::FS &fs){
-  if (fs.exists(PREFERENCES_FILE)) {
-    // read file into a string
-    String prefs;
-    Serial.printf("Loading preferences from file %s\r\n", PREFERENCES_FILE);
-    File file = fs.open(PREFERENCES_FILE, FILE_READ);
-    if (!file) {
-      Serial.println("Failed to open preferences file for reading, maybe corrupt, removing");
-      removePrefs(SPIFFS);
-      return;
-    }
-    size_t size = file.size();
-    if (size > PREFERENCES_MAX_SIZE) {
-      Serial.println("Preferences file size is too large, maybe corrupt, removing");
-      removePrefs(SPIFFS);
-      return;
-    }
-    while (file.available()) {
-        prefs += char(file.read());
-        if (prefs.length() > size) {
-          // corrupted SPIFFS files can return data beyond their declared size.
-          Serial.println("Preferences file failed to load properly, appears to be corrupt, removing");
-          removePrefs(SPIFFS);
-          return;
-        }
-    }
-    // get sensor reference
-    sensor_t * s = esp_camera_sensor_get();
-    // process all the settings
-    lampBrightnessPercentage = jsonExtract(prefs, "lamp").toInt();
-    autoLampValue = jsonExtract(prefs, "autolamp").toInt();
-    s->set_framesize(s, (framesize_t)jsonExtract(prefs, "framesize").toInt());
-    s->set_quality(s, jsonExtract(prefs, "quality").toInt());
-    s->set_brightness(s, jsonExtract(prefs, "brightness").toInt());
-    s->set_contrast(s, jsonExtract(prefs, "contrast").toInt());
-    s->set_saturation(s, jsonExtract(prefs, "saturation").toInt());
-    s->set_special_effect(s, jsonExtract(prefs, "special_effect").toInt());
-    s->set_wb_mode(s, jsonExtract(prefs, "wb_mode").toInt());
-    s->set_whitebal(s, jsonExtract(prefs, "awb").toInt());
-    s->set_awb_gain(s, jsonExtract(prefs, "awb_gain").toInt());
-    s->set_exposure_ctrl(s, jsonExtract(prefs, "aec").toInt());
-    s->set_aec2(s, jsonExtract(prefs, "aec2").toInt());
-    s->set_ae_level(s, jsonExtract(prefs, "ae_level").toInt());
-    s->set_aec_value(s, jsonExtract(prefs, "aec_value").toInt());
-    s->set_gain_ctrl(s, jsonExtract(prefs, "agc").toInt());
-    s->set_agc_gain(s, jsonExtract(prefs, "agc_gain").toInt());
-    s->set_gainceiling(s, (gainceiling_t)jsonExtract(prefs, "gainceiling").toInt());
-    s->set_bpc(s, jsonExtract(prefs, "bpc").toInt());
-    s->set_wpc(s, jsonExtract(prefs, "wpc").toInt());
-    s->set_raw_gma(s, jsonExtract(prefs, "raw_gma").toInt());
-    s->set_lenc(s, jsonExtract(prefs, "lenc").toInt());
-    s->set_vflip(s, jsonExtract(prefs, "vflip").toInt());
-    s->set_hmirror(s, jsonExtract(prefs, "hmirror").toInt());
-    s->set_dcw(s, jsonExtract(prefs, "dcw").toInt());
-    s->set_colorbar(s, jsonExtract(prefs, "colorbar").toInt());
-    myRotation = jsonExtract(prefs, "rotate").toInt();
-    // close the file
-    file.close();
-    dumpPrefs(SPIFFS);
+/*
+ * Called by the JSON scanner for each key / value pair of the preferences file
+ */
+static void applyPreference(const char *aKey, const char *aValue, void *aContext) {
+  (void) aContext;
+  int tValue = atoi(aValue);
+  int tCameraSettingIndex = findCameraSettingIndex(aKey);
+  if (tCameraSettingIndex >= 0) {
+    queueCameraSetting(tCameraSettingIndex, tValue);
+  } else if (!strcmp(aKey, "lamp")) {
+    lampBrightnessPercentage = tValue;
+  } else if (!strcmp(aKey, "autolamp")) {
+    autoLampValue = tValue;
+  } else if (!strcmp(aKey, "rotate")) {
+    myRotation = tValue;
   } else {
+    Serial.printf("Unknown preference \"%s\" ignored\r\n", aKey);
+  }
+}
+
+void loadPrefs(fs::FS &fs){
+  Serial.printf("Loading preferences from file %s\r\n", PREFERENCES_FILE);
+  int tSize = readPrefsFile(fs);
+  if (tSize < 0) {
+    Serial.println("Removing corrupt preferences file");
+    removePrefs(fs);
+  } else if (tSize == 0) {
     Serial.printf("Preference file %s not found; using system defaults.\r\n", PREFERENCES_FILE);
+  } else {
+    // process all the settings in one pass and write only the changed camera settings
+    int tNumberOfPairs = scanFlatJsonObject(sPrefsBuffer, tSize, applyPreference, NULL);
+    int tNumberOfWrites = flushCameraSettings(esp_camera_sensor_get());
+    Serial.printf("%d camera settings written\r\n", tNumberOfWrites);
+    if (tNumberOfPairs == JSON_SCANNER_ERROR) {
+      Serial.println("Preferences file is not valid JSON, appears to be corrupt, removing");
+      removePrefs(fs);
+    } else {
+      dumpPrefs(fs);
+    }
   }
 }
 
@@ -136,30 +139,7 @@ void savePrefs(fs::FS &fs){
   *p++ = '{';
   p+=sprintf(p, "\"lamp\":%i,", lampBrightnessPercentage);
   p+=sprintf(p, "\"autolamp\":%u,", autoLampValue);
-  p+=sprintf(p, "\"framesize\":%u,", s->status.framesize);
-  p+=sprintf(p, "\"quality\":%u,", s->status.quality);
-  p+=sprintf(p, "\"brightness\":%d,", s->status.brightness);
-  p+=sprintf(p, "\"contrast\":%d,", s->status.contrast);
-  p+=sprintf(p, "\"saturation\":%d,", s->status.saturation);
-  p+=sprintf(p, "\"special_effect\":%u,", s->status.special_effect);
-  p+=sprintf(p, "\"wb_mode\":%u,", s->status.wb_mode);
-  p+=sprintf(p, "\"awb\":%u,", s->status.awb);
-  p+=sprintf(p, "\"awb_gain\":%u,", s->status.awb_gain);
-  p+=sprintf(p, "\"aec\":%u,", s->status.aec);
-  p+=sprintf(p, "\"aec2\":%u,", s->status.aec2);
-  p+=sprintf(p, "\"ae_level\":%d,", s->status.ae_level);
-  p+=sprintf(p, "\"aec_value\":%u,", s->status.aec_value);
-  p+=sprintf(p, "\"agc\":%u,", s->status.agc);
-  p+=sprintf(p, "\"agc_gain\":%u,", s->status.agc_gain);
-  p+=sprintf(p, "\"gainceiling\":%u,", s->status.gainceiling);
-  p+=sprintf(p, "\"bpc\":%u,", s->status.bpc);
-  p+=sprintf(p, "\"wpc\":%u,", s->status.wpc);
-  p+=sprintf(p, "\"raw_gma\":%u,", s->status.raw_gma);
-  p+=sprintf(p, "\"lenc\":%u,", s->status.lenc);
-  p+=sprintf(p, "\"vflip\":%u,", s->status.vflip);
-  p+=sprintf(p, "\"hmirror\":%u,", s->status.hmirror);
-  p+=sprintf(p, "\"dcw\":%u,", s->status.dcw);
-  p+=sprintf(p, "\"colorbar\":%u,", s->status.colorbar);
+  p+=printCameraSettings(p, s);
   p+=sprintf(p, "\"rotate\":\"%d\"", myRotation);
   *p++ = '}';
   *p++ = 0;
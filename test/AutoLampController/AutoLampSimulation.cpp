@@ -0,0 +1,180 @@
+/*
+ * AutoLampSimulation.cpp
+ *
+ *  Host simulation of the exposure controlled auto lamp with a simulated OV2640.
+ *  The sensor chooses the exposure for the brightness of the scene, which is the ambient light plus the lamp,
+ *  and increases the gain only if the exposure reaches the maximum. The scene changes from dark pipe to daylight and back.
+ *  At the end of each phase the lamp must be stable and the exposure within the target band,
+ *  unless the lamp is at its maximum or off. Each sensor register must be read with the sensor lock held.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Arduino.h"
+#include "esp_camera.h"
+#include "CameraSettings.h"
+#include "esp32-cam-webserver.h"
+#include "AutoLampController.h"
+
+#define SCENE_BRIGHTNESS            10000   // exposure lines at 1 x gain times (ambient + lamp percent)
+#define SENSOR_MAX_EXPOSURE_LINES   1248
+#define SENSOR_MAX_GAIN_X16         ((16 + 15) << 4)
+#define PHASE_MILLIS                30000
+#define STABLE_MILLIS               10000   // no adjustment at the end of each phase
+
+unsigned long SimulatedMillis;
+int8_t streamCount = 1;
+int lampBrightnessPercentage = 100;
+bool autoLampValue = true;
+
+struct ScenePhaseStruct {
+    const char *Name;
+    int AmbientPercent;     // ambient light in percent of the full lamp
+    int LampMaxPercent;     // lampBrightnessPercentage of the GUI
+};
+static const ScenePhaseStruct sPhases[] = { { "dark pipe", 1, 100 }, { "pipe end with daylight", 200, 100 }, { "dark pipe", 1, 100 },
+        { "pipe with some daylight", 30, 100 }, { "dark pipe, lamp limited", 1, 20 } };
+
+static int sLampPercent;
+static int sAmbientPercent;
+static bool sSensorIsLocked;
+static int sNumberOfErrors;
+
+void setLamp(int newVal) {
+    sLampPercent = newVal;
+}
+
+void lockCameraSensor() {
+    sSensorIsLocked = true;
+}
+
+void unlockCameraSensor() {
+    sSensorIsLocked = false;
+}
+
+/*
+ * Auto exposure of the sensor for the current lamp. Exposure first, then gain.
+ */
+static void getSensorExposure(int *aExposureLines, int *aGainX16) {
+    int tExposureLinesAt1x = SCENE_BRIGHTNESS / (sAmbientPercent + sLampPercent);
+    *aExposureLines = tExposureLinesAt1x;
+    *aGainX16 = 16;
+    if (tExposureLinesAt1x > SENSOR_MAX_EXPOSURE_LINES) {
+        *aExposureLines = SENSOR_MAX_EXPOSURE_LINES;
+        *aGainX16 = (tExposureLinesAt1x * 16) / SENSOR_MAX_EXPOSURE_LINES;
+        if (*aGainX16 > SENSOR_MAX_GAIN_X16) {
+            *aGainX16 = SENSOR_MAX_GAIN_X16;
+        }
+    }
+}
+
+/*
+ * OV2640 registers, bit 8 of the register number selects the sensor bank
+ */
+static int getSimulatedRegister(sensor_t *sensor, int reg, int mask) {
+    (void) sensor;
+    if (!sSensorIsLocked) {
+        printf("FAILED register 0x%X read without sensor lock\n", reg);
+        sNumberOfErrors++;
+    }
+    int tExposureLines, tGainX16;
+    getSensorExposure(&tExposureLines, &tGainX16);
+    int tValue = 0;
+    if (reg == 0x145) {
+        tValue = tExposureLines >> 10;
+    } else if (reg == 0x110) {
+        tValue = tExposureLines >> 2;
+    } else if (reg == 0x104) {
+        tValue = tExposureLines;
+    } else if (reg == 0x100) {
+        // Each of the upper 4 bits doubles the gain, the lower 4 bits add 1/16
+        int tDoublings = 0;
+        while (tGainX16 >= 32 && tDoublings < 4) {
+            tGainX16 >>= 1;
+            tDoublings++;
+        }
+        tValue = (((1 << tDoublings) - 1) << 4) | (tGainX16 - 16);
+    }
+    return tValue & mask;
+}
+
+static sensor_t sSensor = { { 0x7F, 0xA2, OV2640_PID, 0 }, getSimulatedRegister };
+
+sensor_t* esp_camera_sensor_get() {
+    return &sSensor;
+}
+
+int main() {
+    setLamp(lampBrightnessPercentage); // by the stream handler
+    uint64_t tFullLampPercentMillis = 0; // the lamp without controller
+    for (unsigned int tPhase = 0; tPhase < sizeof(sPhases) / sizeof(sPhases[0]); ++tPhase) {
+        const ScenePhaseStruct *tScene = &sPhases[tPhase];
+        sAmbientPercent = tScene->AmbientPercent;
+        if (lampBrightnessPercentage != tScene->LampMaxPercent) {
+            // Like updateLamp()
+            lampBrightnessPercentage = tScene->LampMaxPercent;
+            setLamp(lampBrightnessPercentage);
+            restartAutoLamp();
+        }
+        unsigned long tPhaseStartMillis = SimulatedMillis;
+        unsigned long tMillisOfLastAdjustment = SimulatedMillis;
+        while (SimulatedMillis - tPhaseStartMillis < PHASE_MILLIS) {
+            int tOldLampPercent = sLampPercent;
+            uint32_t tMillis = autoLampLoopTask();
+            SimulatedMillis += tMillis;
+            tFullLampPercentMillis += (uint64_t) lampBrightnessPercentage * tMillis;
+            if (sLampPercent != tOldLampPercent) {
+                tMillisOfLastAdjustment = SimulatedMillis;
+            }
+            if (sLampPercent > lampBrightnessPercentage || sLampPercent < 0) {
+                printf("FAILED %s: lamp %d %% is outside 0 to %d %%\n", tScene->Name, sLampPercent, lampBrightnessPercentage);
+                sNumberOfErrors++;
+            }
+        }
+        int tExposureLines, tGainX16;
+        getSensorExposure(&tExposureLines, &tGainX16);
+        printf("%-24s lamp %3d %%, exposure %4d lines, gain %3d/16, settled after %5.1f s\n", tScene->Name, sLampPercent,
+                tExposureLines, tGainX16, (tMillisOfLastAdjustment - tPhaseStartMillis) / 1000.0);
+
+        bool tLampIsAtMaximum = sLampPercent == lampBrightnessPercentage;
+        if (SimulatedMillis - tMillisOfLastAdjustment < STABLE_MILLIS) {
+            printf("FAILED %s: lamp is not stable\n", tScene->Name);
+            sNumberOfErrors++;
+        }
+        if (!tLampIsAtMaximum && (tExposureLines > AutoLampExposureTargetLines || tGainX16 > AUTO_LAMP_GAIN_LIMIT_X16)) {
+            printf("FAILED %s: exposure is above target, but lamp is not at maximum\n", tScene->Name);
+            sNumberOfErrors++;
+        }
+        if (sLampPercent > 0 && tGainX16 <= 16
+                && tExposureLines < (AutoLampExposureTargetLines * AUTO_LAMP_DECREASE_EXPOSURE_PERCENT) / 100) {
+            printf("FAILED %s: exposure is below the target band, but lamp is not off\n", tScene->Name);
+            sNumberOfErrors++;
+        }
+    }
+    printf("Average lamp %llu %% instead of %llu %% with the fully on lamp, %lu adjustments\n",
+            (unsigned long long) (AutoLampStatus.LampPercentMillis / AutoLampStatus.ActiveMillis),
+            (unsigned long long) (tFullLampPercentMillis / SimulatedMillis), (unsigned long) AutoLampStatus.Adjustments);
+    if (sNumberOfErrors > 0) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,31 @@
+/*
+ * CameraSettings.h
+ *
+ *  The sensor lock of CameraSettings.cpp. The simulation checks, that each register is read with the lock held.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _SIMULATED_CAMERA_SETTINGS_H
+#define _SIMULATED_CAMERA_SETTINGS_H
+
+void lockCameraSensor();
+void unlockCameraSensor();
+
+#endif // _SIMULATED_CAMERA_SETTINGS_H
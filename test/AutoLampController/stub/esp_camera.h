@@ -0,0 +1,48 @@
+/*
+ * esp_camera.h
+ *
+ *  The sensor API of esp32-camera, which is used by AutoLampController.cpp. The simulated sensor is in AutoLampSimulation.cpp.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _SIMULATED_ESP_CAMERA_H
+#define _SIMULATED_ESP_CAMERA_H
+
+#include <stdint.h>
+
+#define OV2640_PID  0x26
+#define OV3660_PID  0x3660
+
+typedef struct {
+    uint8_t MIDH;
+    uint8_t MIDL;
+    uint16_t PID;
+    uint8_t VER;
+} sensor_id_t;
+
+typedef struct _sensor sensor_t;
+struct _sensor {
+    sensor_id_t id;
+    int (*get_reg)(sensor_t *sensor, int reg, int mask);
+};
+
+sensor_t* esp_camera_sensor_get();
+
+#endif // _SIMULATED_ESP_CAMERA_H
@@ -0,0 +1,105 @@
+/*
+ * ESP32ServoBenchmark.cpp
+ *
+ *  Host benchmark of one servo write and read back, Servo::writeMicroseconds() and readMicroseconds(),
+ *  against the same sequence with the former double conversions.
+ *  The host has a double FPU, so both take about the same time here. The ESP32 has only a single precision FPU
+ *  and calls the software double functions of libgcc for each of the 4 conversions, which this benchmark can not show.
+ *  It checks, that both sequences give the same ticks and microseconds.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include <ESP32Servo.h>
+#include "ServoReference.h"
+
+uint32_t HostLedcFrequency[HOST_LEDC_CHANNELS];
+uint32_t HostLedcDuty[HOST_LEDC_CHANNELS];
+uint32_t HostLedcNumberOfSetups;
+
+#define TIMER_WIDTH     16
+#define TIMER_WIDTH_TICKS (1 << TIMER_WIDTH)
+#define REFRESH_CPS     50
+
+/*
+ * Former Servo::writeMicroseconds() followed by readMicroseconds()
+ */
+static int referenceWriteAndRead(ESP32PWM &aPwm, int aUsec) {
+    int tTicks = referenceUsToTicks(aUsec, TIMER_WIDTH_TICKS, REFRESH_CPS);
+    if (aPwm.attached()) {
+        if (tTicks < referenceUsToTicks(MIN_PULSE_WIDTH, TIMER_WIDTH_TICKS, REFRESH_CPS)) {
+            tTicks = referenceUsToTicks(MIN_PULSE_WIDTH, TIMER_WIDTH_TICKS, REFRESH_CPS);
+        } else if (tTicks > referenceUsToTicks(MAX_PULSE_WIDTH, TIMER_WIDTH_TICKS, REFRESH_CPS)) {
+            tTicks = referenceUsToTicks(MAX_PULSE_WIDTH, TIMER_WIDTH_TICKS, REFRESH_CPS);
+        }
+        aPwm.write(tTicks);
+    }
+    if (aPwm.attached()) {
+        return referenceTicksToUs(tTicks, TIMER_WIDTH_TICKS, REFRESH_CPS);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    long tIterations = 1000;
+    if (argc > 1) {
+        tIterations = atol(argv[1]);
+    }
+    Servo tServo;
+    tServo.attach(14, MIN_PULSE_WIDTH, MAX_PULSE_WIDTH);
+    tServo.setTimerWidth(TIMER_WIDTH); // attach() sets the default width
+    ESP32PWM tReferencePwm;
+    tReferencePwm.attachPin(15, REFRESH_CPS, TIMER_WIDTH);
+
+    // volatile pulse width, so the compiler can not precompute the conversions
+    volatile int tUsecOffset = 0;
+    long tSumOfMicroseconds = 0;
+    long tReferenceSumOfMicroseconds = 0;
+
+    auto tStart = std::chrono::steady_clock::now();
+    for (long i = 0; i < tIterations; i++) {
+        for (int tUsec = MIN_PULSE_WIDTH - 100; tUsec <= MAX_PULSE_WIDTH + 100; tUsec++) {
+            tServo.writeMicroseconds(tUsec + tUsecOffset);
+            tSumOfMicroseconds += tServo.readMicroseconds();
+        }
+    }
+    auto tIntegerNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - tStart).count();
+
+    tStart = std::chrono::steady_clock::now();
+    for (long i = 0; i < tIterations; i++) {
+        for (int tUsec = MIN_PULSE_WIDTH - 100; tUsec <= MAX_PULSE_WIDTH + 100; tUsec++) {
+            tReferenceSumOfMicroseconds += referenceWriteAndRead(tReferencePwm, tUsec + tUsecOffset);
+        }
+    }
+    auto tDoubleNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - tStart).count();
+
+    long tNumberOfWrites = tIterations * (MAX_PULSE_WIDTH - MIN_PULSE_WIDTH + 201);
+    printf("%ld servo writes and reads\n", tNumberOfWrites);
+    printf("Integer: %.1f ns per write\n", (double) tIntegerNanos / tNumberOfWrites);
+    printf("Double:  %.1f ns per write\n", (double) tDoubleNanos / tNumberOfWrites);
+    if (tSumOfMicroseconds != tReferenceSumOfMicroseconds || tServo.readTicks() != (int) tReferencePwm.read()) {
+        printf("FAILED different results %ld %ld\n", tSumOfMicroseconds, tReferenceSumOfMicroseconds);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
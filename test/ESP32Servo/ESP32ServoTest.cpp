@@ -0,0 +1,141 @@
+/*
+ * ESP32ServoTest.cpp
+ *
+ *  Host test of the integer computations of ESP32Servo and ESP32PWM against the former double code.
+ *  Servo: all pulse widths from 0 to 4000 us and all ticks for timer widths from 10 to 20 bit and refresh rates from 50 to 400 Hz.
+ *  ESP32PWM: writeScaled() and getDutyScaled() for all resolutions and a frequency change keeping the raw duty.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <ESP32Servo.h>
+#include "ServoReference.h"
+
+uint32_t HostLedcFrequency[HOST_LEDC_CHANNELS];
+uint32_t HostLedcDuty[HOST_LEDC_CHANNELS];
+uint32_t HostLedcNumberOfSetups;
+
+#define MIN_TEST_USEC   0
+#define MAX_TEST_USEC   4000
+static const int sRefreshRates[] = { 50, 60, 100, 150, 200, 250, 300, 333, 400 };
+
+static int sNumberOfErrors = 0;
+static long sNumberOfChecks = 0;
+
+static void check(bool aCondition, const char *aWhat, long aValue1, long aValue2, long aValue3) {
+    sNumberOfChecks++;
+    if (!aCondition) {
+        if (sNumberOfErrors < 20) {
+            printf("FAILED %s %ld %ld %ld\n", aWhat, aValue1, aValue2, aValue3);
+        }
+        sNumberOfErrors++;
+    }
+}
+
+/*
+ * writeMicroseconds() clips the ticks to the ticks of min and max, readMicroseconds() converts them back
+ */
+static void testServo(Servo &aServo, int aChannel, int aTimerWidth, int aRefreshCps) {
+    aServo.setPeriodHertz(aRefreshCps);
+    aServo.setTimerWidth(aTimerWidth);
+    int tTimerWidthTicks = 1 << aTimerWidth;
+    int tMinTicks = referenceUsToTicks(MIN_PULSE_WIDTH, tTimerWidthTicks, aRefreshCps);
+    int tMaxTicks = referenceUsToTicks(MAX_PULSE_WIDTH, tTimerWidthTicks, aRefreshCps);
+
+    for (int tUsec = MIN_TEST_USEC; tUsec <= MAX_TEST_USEC; tUsec++) {
+        aServo.writeMicroseconds(tUsec);
+        int tTicks = referenceUsToTicks(tUsec, tTimerWidthTicks, aRefreshCps);
+        if (tTicks < tMinTicks) {
+            tTicks = tMinTicks;
+        } else if (tTicks > tMaxTicks) {
+            tTicks = tMaxTicks;
+        }
+        check(aServo.readTicks() == tTicks, "usToTicks width, Hz, usec", aTimerWidth, aRefreshCps, tUsec);
+        check(HostLedcDuty[aChannel] == (uint32_t) tTicks, "PWM duty width, Hz, usec", aTimerWidth, aRefreshCps, tUsec);
+    }
+    for (int tTicks = tMinTicks; tTicks <= tMaxTicks; tTicks++) {
+        aServo.writeTicks(tTicks);
+        check(aServo.readMicroseconds() == referenceTicksToUs(tTicks, tTimerWidthTicks, aRefreshCps), "ticksToUs width, Hz, ticks",
+                aTimerWidth, aRefreshCps, tTicks);
+    }
+}
+
+static void testDutyScaled(ESP32PWM &aPwm) {
+    for (uint8_t tBits = 1; tBits <= 16; tBits++) {
+        aPwm.attachPin(12, 1000, tBits);
+        uint32_t tMaxDuty = (1 << tBits) - 1;
+        // all duties including above the maximum
+        for (uint32_t tDuty = 0; tDuty <= tMaxDuty + 2; tDuty++) {
+            aPwm.write(tDuty);
+            check(aPwm.getDutyScaled() == referenceMapf(tDuty, 0.0, tMaxDuty, 0.0, 1.0), "getDutyScaled bits, duty", tBits, tDuty, 0);
+        }
+        // all scaled duties of the grid and random ones, including below 0 and above 1
+        for (long i = -2; i <= (long) tMaxDuty + 2; i++) {
+            double tScaled = (double) i / tMaxDuty;
+            aPwm.writeScaled(tScaled);
+            check(aPwm.read() == (uint32_t) referenceMapf(tScaled, 0.0, 1.0, 0.0, tMaxDuty), "writeScaled grid bits, i", tBits, i, 0);
+            tScaled = (double) rand() / RAND_MAX * 1.2 - 0.1;
+            aPwm.writeScaled(tScaled);
+            check(aPwm.read() == (uint32_t) referenceMapf(tScaled, 0.0, 1.0, 0.0, tMaxDuty), "writeScaled random bits, i", tBits, i,
+                    aPwm.read());
+        }
+        aPwm.detachPin(12);
+    }
+}
+
+/*
+ * The frequency change must keep the raw duty. The former conversion to scaled duty and back lost up to one LSB.
+ */
+static void testAdjustFrequency(ESP32PWM &aPwm) {
+    aPwm.attachPin(13, 1000, 16);
+    int tChannel = aPwm.getChannel();
+    for (uint32_t tDuty = 0; tDuty <= 0xFFFF; tDuty++) {
+        aPwm.write(tDuty);
+        long tFrequency = 1000 + (tDuty % 2) * 1000;
+        aPwm.adjustFrequency(tFrequency);
+        check(HostLedcFrequency[tChannel] == tFrequency, "adjustFrequency frequency duty, Hz", tDuty, HostLedcFrequency[tChannel], 0);
+        check(aPwm.readFreq() == tFrequency, "readFreq duty, Hz", tDuty, aPwm.readFreq(), 0);
+        check(HostLedcDuty[tChannel] == tDuty, "adjustFrequency duty", tDuty, HostLedcDuty[tChannel], 0);
+    }
+    aPwm.adjustFrequency(5000, 0.25);
+    check(aPwm.read() == 0xFFFF / 4 && HostLedcFrequency[tChannel] == 5000, "adjustFrequency with duty duty, Hz", aPwm.read(),
+            HostLedcFrequency[tChannel], 0);
+    aPwm.detachPin(13);
+}
+
+int main() {
+    Servo tServo;
+    int tChannel = tServo.attach(14, MIN_PULSE_WIDTH, MAX_PULSE_WIDTH);
+    for (unsigned int i = 0; i < sizeof(sRefreshRates) / sizeof(sRefreshRates[0]); i++) {
+        for (int tTimerWidth = MINIMUM_TIMER_WIDTH; tTimerWidth <= MAXIMUM_TIMER_WIDTH; tTimerWidth++) {
+            testServo(tServo, tChannel, tTimerWidth, sRefreshRates[i]);
+        }
+    }
+
+    ESP32PWM tScaledPwm;
+    testDutyScaled(tScaledPwm);
+    ESP32PWM tVariablePwm;
+    testAdjustFrequency(tVariablePwm);
+
+    printf("%ld checks, %d errors\n", sNumberOfChecks, sNumberOfErrors);
+    return sNumberOfErrors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
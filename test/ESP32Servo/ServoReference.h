@@ -0,0 +1,47 @@
+/*
+ * ServoReference.h
+ *
+ *  The former double computations of ESP32Servo and ESP32PWM, which the integer versions must reproduce bit by bit.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _SERVO_REFERENCE_H
+#define _SERVO_REFERENCE_H
+
+#include <ESP32Servo.h>
+
+inline int referenceUsToTicks(int aUsec, int aTimerWidthTicks, int aRefreshCps) {
+    return (int) ((double) aUsec / ((double) REFRESH_USEC / (double) aTimerWidthTicks) * (((double) aRefreshCps) / 50.0));
+}
+
+inline int referenceTicksToUs(int aTicks, int aTimerWidthTicks, int aRefreshCps) {
+    return (int) ((double) aTicks * ((double) REFRESH_USEC / (double) aTimerWidthTicks) / (((double) aRefreshCps) / 50.0));
+}
+
+// ESP32PWM::mapf()
+inline double referenceMapf(double x, double in_min, double in_max, double out_min, double out_max) {
+    if (x > in_max)
+        return out_max;
+    if (x < in_min)
+        return out_min;
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+#endif // _SERVO_REFERENCE_H
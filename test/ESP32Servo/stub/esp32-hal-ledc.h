@@ -0,0 +1,60 @@
+/*
+ * esp32-hal-ledc.h
+ *
+ *  LEDC API of the ESP32 core 2.x for the host. The stub stores the last setup and duty of each channel,
+ *  so the tests can check what was written to the hardware.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _HOST_ESP32_HAL_LEDC_H
+#define _HOST_ESP32_HAL_LEDC_H
+
+#include "Arduino.h"
+
+typedef enum {
+    NOTE_C, NOTE_Cs, NOTE_D, NOTE_Eb, NOTE_E, NOTE_F, NOTE_Fs, NOTE_G, NOTE_Gs, NOTE_A, NOTE_Bb, NOTE_B, NOTE_MAX
+} note_t;
+
+#define HOST_LEDC_CHANNELS 16
+extern uint32_t HostLedcFrequency[HOST_LEDC_CHANNELS];
+extern uint32_t HostLedcDuty[HOST_LEDC_CHANNELS];
+extern uint32_t HostLedcNumberOfSetups;
+
+inline uint32_t ledcSetup(uint8_t channel, uint32_t freq, uint8_t resolution_bits) {
+    (void) resolution_bits;
+    HostLedcFrequency[channel] = freq;
+    HostLedcNumberOfSetups++;
+    return freq;
+}
+inline void ledcWrite(uint8_t channel, uint32_t duty) {
+    HostLedcDuty[channel] = duty;
+}
+inline uint32_t ledcRead(uint8_t channel) {
+    return HostLedcDuty[channel];
+}
+inline void ledcAttachPin(uint8_t pin, uint8_t channel) {
+    (void) pin;
+    (void) channel;
+}
+inline void ledcDetachPin(uint8_t pin) {
+    (void) pin;
+}
+
+#endif // _HOST_ESP32_HAL_LEDC_H
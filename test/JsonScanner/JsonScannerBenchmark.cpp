@@ -0,0 +1,115 @@
+/*
+ * JsonScannerBenchmark.cpp
+ *
+ *  Host benchmark of loading the preferences file. Compares the single pass scanner with the former
+ *  one lookup per key, which rescans the document for each of the 27 keys like jsonExtract() of jsonlib.
+ *  Absolute times are for the host, the ratio is what counts for the ESP32.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+
+#include "JsonScanner.h"
+
+static const char sPreferences[] =
+        "{\"lamp\":-1,\"autolamp\":0,\"framesize\":9,\"quality\":12,\"brightness\":0,\"contrast\":0,\"saturation\":0,"
+                "\"special_effect\":0,\"wb_mode\":0,\"awb\":1,\"awb_gain\":1,\"aec\":1,\"aec2\":0,\"ae_level\":0,"
+                "\"aec_value\":204,\"agc\":1,\"agc_gain\":0,\"gainceiling\":0,\"bpc\":0,\"wpc\":1,\"raw_gma\":1,"
+                "\"lenc\":1,\"vflip\":0,\"hmirror\":0,\"dcw\":1,\"colorbar\":0,\"rotate\":\"0\"}";
+
+/*
+ * Sequence of the former loadPrefs()
+ */
+static const char *const sKeys[] = { "lamp", "autolamp", "framesize", "quality", "brightness", "contrast", "saturation",
+        "special_effect", "wb_mode", "awb", "awb_gain", "aec", "aec2", "ae_level", "aec_value", "agc", "agc_gain", "gainceiling",
+        "bpc", "wpc", "raw_gma", "lenc", "vflip", "hmirror", "dcw", "colorbar", "rotate" };
+#define NUMBER_OF_KEYS (sizeof(sKeys) / sizeof(sKeys[0]))
+
+/*
+ * Same algorithm as jsonExtract() of jsonlib: search the quoted key from the start, then copy the value to a new string
+ */
+static std::string jsonExtract(const std::string &aJson, const std::string &aKey) {
+    size_t tIndex = aJson.find("\"" + aKey + "\"");
+    if (tIndex == std::string::npos) {
+        return "";
+    }
+    tIndex = aJson.find(':', tIndex + aKey.length() + 2);
+    if (tIndex == std::string::npos) {
+        return "";
+    }
+    tIndex++;
+    if (aJson[tIndex] == '"') {
+        size_t tEnd = aJson.find('"', tIndex + 1);
+        return aJson.substr(tIndex + 1, tEnd - tIndex - 1);
+    }
+    size_t tEnd = aJson.find_first_of(",}", tIndex);
+    return aJson.substr(tIndex, tEnd - tIndex);
+}
+
+static long sSumPerKey;
+static long sSumScanner;
+
+static void sumValue(const char *aKey, const char *aValue, void *aContext) {
+    (void) aKey;
+    *(long*) aContext += atoi(aValue);
+}
+
+int main(int argc, char *argv[]) {
+    long tIterations = 100000;
+    if (argc > 1) {
+        tIterations = atol(argv[1]);
+    }
+    std::string tPreferences(sPreferences);
+    auto tStart = std::chrono::steady_clock::now();
+    for (long i = 0; i < tIterations; ++i) {
+        for (size_t k = 0; k < NUMBER_OF_KEYS; ++k) {
+            sSumPerKey += atoi(jsonExtract(tPreferences, sKeys[k]).c_str());
+        }
+    }
+    auto tPerKeyNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - tStart).count();
+
+    static char tBuffer[sizeof(sPreferences)];
+    tStart = std::chrono::steady_clock::now();
+    for (long i = 0; i < tIterations; ++i) {
+        // The scanner modifies the buffer, like after reading the file
+        memcpy(tBuffer, sPreferences, sizeof(sPreferences));
+        if (scanFlatJsonObject(tBuffer, sizeof(sPreferences), sumValue, &sSumScanner) != NUMBER_OF_KEYS) {
+            printf("Scanner failed\n");
+            return EXIT_FAILURE;
+        }
+    }
+    auto tScannerNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - tStart).count();
+
+    printf("Preferences file of %zu bytes with %zu keys, %ld iterations\n", strlen(sPreferences), NUMBER_OF_KEYS, tIterations);
+    printf("Lookup per key:   %8.0f ns per file\n", (double) tPerKeyNanos / tIterations);
+    printf("Single pass scan: %8.0f ns per file\n", (double) tScannerNanos / tIterations);
+    if (tScannerNanos > 0) {
+        printf("Speedup: %.1f\n", (double) tPerKeyNanos / tScannerNanos);
+    }
+    if (sSumPerKey != sSumScanner) {
+        printf("Values differ: %ld != %ld\n", sSumPerKey, sSumScanner);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
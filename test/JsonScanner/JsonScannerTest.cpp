@@ -0,0 +1,222 @@
+/*
+ * JsonScannerTest.cpp
+ *
+ *  Host test of the JSON scanner. Checks valid and malformed files and fuzzes the scanner
+ *  with random mutations of a preferences file. Each input is copied to a buffer of exactly its length
+ *  followed by guard bytes, so reading or writing beyond aLength is detected, also without sanitizer.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "JsonScanner.h"
+
+#define GUARD_SIZE      16
+#define GUARD_VALUE     0xA5
+#define MAX_TEST_LENGTH 1024
+#define FUZZ_ITERATIONS 200000
+
+/*
+ * Written by savePrefs()
+ */
+static const char sPreferences[] =
+        "{\"lamp\":-1,\"autolamp\":0,\"framesize\":9,\"quality\":12,\"brightness\":0,\"contrast\":0,\"saturation\":0,"
+                "\"special_effect\":0,\"wb_mode\":0,\"awb\":1,\"awb_gain\":1,\"aec\":1,\"aec2\":0,\"ae_level\":0,"
+                "\"aec_value\":204,\"agc\":1,\"agc_gain\":0,\"gainceiling\":0,\"bpc\":0,\"wpc\":1,\"raw_gma\":1,"
+                "\"lenc\":1,\"vflip\":0,\"hmirror\":0,\"dcw\":1,\"colorbar\":0,\"rotate\":\"0\"}";
+#define PREFERENCES_NUMBER_OF_PAIRS 27
+
+struct ValidTestStruct {
+    const char *Json;
+    int ExpectedPairs;
+    const char *ExpectedConcatenation; // key=value; for all pairs
+};
+
+static const ValidTestStruct sValidTests[] = {
+{ "{}", 0, "" },
+{ " \r\n{ }\n", 0, "" },
+{ "{\"a\":1}", 1, "a=1;" },
+{ "{ \"a\" : 1 , \"b\" : \"x y\" }", 2, "a=1;b=x y;" },
+{ "{\"neg\":-12,\"exp\":1.5E+3,\"t\":true,\"n\":null}", 4, "neg=-12;exp=1.5E+3;t=true;n=null;" },
+{ "{\"s\":\"a\\\"b\",\"e\":\"\"}", 2, "s=a\\\"b;e=;" },
+{ "{\"profile\":\"pipe-dark\"}\n", 1, "profile=pipe-dark;" } };
+
+static const char *const sInvalidTests[] = { "", " ", "[]", "{", "}", "{\"a\"}", "{\"a\":}", "{\"a\":1", "{\"a\":1,}",
+        "{\"a\":1 2}", "{\"a\":1}x", "{\"a\":{\"b\":1}}", "{\"a\":[1]}", "{a:1}", "{\"a\":\"x}", "{\"a\n\":1}", "{\"a\":1;\"b\":2}",
+        "{\"a\":\"x\" \"y\"}", "{\"a\":1}}" };
+
+/*
+ * Buffer of exact length followed by guard bytes
+ */
+static uint8_t sBuffer[MAX_TEST_LENGTH + GUARD_SIZE];
+static size_t sLength;
+static int sNumberOfHandlerCalls;
+static char sConcatenation[MAX_TEST_LENGTH * 2];
+static int sNumberOfErrors;
+
+static void collectPair(const char *aKey, const char *aValue, void *aContext) {
+    (void) aContext;
+    const char *tBufferEnd = (const char*) sBuffer + sLength;
+    if (aKey < (const char*) sBuffer || aKey >= tBufferEnd || aValue < (const char*) sBuffer || aValue >= tBufferEnd) {
+        printf("Key or value pointer outside of buffer\n");
+        sNumberOfErrors++;
+        return;
+    }
+    sNumberOfHandlerCalls++;
+    size_t tLength = strlen(sConcatenation);
+    if (tLength + strlen(aKey) + strlen(aValue) + 3 < sizeof(sConcatenation)) {
+        sprintf(&sConcatenation[tLength], "%s=%s;", aKey, aValue);
+    }
+}
+
+/*
+ * @return result of scanner, or a value < JSON_SCANNER_ERROR if the scanner violated its contract
+ */
+static int scan(const uint8_t *aJson, size_t aLength) {
+    memcpy(sBuffer, aJson, aLength);
+    memset(&sBuffer[aLength], GUARD_VALUE, GUARD_SIZE);
+    sLength = aLength;
+    sNumberOfHandlerCalls = 0;
+    sConcatenation[0] = '\0';
+    int tResult = scanFlatJsonObject((char*) sBuffer, aLength, collectPair, NULL);
+    for (int i = 0; i < GUARD_SIZE; ++i) {
+        if (sBuffer[aLength + i] != GUARD_VALUE) {
+            printf("Guard byte %d after buffer of length %zu overwritten\n", i, aLength);
+            sNumberOfErrors++;
+        }
+    }
+    if (tResult != JSON_SCANNER_ERROR && (tResult < 0 || tResult != sNumberOfHandlerCalls)) {
+        printf("Result %d does not match %d handler calls\n", tResult, sNumberOfHandlerCalls);
+        sNumberOfErrors++;
+    }
+    if (tResult == JSON_SCANNER_ERROR && sNumberOfHandlerCalls > (int) aLength / 4) {
+        printf("Too many handler calls before error\n");
+        sNumberOfErrors++;
+    }
+    return tResult;
+}
+
+static void testValidInput() {
+    for (size_t i = 0; i < sizeof(sValidTests) / sizeof(sValidTests[0]); ++i) {
+        int tResult = scan((const uint8_t*) sValidTests[i].Json, strlen(sValidTests[i].Json));
+        if (tResult != sValidTests[i].ExpectedPairs || strcmp(sConcatenation, sValidTests[i].ExpectedConcatenation) != 0) {
+            printf("Valid input %s: result=%d pairs=%s\n", sValidTests[i].Json, tResult, sConcatenation);
+            sNumberOfErrors++;
+        }
+    }
+    // With string terminator as written by a C string and without
+    if (scan((const uint8_t*) sPreferences, sizeof(sPreferences)) != PREFERENCES_NUMBER_OF_PAIRS
+            || scan((const uint8_t*) sPreferences, strlen(sPreferences)) != PREFERENCES_NUMBER_OF_PAIRS) {
+        printf("Preferences file not scanned\n");
+        sNumberOfErrors++;
+    }
+    if (strncmp(sConcatenation, "lamp=-1;autolamp=0;framesize=9;", 31) != 0 || strstr(sConcatenation, "rotate=0;") == NULL) {
+        printf("Preferences pairs wrong: %s\n", sConcatenation);
+        sNumberOfErrors++;
+    }
+}
+
+static void testInvalidInput() {
+    for (size_t i = 0; i < sizeof(sInvalidTests) / sizeof(sInvalidTests[0]); ++i) {
+        int tResult = scan((const uint8_t*) sInvalidTests[i], strlen(sInvalidTests[i]));
+        if (tResult != JSON_SCANNER_ERROR) {
+            printf("Invalid input %s: result=%d\n", sInvalidTests[i], tResult);
+            sNumberOfErrors++;
+        }
+    }
+    // Every truncation of the preferences file is an error
+    for (size_t tLength = 0; tLength < strlen(sPreferences); ++tLength) {
+        if (scan((const uint8_t*) sPreferences, tLength) != JSON_SCANNER_ERROR) {
+            printf("Truncated preferences of length %zu accepted\n", tLength);
+            sNumberOfErrors++;
+        }
+    }
+}
+
+/*
+ * Deterministic, so a failure can be reproduced
+ */
+static uint32_t sRandomState = 2463534242UL;
+static uint32_t getRandom() {
+    sRandomState ^= sRandomState << 13;
+    sRandomState ^= sRandomState >> 17;
+    sRandomState ^= sRandomState << 5;
+    return sRandomState;
+}
+
+/*
+ * Flips, inserts and deletes random bytes, preferring the JSON syntax characters
+ */
+static void fuzzPreferences() {
+    static const char sSyntaxChars[] = "{}[]\":, \t\n\\-0e";
+    uint8_t tInput[MAX_TEST_LENGTH];
+    int tNumberOfAccepted = 0;
+    for (uint32_t tIteration = 0; tIteration < FUZZ_ITERATIONS; ++tIteration) {
+        size_t tLength = strlen(sPreferences);
+        memcpy(tInput, sPreferences, tLength);
+        int tNumberOfMutations = 1 + getRandom() % 4;
+        for (int i = 0; i < tNumberOfMutations && tLength > 0; ++i) {
+            size_t tPosition = getRandom() % tLength;
+            uint8_t tChar = (getRandom() & 1) ? getRandom() : sSyntaxChars[getRandom() % (sizeof(sSyntaxChars) - 1)];
+            switch (getRandom() % 4) {
+            case 0: // replace
+                tInput[tPosition] = tChar;
+                break;
+            case 1: // insert
+                if (tLength < MAX_TEST_LENGTH) {
+                    memmove(&tInput[tPosition + 1], &tInput[tPosition], tLength - tPosition);
+                    tInput[tPosition] = tChar;
+                    tLength++;
+                }
+                break;
+            case 2: // delete
+                memmove(&tInput[tPosition], &tInput[tPosition + 1], tLength - tPosition - 1);
+                tLength--;
+                break;
+            default: // truncate
+                tLength = tPosition;
+                break;
+            }
+        }
+        if (scan(tInput, tLength) >= 0) {
+            tNumberOfAccepted++;
+        }
+        if (sNumberOfErrors > 0) {
+            printf("Fuzz iteration %u failed for input: %.*s\n", tIteration, (int) tLength, tInput);
+            return;
+        }
+    }
+    printf("Fuzzing: %d of %d mutated files accepted\n", tNumberOfAccepted, FUZZ_ITERATIONS);
+}
+
+int main() {
+    testValidInput();
+    testInvalidInput();
+    fuzzPreferences();
+    if (sNumberOfErrors > 0) {
+        printf("%d errors\n", sNumberOfErrors);
+        return EXIT_FAILURE;
+    }
+    printf("All JSON scanner tests passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,249 @@
+/*
+ * LoopSchedulerSimulation.cpp
+ *
+ *  Host simulation of the loop scheduler with a simulated clock.
+ *  Commands arrive at random times and set a deadline, like a move-car command or a motion queue step.
+ *  The deadline lateness and the sleep percentage are taken from the same statistics, which are reported at /metrics,
+ *  and are compared with the former delay(100) polling loop.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Arduino.h"
+#include "LoopScheduler.h"
+
+#define SIMULATION_MILLIS           (10 * 60 * 1000L)
+#define NUMBER_OF_COMMANDS          200
+#define TASK_COST_MICROS            150     // Simulated execution time of one task run
+#define POLLING_DELAY_MILLIS        100     // The former loop
+#define MILLIMETER_PER_SECOND       100     // For converting lateness to overshoot of the car
+
+/*
+ * Simulated clock and task notification
+ */
+uint64_t SimulatedMicros;
+static uint32_t sNotificationCount;
+
+struct CommandStruct {
+    uint64_t ArrivalMicros;
+    uint32_t DurationMillis;
+};
+static CommandStruct sCommands[NUMBER_OF_COMMANDS];
+static int sNextCommandIndex;
+static bool sUseScheduler;
+
+static unsigned long sDeadlineMillis;
+static bool sDeadlineIsActive;
+static unsigned long sMaxDeadlineLatenessMillis;
+static uint32_t sNumberOfDeadlines;
+
+/*
+ * A command sets a new deadline and wakes the scheduler, like startMotorDistanceCentimeter() does
+ */
+static void processCommand(const CommandStruct *aCommand) {
+    sDeadlineMillis = millis() + aCommand->DurationMillis;
+    sDeadlineIsActive = true;
+    if (sUseScheduler) {
+        wakeLoopScheduler();
+    }
+}
+
+/*
+ * Advances the clock and processes all commands, which arrive in this time
+ */
+void advanceSimulatedMicros(uint64_t aMicros) {
+    uint64_t tEndMicros = SimulatedMicros + aMicros;
+    while (sNextCommandIndex < NUMBER_OF_COMMANDS && sCommands[sNextCommandIndex].ArrivalMicros <= tEndMicros) {
+        if (sCommands[sNextCommandIndex].ArrivalMicros > SimulatedMicros) {
+            SimulatedMicros = sCommands[sNextCommandIndex].ArrivalMicros;
+        }
+        processCommand(&sCommands[sNextCommandIndex++]);
+    }
+    SimulatedMicros = tEndMicros;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return &sNotificationCount;
+}
+
+void xTaskNotifyGive(TaskHandle_t aTask) {
+    (void) aTask;
+    sNotificationCount++;
+}
+
+/*
+ * Sleeps until the timeout or until a command arriving in this time notifies the loop task
+ */
+uint32_t ulTaskNotifyTake(int aClearCountOnExit, uint32_t aTicksToWait) {
+    uint64_t tEndMicros = SimulatedMicros + (uint64_t) aTicksToWait * portTICK_PERIOD_MS * 1000;
+    while (sNotificationCount == 0 && SimulatedMicros < tEndMicros) {
+        uint64_t tStepMicros = tEndMicros - SimulatedMicros;
+        if (sNextCommandIndex < NUMBER_OF_COMMANDS && sCommands[sNextCommandIndex].ArrivalMicros < tEndMicros) {
+            tStepMicros = sCommands[sNextCommandIndex].ArrivalMicros > SimulatedMicros ?
+                    sCommands[sNextCommandIndex].ArrivalMicros - SimulatedMicros : 0;
+        }
+        advanceSimulatedMicros(tStepMicros);
+    }
+    uint32_t tCount = sNotificationCount;
+    if (aClearCountOnExit) {
+        sNotificationCount = 0;
+    } else if (sNotificationCount > 0) {
+        sNotificationCount--;
+    }
+    return tCount;
+}
+
+/*
+ * Task which waits for the deadline of the last command
+ */
+static uint32_t deadlineTask() {
+    advanceSimulatedMicros(TASK_COST_MICROS);
+    if (!sDeadlineIsActive) {
+        return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+    }
+    long tMillisUntilDeadline = (long) (sDeadlineMillis - millis());
+    if (tMillisUntilDeadline > 0) {
+        return tMillisUntilDeadline;
+    }
+    sDeadlineIsActive = false;
+    sNumberOfDeadlines++;
+    if ((unsigned long) -tMillisUntilDeadline > sMaxDeadlineLatenessMillis) {
+        sMaxDeadlineLatenessMillis = -tMillisUntilDeadline;
+    }
+    return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+}
+
+/*
+ * Periodic tasks with the cadence of the tasks in the .ino file
+ */
+static uint32_t otaTask() {
+    advanceSimulatedMicros(TASK_COST_MICROS);
+    return 50;
+}
+static uint32_t serialTask() {
+    advanceSimulatedMicros(TASK_COST_MICROS);
+    return 100;
+}
+static uint32_t lampTask() {
+    advanceSimulatedMicros(TASK_COST_MICROS);
+    return 200;
+}
+static uint32_t idleTask() {
+    advanceSimulatedMicros(TASK_COST_MICROS);
+    return LOOP_SCHEDULER_MAX_SLEEP_MILLIS;
+}
+
+static LoopTaskStruct sLoopTasks[] = { { "deadline", deadlineTask, true, 0, 0, 0 }, { "ota", otaTask, false, 0, 0, 0 }, {
+        "serial", serialTask, false, 0, 0, 0 }, { "wifi", idleTask, false, 0, 0, 0 }, { "battery", idleTask, false, 0, 0, 0 }, {
+        "lamp", lampTask, false, 0, 0, 0 } };
+
+static void createCommands() {
+    srand(42); // reproducible
+    uint64_t tArrivalMicros = 0;
+    for (int i = 0; i < NUMBER_OF_COMMANDS; ++i) {
+        // Next command arrives after the deadline of the previous one
+        tArrivalMicros += (1600 + rand() % 1000) * 1000UL + rand() % 1000;
+        sCommands[i].ArrivalMicros = tArrivalMicros;
+        sCommands[i].DurationMillis = 10 + rand() % 1500;
+    }
+}
+
+static void resetSimulation(bool aUseScheduler) {
+    SimulatedMicros = 1000000; // start 1 s after boot
+    sNotificationCount = 0;
+    sNextCommandIndex = 0;
+    sUseScheduler = aUseScheduler;
+    sDeadlineIsActive = false;
+    sMaxDeadlineLatenessMillis = 0;
+    sNumberOfDeadlines = 0;
+}
+
+/*
+ * @return value of the key in the JSON key value pairs of printLoopSchedulerStatistics()
+ */
+static double getStatisticsValue(const char *aStatistics, const char *aKey) {
+    char tQuotedKey[48];
+    sprintf(tQuotedKey, "\"%s\":", aKey);
+    const char *tValue = strstr(aStatistics, tQuotedKey);
+    return tValue == NULL ? -1 : atof(tValue + strlen(tQuotedKey));
+}
+
+int main() {
+    static char tStatistics[1024];
+    int tNumberOfErrors = 0;
+    createCommands();
+    uint64_t tEndMicros = 1000000 + SIMULATION_MILLIS * 1000ULL;
+
+    /*
+     * Former loop: all tasks every 100 ms
+     */
+    resetSimulation(false);
+    uint32_t tPollingWakeups = 0;
+    while (SimulatedMicros < tEndMicros) {
+        for (uint_fast8_t i = 0; i < sizeof(sLoopTasks) / sizeof(sLoopTasks[0]); ++i) {
+            sLoopTasks[i].TaskFunction();
+        }
+        advanceSimulatedMicros(POLLING_DELAY_MILLIS * 1000);
+        tPollingWakeups++;
+    }
+    unsigned long tPollingMaxLatenessMillis = sMaxDeadlineLatenessMillis;
+
+    /*
+     * Deadline scheduler
+     */
+    resetSimulation(true);
+    initLoopScheduler(sLoopTasks, sizeof(sLoopTasks) / sizeof(sLoopTasks[0]));
+    while (SimulatedMicros < tEndMicros) {
+        runLoopScheduler();
+    }
+    printLoopSchedulerStatistics(tStatistics);
+    double tSleepPercent = getStatisticsValue(tStatistics, "loop_sleep_percent");
+    double tWakeups = getStatisticsValue(tStatistics, "loop_wakeups");
+    double tSchedulerMaxLatenessMillis = getStatisticsValue(tStatistics, "loop_deadline_max_late_ms");
+
+    printf("%d s simulated, %u commands with deadline\n", (int) (SIMULATION_MILLIS / 1000), (unsigned) sNumberOfDeadlines);
+    printf("delay(%d) polling: max deadline lateness %lu ms = %lu mm at %d mm/s, %.1f wakeups per s\n", POLLING_DELAY_MILLIS,
+            tPollingMaxLatenessMillis, (tPollingMaxLatenessMillis * MILLIMETER_PER_SECOND) / 1000, MILLIMETER_PER_SECOND,
+            (double) tPollingWakeups * 1000 / SIMULATION_MILLIS);
+    printf("Scheduler: max deadline lateness %lu ms, loop_deadline_max_late_ms %.0f, loop_sleep_percent %.1f, %.1f wakeups per s\n",
+            sMaxDeadlineLatenessMillis, tSchedulerMaxLatenessMillis, tSleepPercent, tWakeups * 1000 / SIMULATION_MILLIS);
+
+    if (sNumberOfDeadlines != NUMBER_OF_COMMANDS) {
+        printf("Only %u of %d deadlines reached\n", (unsigned) sNumberOfDeadlines, NUMBER_OF_COMMANDS);
+        tNumberOfErrors++;
+    }
+    // One ms for the resolution of millis() and the execution time of the tasks before
+    if (sMaxDeadlineLatenessMillis > 1 || tSchedulerMaxLatenessMillis > 1) {
+        printf("Deadline lateness too high\n");
+        tNumberOfErrors++;
+    }
+    if (tSleepPercent < 99.0) {
+        printf("Loop sleeps too little\n");
+        tNumberOfErrors++;
+    }
+    if (tNumberOfErrors > 0) {
+        return EXIT_FAILURE;
+    }
+    printf("Loop scheduler simulation passed\n");
+    return EXIT_SUCCESS;
+}
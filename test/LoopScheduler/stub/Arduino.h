@@ -0,0 +1,48 @@
+/*
+ * Arduino.h
+ *
+ *  Minimal Arduino and FreeRTOS API for running LoopScheduler.cpp on the host with a simulated clock.
+ *  Time only advances by advanceSimulatedMicros(), i.e. by simulated task execution and by sleeping in ulTaskNotifyTake().
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _SIMULATED_ARDUINO_H
+#define _SIMULATED_ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef void *TaskHandle_t;
+#define pdTRUE              1
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(aMillis) ((uint32_t) (aMillis) / portTICK_PERIOD_MS)
+
+extern uint64_t SimulatedMicros;
+void advanceSimulatedMicros(uint64_t aMicros);
+
+inline unsigned long millis() {
+    return SimulatedMicros / 1000;
+}
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void xTaskNotifyGive(TaskHandle_t aTask);
+uint32_t ulTaskNotifyTake(int aClearCountOnExit, uint32_t aTicksToWait);
+
+#endif // _SIMULATED_ARDUINO_H
@@ -0,0 +1,228 @@
+/*
+ * MotionEstimatorBenchmark.cpp
+ *
+ *  Host benchmark and check of the motion estimator on frames recorded from the pictures of this repository.
+ *  Each picture is cut into VGA frames at known offsets, which are encoded as JPEG like the camera does.
+ *  The frames are given to checkFrameForMotion(), which decodes them at 1/8 scale, computes the luminance grid
+ *  and searches the shift with the sum of absolute differences. The estimated shift must match the offset of the frames.
+ *  Decoding is done by libjpeg here and by the ROM decoder on the ESP32, so only the estimation time is comparable.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <jpeglib.h>
+
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "img_converters.h"
+#include "MotionEstimator.h"
+#include "esp32-cam-webserver.h"
+#include "MotorAndServoControl.h"
+
+#define FRAME_WIDTH             640
+#define FRAME_HEIGHT            480
+#define PIXEL_PER_GRID_CELL     (FRAME_WIDTH / MOTION_GRID_WIDTH)
+#define FRAME_JPEG_QUALITY      80
+#define SAMPLE_INTERVAL_MILLIS  1000 // longer than MOTION_SAMPLE_MILLIS_STANDING, so each frame is sampled
+
+unsigned long HostMillis;
+HostSerial Serial;
+const bool sOnePWMMotorIsSupported = true;
+bool isMotorStopped() {
+    return true;
+}
+int16_t getMotorMillimeterPerSecond() {
+    return 0;
+}
+
+static const char *const sPictureNames[] = { "Impression.jpg", "TheReason.jpg", "JunctionWithoutTennisball.jpg", "Top.jpg",
+        "2Wheels.jpg", "EndOf125mm.jpg" };
+
+/*
+ * Frame origins in the picture. Each step moves the content by whole grid cells.
+ */
+struct FrameOriginStruct {
+    int X;
+    int Y;
+};
+static const FrameOriginStruct sFrameOrigins[] = { { 80, 60 }, { 120, 60 }, { 80, 60 }, { 80, 100 }, { 40, 60 }, { 40, 60 },
+        { 60, 80 }, { 120, 20 }, { 80, 60 } };
+#define NUMBER_OF_FRAMES (sizeof(sFrameOrigins) / sizeof(sFrameOrigins[0]))
+
+static int64_t sDecodeMicros;
+
+/*
+ * Big endian RGB565 output like the decoder of esp32-camera
+ */
+bool jpg2rgb565(const uint8_t *src, size_t src_len, uint8_t *out, jpg_scale_t scale) {
+    int64_t tStartMicros = esp_timer_get_time();
+    struct jpeg_decompress_struct tDecoder;
+    struct jpeg_error_mgr tErrorManager;
+    tDecoder.err = jpeg_std_error(&tErrorManager);
+    jpeg_create_decompress(&tDecoder);
+    jpeg_mem_src(&tDecoder, src, src_len);
+    jpeg_read_header(&tDecoder, TRUE);
+    tDecoder.scale_num = 1;
+    tDecoder.scale_denom = 1 << scale;
+    tDecoder.out_color_space = JCS_RGB;
+    jpeg_start_decompress(&tDecoder);
+    std::vector<uint8_t> tRow(tDecoder.output_width * 3);
+    while (tDecoder.output_scanline < tDecoder.output_height) {
+        JSAMPROW tRowPointer = &tRow[0];
+        jpeg_read_scanlines(&tDecoder, &tRowPointer, 1);
+        for (unsigned int x = 0; x < tDecoder.output_width; ++x) {
+            uint16_t tPixel = ((tRow[x * 3] & 0xF8) << 8) | ((tRow[x * 3 + 1] & 0xFC) << 3) | (tRow[x * 3 + 2] >> 3);
+            *out++ = tPixel >> 8;
+            *out++ = tPixel & 0xFF;
+        }
+    }
+    jpeg_finish_decompress(&tDecoder);
+    jpeg_destroy_decompress(&tDecoder);
+    sDecodeMicros += esp_timer_get_time() - tStartMicros;
+    return true;
+}
+
+/*
+ * @return false if file can not be read
+ */
+static bool decodePicture(const char *aFilename, std::vector<uint8_t> &aRGB, int *aWidth, int *aHeight) {
+    FILE *tFile = fopen(aFilename, "rb");
+    if (tFile == NULL) {
+        return false;
+    }
+    struct jpeg_decompress_struct tDecoder;
+    struct jpeg_error_mgr tErrorManager;
+    tDecoder.err = jpeg_std_error(&tErrorManager);
+    jpeg_create_decompress(&tDecoder);
+    jpeg_stdio_src(&tDecoder, tFile);
+    jpeg_read_header(&tDecoder, TRUE);
+    tDecoder.out_color_space = JCS_RGB;
+    jpeg_start_decompress(&tDecoder);
+    *aWidth = tDecoder.output_width;
+    *aHeight = tDecoder.output_height;
+    aRGB.resize(*aWidth * *aHeight * 3);
+    while (tDecoder.output_scanline < tDecoder.output_height) {
+        JSAMPROW tRowPointer = &aRGB[tDecoder.output_scanline * *aWidth * 3];
+        jpeg_read_scanlines(&tDecoder, &tRowPointer, 1);
+    }
+    jpeg_finish_decompress(&tDecoder);
+    jpeg_destroy_decompress(&tDecoder);
+    fclose(tFile);
+    return true;
+}
+
+/*
+ * Encodes the VGA part of the picture at aOrigin
+ */
+static void recordFrame(const std::vector<uint8_t> &aRGB, int aWidth, const FrameOriginStruct *aOrigin, std::vector<uint8_t> &aJpeg) {
+    struct jpeg_compress_struct tEncoder;
+    struct jpeg_error_mgr tErrorManager;
+    tEncoder.err = jpeg_std_error(&tErrorManager);
+    jpeg_create_compress(&tEncoder);
+    unsigned char *tBuffer = NULL;
+    unsigned long tLength = 0;
+    jpeg_mem_dest(&tEncoder, &tBuffer, &tLength);
+    tEncoder.image_width = FRAME_WIDTH;
+    tEncoder.image_height = FRAME_HEIGHT;
+    tEncoder.input_components = 3;
+    tEncoder.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&tEncoder);
+    jpeg_set_quality(&tEncoder, FRAME_JPEG_QUALITY, TRUE);
+    jpeg_start_compress(&tEncoder, TRUE);
+    while (tEncoder.next_scanline < FRAME_HEIGHT) {
+        JSAMPROW tRowPointer = (JSAMPROW) &aRGB[((aOrigin->Y + tEncoder.next_scanline) * aWidth + aOrigin->X) * 3];
+        jpeg_write_scanlines(&tEncoder, &tRowPointer, 1);
+    }
+    jpeg_finish_compress(&tEncoder);
+    jpeg_destroy_compress(&tEncoder);
+    aJpeg.assign(tBuffer, tBuffer + tLength);
+    free(tBuffer);
+}
+
+int main(int argc, char *argv[]) {
+    long tIterations = 20;
+    if (argc > 1) {
+        tIterations = atol(argv[1]);
+    }
+    if (!initMotionEstimator()) {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::vector<uint8_t> > tFrames;
+    for (unsigned int i = 0; i < sizeof(sPictureNames) / sizeof(sPictureNames[0]); ++i) {
+        char tFilename[256];
+        snprintf(tFilename, sizeof(tFilename), "%s/%s", PICTURES_DIR, sPictureNames[i]);
+        std::vector<uint8_t> tRGB;
+        int tWidth, tHeight;
+        if (!decodePicture(tFilename, tRGB, &tWidth, &tHeight)) {
+            printf("FAILED to read %s\n", tFilename);
+            return EXIT_FAILURE;
+        }
+        for (unsigned int j = 0; j < NUMBER_OF_FRAMES; ++j) {
+            tFrames.push_back(std::vector<uint8_t>());
+            recordFrame(tRGB, tWidth, &sFrameOrigins[j], tFrames.back());
+        }
+    }
+
+    int tNumberOfErrors = 0;
+    long tNumberOfSamples = 0;
+    int64_t tSampleMicros = 0;
+    sDecodeMicros = 0;
+    for (long tIteration = 0; tIteration < tIterations; ++tIteration) {
+        for (unsigned int i = 0; i < tFrames.size(); ++i) {
+            camera_fb_t tFrame = { &tFrames[i][0], tFrames[i].size(), FRAME_WIDTH, FRAME_HEIGHT, PIXFORMAT_JPEG };
+            HostMillis += SAMPLE_INTERVAL_MILLIS;
+            bool tIsMoving = checkFrameForMotion(&tFrame, true);
+            unsigned int tFrameIndex = i % NUMBER_OF_FRAMES;
+            if (tFrameIndex == 0) {
+                continue; // first frame of a picture, the shift to the previous picture is undefined
+            }
+            tNumberOfSamples++;
+            tSampleMicros += MotionEstimate.LastSampleMicros;
+            // content at the previous origin moves by the difference of the origins
+            int tExpectedShiftX = (sFrameOrigins[tFrameIndex - 1].X - sFrameOrigins[tFrameIndex].X) / PIXEL_PER_GRID_CELL;
+            int tExpectedShiftY = (sFrameOrigins[tFrameIndex - 1].Y - sFrameOrigins[tFrameIndex].Y) / PIXEL_PER_GRID_CELL;
+            bool tExpectedMoving = tExpectedShiftX != 0 || tExpectedShiftY != 0;
+            if (MotionEstimate.ShiftX != tExpectedShiftX || MotionEstimate.ShiftY != tExpectedShiftY
+                    || tIsMoving != tExpectedMoving) {
+                if (tIteration == 0) {
+                    printf("FAILED %s frame %u: shift %d,%d moving %d, expected %d,%d moving %d, scene change %u\n",
+                            sPictureNames[i / NUMBER_OF_FRAMES], tFrameIndex, MotionEstimate.ShiftX, MotionEstimate.ShiftY,
+                            tIsMoving, tExpectedShiftX, tExpectedShiftY, tExpectedMoving, MotionEstimate.SceneChangeScore);
+                }
+                tNumberOfErrors++;
+            }
+        }
+    }
+    // Each sample has one decode, the first frames of the pictures too
+    long tNumberOfDecodes = tIterations * tFrames.size();
+    double tDecodeMicrosPerFrame = (double) sDecodeMicros / tNumberOfDecodes;
+    printf("%ld samples of %u VGA frames\n", tNumberOfSamples, (unsigned int) tFrames.size());
+    printf("Decode 1/8 scale:                  %.1f us per frame (libjpeg)\n", tDecodeMicrosPerFrame);
+    printf("Luminance grid and %d shifts SAD:  %.1f us per frame\n", (2 * MOTION_MAX_SHIFT + 1) * (2 * MOTION_MAX_SHIFT + 1),
+            (double) tSampleMicros / tNumberOfSamples - tDecodeMicrosPerFrame);
+    if (tNumberOfErrors > 0) {
+        printf("FAILED %d wrong estimates\n", tNumberOfErrors);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+/*
+ * Arduino.h
+ *
+ *  Minimal Arduino API for running MotionEstimator.cpp on the host. The clock is set by the benchmark.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _HOST_ARDUINO_H
+#define _HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+extern unsigned long HostMillis;
+
+inline unsigned long millis() {
+    return HostMillis;
+}
+inline bool psramFound() {
+    return true;
+}
+inline void* ps_malloc(size_t aSize) {
+    return malloc(aSize);
+}
+
+class HostSerial {
+public:
+    void println(const char *aString) {
+        puts(aString);
+    }
+};
+extern HostSerial Serial;
+
+#endif // _HOST_ARDUINO_H
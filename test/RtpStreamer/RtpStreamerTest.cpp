@@ -0,0 +1,357 @@
+/*
+ * RtpStreamerTest.cpp
+ *
+ *  Host test of the RTP/JPEG (RFC 2435) streamer over the loopback interface.
+ *  The camera stub delivers two pictures of this repository, a 4:2:2 SVGA picture like the frames of the ESP32-CAM and a 4:2:0 XGA picture.
+ *  The received packets are checked for the RTP and JPEG headers, the fragment offsets, the quantization tables,
+ *  the marker bit and the 90 kHz timestamps, and the reassembled scan data must be equal to the one of the picture.
+ *  In the middle of the stream, the destination is changed to a second receiver, which must receive only complete frames.
+ *  The latency is measured from fetching the frame until the last packet is received.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <atomic>
+#include <vector>
+
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "esp_camera.h"
+#include "lwip/sockets.h"
+#include "RtpStreamer.h"
+
+#define CAMERA_FRAME_TIMEOUT_MILLIS     100     // the next frame is delivered after the previous one was received or after this timeout
+#define RECEIVE_TIMEOUT_MILLIS          1000
+#define TIMESTAMP_TOLERANCE_MILLIS      20      // between fetching the frame and taking the timestamp
+#define NUMBER_OF_RECEIVERS             2
+#define MAX_REPORTED_ERRORS             10
+
+HostSerial Serial;
+
+static const char *const sPictureNames[] = { "Impression.jpg", "Top.jpg" };
+#define NUMBER_OF_PICTURES (sizeof(sPictureNames) / sizeof(sPictureNames[0]))
+
+/*
+ * Reference values of a picture, parsed independently of parseJpeg()
+ */
+struct SamplePictureStruct {
+    std::vector<uint8_t> Jpeg;
+    uint8_t Type;
+    uint16_t Width;
+    uint16_t Height;
+    const uint8_t *QuantizationTables[2];
+    const uint8_t *ScanData;
+    size_t ScanLength;
+};
+static SamplePictureStruct sPictures[NUMBER_OF_PICTURES];
+
+static long sNumberOfFrames;
+static std::atomic<long> sNumberOfFramesFetched(0);
+static std::atomic<long> sNumberOfFramesReceived(0);
+static std::vector<int64_t> sFetchMicros;
+static camera_fb_t sFrameBuffer;
+static int sNumberOfErrors;
+
+static void reportError(const char *aFormat, ...) {
+    if (sNumberOfErrors++ < MAX_REPORTED_ERRORS) {
+        va_list tArguments;
+        va_start(tArguments, aFormat);
+        printf("FAILED ");
+        vprintf(aFormat, tArguments);
+        putchar('\n');
+        va_end(tArguments);
+    }
+}
+
+/*
+ * Frame n is picture n modulo number of pictures. Like the camera, a new frame is available every some ms,
+ * here after the previous one was received, so the latency is not disturbed by a queue.
+ */
+camera_fb_t* esp_camera_fb_get() {
+    for (int i = 0; i < CAMERA_FRAME_TIMEOUT_MILLIS && sNumberOfFramesReceived < sNumberOfFramesFetched; ++i) {
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    long tFrameIndex = sNumberOfFramesFetched;
+    if (tFrameIndex >= sNumberOfFrames) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+        return NULL;
+    }
+    sFetchMicros[tFrameIndex] = esp_timer_get_time();
+    SamplePictureStruct *tPicture = &sPictures[tFrameIndex % NUMBER_OF_PICTURES];
+    sFrameBuffer.buf = &tPicture->Jpeg[0];
+    sFrameBuffer.len = tPicture->Jpeg.size();
+    sFrameBuffer.width = tPicture->Width;
+    sFrameBuffer.height = tPicture->Height;
+    sFrameBuffer.format = PIXFORMAT_JPEG;
+    sNumberOfFramesFetched++;
+    return &sFrameBuffer;
+}
+
+void esp_camera_fb_return(camera_fb_t *fb) {
+    (void) fb;
+}
+
+static bool readPicture(const char *aFilename, SamplePictureStruct *aPicture) {
+    FILE *tFile = fopen(aFilename, "rb");
+    if (tFile == NULL) {
+        return false;
+    }
+    fseek(tFile, 0, SEEK_END);
+    aPicture->Jpeg.resize(ftell(tFile));
+    fseek(tFile, 0, SEEK_SET);
+    size_t tLength = fread(&aPicture->Jpeg[0], 1, aPicture->Jpeg.size(), tFile);
+    fclose(tFile);
+    if (tLength != aPicture->Jpeg.size()) {
+        return false;
+    }
+    // The pictures have one table per DQT segment, 3 components and no restart interval
+    const uint8_t *tJpeg = &aPicture->Jpeg[0];
+    size_t tIndex = 2;
+    int tNumberOfTables = 0;
+    while (tIndex + 4 < tLength) {
+        uint8_t tMarker = tJpeg[tIndex + 1];
+        size_t tSegmentLength = (tJpeg[tIndex + 2] << 8) | tJpeg[tIndex + 3];
+        const uint8_t *tSegment = &tJpeg[tIndex + 4];
+        if (tMarker == 0xDB && tNumberOfTables < 2) {
+            aPicture->QuantizationTables[tNumberOfTables++] = &tSegment[1];
+        } else if (tMarker == 0xC0) {
+            aPicture->Height = (tSegment[1] << 8) | tSegment[2];
+            aPicture->Width = (tSegment[3] << 8) | tSegment[4];
+            aPicture->Type = (tSegment[7] == 0x22) ? 1 : 0;
+        } else if (tMarker == 0xDA) {
+            aPicture->ScanData = &tJpeg[tIndex + 2 + tSegmentLength];
+            size_t tEnd = tLength;
+            while (!(tJpeg[tEnd - 2] == 0xFF && tJpeg[tEnd - 1] == 0xD9)) {
+                tEnd--;
+            }
+            aPicture->ScanLength = &tJpeg[tEnd - 2] - aPicture->ScanData;
+            return tNumberOfTables == 2;
+        }
+        tIndex += 2 + tSegmentLength;
+    }
+    return false;
+}
+
+/*
+ * Reassembly state of one receiver
+ */
+struct ReceiverStruct {
+    int Socket;
+    uint16_t Port;
+    bool HasSequenceNumber;
+    uint16_t NextSequenceNumber;
+    bool FrameIsOpen;
+    long FrameIndex;
+    uint32_t Timestamp;
+    std::vector<uint8_t> ScanData;
+    long NumberOfFrames;
+};
+
+static uint32_t sSSRC;
+static bool sHasSSRC;
+static long sNumberOfPackets;
+static int64_t sSumOfLatencyMicros;
+static int64_t sMaxLatencyMicros;
+
+static void checkPacket(ReceiverStruct *aReceiver, const uint8_t *aPacket, size_t aLength) {
+    sNumberOfPackets++;
+    if (aLength < 20 || aPacket[0] != 0x80 || (aPacket[1] & 0x7F) != RTP_PAYLOAD_TYPE_JPEG) {
+        reportError("port %u: invalid RTP header", aReceiver->Port);
+        return;
+    }
+    bool tIsLastPacket = aPacket[1] & 0x80;
+    uint16_t tSequenceNumber = (aPacket[2] << 8) | aPacket[3];
+    uint32_t tTimestamp = ((uint32_t) aPacket[4] << 24) | (aPacket[5] << 16) | (aPacket[6] << 8) | aPacket[7];
+    uint32_t tSSRC = ((uint32_t) aPacket[8] << 24) | (aPacket[9] << 16) | (aPacket[10] << 8) | aPacket[11];
+    if (aReceiver->HasSequenceNumber && tSequenceNumber != aReceiver->NextSequenceNumber) {
+        reportError("port %u: sequence number %u, expected %u", aReceiver->Port, tSequenceNumber, aReceiver->NextSequenceNumber);
+    }
+    aReceiver->HasSequenceNumber = true;
+    aReceiver->NextSequenceNumber = tSequenceNumber + 1;
+    if (sHasSSRC && tSSRC != sSSRC) {
+        reportError("SSRC changed");
+    }
+    sHasSSRC = true;
+    sSSRC = tSSRC;
+
+    // JPEG header
+    const uint8_t *p = &aPacket[12];
+    uint32_t tFragmentOffset = ((uint32_t) p[1] << 16) | (p[2] << 8) | p[3];
+    if (tFragmentOffset == 0) {
+        if (aReceiver->FrameIsOpen) {
+            reportError("port %u: frame %ld has no marker bit", aReceiver->Port, aReceiver->FrameIndex);
+        }
+        aReceiver->FrameIsOpen = true;
+        aReceiver->FrameIndex = sNumberOfFramesReceived; // only one frame is in flight
+        aReceiver->Timestamp = tTimestamp;
+        aReceiver->ScanData.clear();
+        // 90 kHz timestamp is taken just after the frame was fetched
+        uint32_t tFetchTimestamp = (uint32_t) ((sFetchMicros[aReceiver->FrameIndex] * (RTP_CLOCK_RATE / 1000)) / 1000);
+        if (tTimestamp - tFetchTimestamp > TIMESTAMP_TOLERANCE_MILLIS * (RTP_CLOCK_RATE / 1000)) {
+            reportError("frame %ld: timestamp %lu is %ld ticks after fetch", aReceiver->FrameIndex, (unsigned long) tTimestamp,
+                    (long) (int32_t) (tTimestamp - tFetchTimestamp));
+        }
+    } else if (!aReceiver->FrameIsOpen) {
+        reportError("port %u: fragment offset %lu without start of frame", aReceiver->Port, (unsigned long) tFragmentOffset);
+        return;
+    }
+    SamplePictureStruct *tPicture = &sPictures[aReceiver->FrameIndex % NUMBER_OF_PICTURES];
+    if (p[0] != 0 || p[4] != tPicture->Type || p[5] != 255 || p[6] != tPicture->Width / 8 || p[7] != tPicture->Height / 8) {
+        reportError("frame %ld: JPEG header type %u Q %u size %u x %u, expected type %u Q 255 size %u x %u", aReceiver->FrameIndex,
+                p[4], p[5], p[6] * 8, p[7] * 8, tPicture->Type, tPicture->Width, tPicture->Height);
+    }
+    if (tTimestamp != aReceiver->Timestamp) {
+        reportError("frame %ld: timestamp changed within frame", aReceiver->FrameIndex);
+    }
+    if (tFragmentOffset != aReceiver->ScanData.size()) {
+        reportError("frame %ld: fragment offset %lu, expected %u", aReceiver->FrameIndex, (unsigned long) tFragmentOffset,
+                (unsigned int) aReceiver->ScanData.size());
+    }
+    p += 8;
+    if (tFragmentOffset == 0) {
+        // Quantization table header
+        if (p[0] != 0 || p[1] != 0 || p[2] != 0 || p[3] != 128 || memcmp(&p[4], tPicture->QuantizationTables[0], 64) != 0
+                || memcmp(&p[4 + 64], tPicture->QuantizationTables[1], 64) != 0) {
+            reportError("frame %ld: wrong quantization tables", aReceiver->FrameIndex);
+        }
+        p += 4 + 128;
+    }
+    aReceiver->ScanData.insert(aReceiver->ScanData.end(), p, aPacket + aLength);
+    if (aReceiver->ScanData.size() >= tPicture->ScanLength && !tIsLastPacket) {
+        reportError("frame %ld: no marker bit at end of scan data", aReceiver->FrameIndex);
+    }
+    if (tIsLastPacket) {
+        int64_t tLatencyMicros = esp_timer_get_time() - sFetchMicros[aReceiver->FrameIndex];
+        sSumOfLatencyMicros += tLatencyMicros;
+        if (sMaxLatencyMicros < tLatencyMicros) {
+            sMaxLatencyMicros = tLatencyMicros;
+        }
+        if (aReceiver->ScanData.size() != tPicture->ScanLength
+                || memcmp(&aReceiver->ScanData[0], tPicture->ScanData, tPicture->ScanLength) != 0) {
+            reportError("frame %ld: reassembled scan data differs from %s", aReceiver->FrameIndex,
+                    sPictureNames[aReceiver->FrameIndex % NUMBER_OF_PICTURES]);
+        }
+        aReceiver->FrameIsOpen = false;
+        aReceiver->NumberOfFrames++;
+        sNumberOfFramesReceived++;
+    }
+}
+
+static bool openReceiver(ReceiverStruct *aReceiver) {
+    aReceiver->Socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct sockaddr_in tAddress;
+    memset(&tAddress, 0, sizeof(tAddress));
+    tAddress.sin_family = AF_INET;
+    tAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    tAddress.sin_port = 0; // any free port
+    socklen_t tAddressLength = sizeof(tAddress);
+    int tBufferSize = 1 << 20; // a complete frame
+    setsockopt(aReceiver->Socket, SOL_SOCKET, SO_RCVBUF, &tBufferSize, sizeof(tBufferSize));
+    if (aReceiver->Socket < 0 || bind(aReceiver->Socket, (struct sockaddr*) &tAddress, sizeof(tAddress)) != 0
+            || getsockname(aReceiver->Socket, (struct sockaddr*) &tAddress, &tAddressLength) != 0) {
+        return false;
+    }
+    aReceiver->Port = ntohs(tAddress.sin_port);
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    sNumberOfFrames = 100;
+    if (argc > 1) {
+        sNumberOfFrames = atol(argv[1]);
+    }
+    sFetchMicros.resize(sNumberOfFrames);
+    for (unsigned int i = 0; i < NUMBER_OF_PICTURES; ++i) {
+        char tFilename[256];
+        snprintf(tFilename, sizeof(tFilename), "%s/%s", PICTURES_DIR, sPictureNames[i]);
+        if (!readPicture(tFilename, &sPictures[i])) {
+            printf("FAILED to read %s\n", tFilename);
+            return EXIT_FAILURE;
+        }
+    }
+    ReceiverStruct tReceivers[NUMBER_OF_RECEIVERS];
+    for (int i = 0; i < NUMBER_OF_RECEIVERS; ++i) {
+        tReceivers[i] = ReceiverStruct();
+        if (!openReceiver(&tReceivers[i])) {
+            printf("FAILED to open receiver socket\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!startRtpStream(htonl(INADDR_LOOPBACK), tReceivers[0].Port)) {
+        return EXIT_FAILURE;
+    }
+    bool tDestinationIsChanged = false;
+    static uint8_t sPacket[RTP_MAX_PACKET_SIZE + 1];
+    while (sNumberOfFramesReceived < sNumberOfFrames) {
+        if (!tDestinationIsChanged && sNumberOfFramesFetched > sNumberOfFrames / 2) {
+            // Like a second /rtp request, while the task may be sending
+            startRtpStream(htonl(INADDR_LOOPBACK), tReceivers[1].Port);
+            tDestinationIsChanged = true;
+        }
+        struct pollfd tPollFds[NUMBER_OF_RECEIVERS];
+        for (int i = 0; i < NUMBER_OF_RECEIVERS; ++i) {
+            tPollFds[i].fd = tReceivers[i].Socket;
+            tPollFds[i].events = POLLIN;
+        }
+        if (poll(tPollFds, NUMBER_OF_RECEIVERS, RECEIVE_TIMEOUT_MILLIS) <= 0) {
+            reportError("no packet received for %d ms after %ld frames", RECEIVE_TIMEOUT_MILLIS, (long) sNumberOfFramesReceived);
+            break;
+        }
+        for (int i = 0; i < NUMBER_OF_RECEIVERS; ++i) {
+            if (tPollFds[i].revents & POLLIN) {
+                ssize_t tLength = recv(tReceivers[i].Socket, sPacket, sizeof(sPacket), 0);
+                if (tLength > RTP_MAX_PACKET_SIZE) {
+                    reportError("packet of %ld bytes is longer than %d", (long) tLength, RTP_MAX_PACKET_SIZE);
+                } else if (tLength > 0) {
+                    checkPacket(&tReceivers[i], sPacket, tLength);
+                }
+            }
+        }
+    }
+    stopRtpStream();
+    vTaskDelay(pdMS_TO_TICKS(RTP_STOP_TIMEOUT_MILLIS / 4)); // let the task close its socket
+
+    printf("%ld frames in %ld packets, %ld to the first and %ld to the second receiver\n", (long) sNumberOfFramesReceived,
+            sNumberOfPackets, tReceivers[0].NumberOfFrames, tReceivers[1].NumberOfFrames);
+    if (sNumberOfFramesReceived > 0) {
+        printf("Latency from frame fetch to last packet received: %.1f us average, %ld us maximum\n",
+                (double) sSumOfLatencyMicros / sNumberOfFramesReceived, (long) sMaxLatencyMicros);
+    }
+    printf("Sender: %lu us for the last frame, %lu us maximum\n", (unsigned long) RtpStatistics.LastFrameMicros,
+            (unsigned long) RtpStatistics.MaxFrameMicros);
+    if (RtpStatistics.Frames != (uint32_t) sNumberOfFrames || RtpStatistics.Packets != (uint32_t) sNumberOfPackets
+            || RtpStatistics.SendErrors != 0 || RtpStatistics.InvalidFrames != 0) {
+        reportError("statistics: %lu frames, %lu packets, %lu send errors, %lu invalid frames", (unsigned long) RtpStatistics.Frames,
+                (unsigned long) RtpStatistics.Packets, (unsigned long) RtpStatistics.SendErrors,
+                (unsigned long) RtpStatistics.InvalidFrames);
+    }
+    if (tReceivers[1].NumberOfFrames == 0) {
+        reportError("second receiver got no frame after the destination change");
+    }
+    if (sNumberOfErrors > 0) {
+        printf("FAILED with %d errors\n", sNumberOfErrors);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+/*
+ * Arduino.h
+ *
+ *  Minimal Arduino and FreeRTOS task API for running RtpStreamer.cpp on the host. A task is a detached thread.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _HOST_ARDUINO_H
+#define _HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+using std::max;
+using std::min;
+
+#define pdTRUE              1
+#define pdPASS              1
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(aMillis) ((uint32_t) (aMillis) / portTICK_PERIOD_MS)
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+inline void vTaskDelay(uint32_t aTicks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(aTicks * portTICK_PERIOD_MS));
+}
+inline int xTaskCreatePinnedToCore(TaskFunction_t aFunction, const char*, uint32_t, void *aParameter, int, TaskHandle_t*, int) {
+    std::thread(aFunction, aParameter).detach();
+    return pdPASS;
+}
+inline void vTaskDelete(TaskHandle_t) {
+    // the thread ends with the return of the task function
+}
+inline uint32_t esp_random() {
+    return ((uint32_t) rand() << 16) ^ rand();
+}
+
+class HostSerial {
+public:
+    void println(const char *aString) {
+        puts(aString);
+    }
+    void printf(const char *aFormat, ...) {
+        va_list tArguments;
+        va_start(tArguments, aFormat);
+        vprintf(aFormat, tArguments);
+        va_end(tArguments);
+    }
+};
+extern HostSerial Serial;
+
+#endif // _HOST_ARDUINO_H
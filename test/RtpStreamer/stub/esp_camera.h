@@ -0,0 +1,46 @@
+/*
+ * esp_camera.h
+ *
+ *  Frame buffer API of esp32-camera. The host implementation in RtpStreamerTest.cpp delivers the sample JPEGs.
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _HOST_ESP_CAMERA_H
+#define _HOST_ESP_CAMERA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+    PIXFORMAT_RGB565, PIXFORMAT_YUV422, PIXFORMAT_GRAYSCALE, PIXFORMAT_JPEG
+} pixformat_t;
+
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t width;
+    size_t height;
+    pixformat_t format;
+} camera_fb_t;
+
+camera_fb_t* esp_camera_fb_get();
+void esp_camera_fb_return(camera_fb_t *fb);
+
+#endif // _HOST_ESP_CAMERA_H
@@ -0,0 +1,49 @@
+/*
+ * semphr.h
+ *
+ *  FreeRTOS mutex API mapped to std::mutex
+ *
+ *  Copyright (C) 2024  Armin Joachimsmeyer
+ *  armin.joachimsmeyer@gmail.com
+ *
+ *  This file is part of ESP32-Cam-Sewer-inspection-car https://github.com/ArminJo/ESP32-Cam-Sewer-inspection-car.
+ *
+ *  ESP32-Cam-Sewer-inspection-car is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/gpl.html>.
+ */
+
+#ifndef _HOST_SEMPHR_H
+#define _HOST_SEMPHR_H
+
+#include <stdint.h>
+#include <mutex>
+
+#define portMAX_DELAY   0xFFFFFFFF
+typedef std::mutex *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new std::mutex;
+}
+inline int xSemaphoreTake(SemaphoreHandle_t aMutex, uint32_t aTicksToWait) {
+    if (aTicksToWait == 0) {
+        return aMutex->try_lock();
+    }
+    aMutex->lock();
+    return 1;
+}
+inline int xSemaphoreGive(SemaphoreHandle_t aMutex) {
+    aMutex->unlock();
+    return 1;
+}
+
+#endif // _HOST_SEMPHR_H